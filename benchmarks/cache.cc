@@ -0,0 +1,90 @@
+/*
+ * Teng -- a general purpose templating engine.
+ * Copyright (C) 2004  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Naskove 1, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:teng@firma.seznam.cz
+ *
+ *
+ * $Id: $
+ *
+ * DESCRIPTION
+ * Teng engine -- cache microbenchmark.
+ *
+ * AUTHORS
+ * Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * HISTORY
+ * 2026-10-16  (burlog)
+ *             Created.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "cache.h"
+
+namespace {
+
+using Cache_t = Teng::Cache_t<int>;
+using Clock_t = std::chrono::steady_clock;
+
+/** Returns the average time of one hit and one eviction in nanoseconds for
+ * cache of given size.
+ */
+std::pair<double, double> measure(unsigned int size, uint64_t rounds) {
+    Cache_t cache(size);
+    std::vector<Cache_t::Key_t> keys;
+    for (unsigned int i = 0; i < 2 * size; ++i)
+        keys.push_back({"template-" + std::to_string(i) + ".html", "", ""});
+
+    // fill the cache
+    for (unsigned int i = 0; i < size; ++i)
+        cache.add(keys[i], std::make_shared<int>(i));
+
+    // hits in LRU-hostile order: always touch the least recently used entry
+    uint64_t found = 0;
+    auto start = Clock_t::now();
+    for (uint64_t i = 0; i < rounds; ++i)
+        found += !!std::get<0>(cache.find(keys[i % size]));
+    auto hits = Clock_t::now() - start;
+
+    // each insert evicts one entry
+    start = Clock_t::now();
+    for (uint64_t i = 0; i < rounds; ++i)
+        cache.add(keys[(size + i) % keys.size()], std::make_shared<int>(0));
+    auto evictions = Clock_t::now() - start;
+
+    if (found != rounds) std::fprintf(stderr, "unexpected cache miss\n");
+    using ns = std::chrono::duration<double, std::nano>;
+    auto count = static_cast<double>(rounds);
+    return {ns(hits).count() / count, ns(evictions).count() / count};
+}
+
+} // namespace
+
+int main() {
+    std::printf("%10s %12s %12s\n", "size", "hit [ns]", "evict [ns]");
+    for (unsigned int size: {10u, 100u, 1000u, 10000u, 100000u}) {
+        auto result = measure(size, 1000000);
+        std::printf("%10u %12.1f %12.1f\n", size, result.first, result.second);
+    }
+    return 0;
+}
@@ -0,0 +1,191 @@
+/*
+ * Teng -- a general purpose templating engine.
+ * Copyright (C) 2004  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Naskove 1, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:teng@firma.seznam.cz
+ *
+ *
+ * $Id: $
+ *
+ * DESCRIPTION
+ * Teng engine -- data tree building and rendering benchmark.
+ *
+ * AUTHORS
+ * Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * HISTORY
+ * 2026-10-16  (burlog)
+ *             Created.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <memory_resource>
+
+#include "teng/filesystem.h"
+#include "teng/fragment.h"
+#include "teng/fragmentlist.h"
+#include "teng/fragmentvalue.h"
+#include "teng/writer.h"
+#include "configuration.h"
+#include "parsercontext.h"
+#include "dictionary.h"
+#include "processor.h"
+#include "program.h"
+
+namespace {
+
+using Clock_t = std::chrono::steady_clock;
+using ms = std::chrono::duration<double, std::milli>;
+
+/** Makes the fragment value that the engine creates for the root fragment.
+ */
+struct Data_t: public Teng::FragmentValue_t {
+    Data_t(const Teng::Fragment_t *root): Teng::FragmentValue_t(root) {}
+};
+
+/** The template reading the most of variables of the data tree.
+ */
+const char *source
+    = "<?teng frag rows?>"
+      "<tr id='${id}'><td>${name}</td><td>${price}</td><td>${stock}</td>"
+      "<td>${category}</td><td>${url}</td>"
+      "<?teng frag tags?>${label}=${weight};<?teng endfrag?>"
+      "<?teng frag attrs?>${attr_3},${attr_17},${attr_31};<?teng endfrag?>"
+      "</tr>\n"
+      "<?teng endfrag?>";
+
+/** Builds the data tree of given number of rows. Each row is the small
+ * fragment with a few variables and nested fragments and every tenth row
+ * has the large fragment of attributes.
+ */
+void build(Teng::Fragment_t &root, unsigned int rows) {
+    auto &list = root.addFragmentList("rows");
+    for (unsigned int i = 0; i < rows; ++i) {
+        auto &row = list.addFragment();
+        row.addVariable("url", "/item/" + std::to_string(i));
+        row.addVariable("name", "item-" + std::to_string(i));
+        row.addVariable("id", i);
+        row.addVariable("price", i % 100 + 0.5);
+        row.addVariable("stock", i % 7);
+        row.addVariable("category", "category-" + std::to_string(i % 13));
+        for (unsigned int j = 0; j < 3; ++j) {
+            auto &tag = row.addFragment("tags");
+            tag.addVariable("label", "tag-" + std::to_string(j));
+            tag.addVariable("weight", j);
+        }
+        if (i % 10) continue;
+        auto &attrs = row.addFragment("attrs");
+        for (unsigned int j = 0; j < 40; ++j)
+            attrs.addVariable("attr_" + std::to_string(j), j);
+    }
+}
+
+/** The measured times of one round in milliseconds.
+ */
+struct Times_t {
+    double building = 0;   //!< building of data tree
+    double rendering = 0;  //!< rendering of template
+    double destroying = 0; //!< destroying of data tree
+};
+
+/** Builds, renders and destroys the data tree of given number of rows and
+ * returns the average times. If the arena flag is set then the tree is
+ * built in the monotonic buffer.
+ */
+Times_t measure(
+    Teng::Error_t &err,
+    const Teng::Program_t &program,
+    const Teng::Dictionary_t &dict,
+    const Teng::Configuration_t &params,
+    unsigned int rows,
+    bool arena
+) {
+    Times_t times;
+    std::size_t bytes = 0;
+    auto rounds = 1000000 / rows;
+    for (unsigned int i = 0; i < rounds; ++i) {
+        auto start = Clock_t::now();
+        std::pmr::monotonic_buffer_resource buffer;
+        auto root = arena
+            ? std::make_unique<Teng::Fragment_t>(&buffer)
+            : std::make_unique<Teng::Fragment_t>();
+        build(*root, rows);
+        auto built = Clock_t::now();
+
+        Data_t data(root.get());
+        std::string output;
+        Teng::StringWriter_t writer(output);
+        Teng::Processor_t processor(
+            err, program, dict, params, "utf-8", "text/html"
+        );
+        processor.run(data, writer);
+        writer.flush();
+        bytes += output.size();
+        auto rendered = Clock_t::now();
+
+        root.reset();
+        buffer.release();
+        auto destroyed = Clock_t::now();
+
+        times.building += ms(built - start).count();
+        times.rendering += ms(rendered - built).count();
+        times.destroying += ms(destroyed - rendered).count();
+    }
+    if (!bytes) std::fprintf(stderr, "empty output\n");
+    times.building /= rounds;
+    times.rendering /= rounds;
+    times.destroying /= rounds;
+    return times;
+}
+
+} // namespace
+
+int main() {
+    Teng::Error_t err;
+    auto filesystem = std::make_shared<Teng::InMemoryFilesystem_t>();
+    Teng::Dictionary_t dict(err, filesystem);
+    Teng::Configuration_t params(err, filesystem);
+    auto program = Teng::compile_string(
+        err, &dict, &params, filesystem.get(), source, "utf-8", "text/html"
+    );
+
+    std::printf(
+        "%10s %6s %12s %12s %12s\n",
+        "rows", "arena", "build [ms]", "render [ms]", "destroy [ms]"
+    );
+    for (unsigned int rows: {1000u, 10000u, 100000u}) {
+        for (bool arena: {false, true}) {
+            auto times = measure(err, *program, dict, params, rows, arena);
+            std::printf(
+                "%10u %6s %12.3f %12.3f %12.3f\n",
+                rows,
+                arena? "yes": "no",
+                times.building,
+                times.rendering,
+                times.destroying
+            );
+        }
+    }
+
+    if (!err.empty()) std::fprintf(stderr, "unexpected errors\n");
+    return 0;
+}
@@ -0,0 +1,127 @@
+/*
+ * Teng -- a general purpose templating engine.
+ * Copyright (C) 2004  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Naskove 1, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:teng@firma.seznam.cz
+ *
+ *
+ * $Id: $
+ *
+ * DESCRIPTION
+ * Teng engine -- processor dispatch microbenchmark.
+ *
+ * AUTHORS
+ * Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * HISTORY
+ * 2026-10-16  (burlog)
+ *             Created.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "teng/filesystem.h"
+#include "teng/fragment.h"
+#include "teng/fragmentvalue.h"
+#include "teng/writer.h"
+#include "configuration.h"
+#include "parsercontext.h"
+#include "dictionary.h"
+#include "processor.h"
+#include "program.h"
+
+namespace {
+
+using Clock_t = std::chrono::steady_clock;
+using Dispatch_t = Teng::Processor_t::Dispatch_t;
+
+/** Makes the fragment value that the engine creates for the root fragment.
+ */
+struct Data_t: public Teng::FragmentValue_t {
+    Data_t(const Teng::Fragment_t *root): Teng::FragmentValue_t(root) {}
+};
+
+/** The template dominated by the VAL/VAR/PRINT sequences.
+ */
+const char *source
+    = "<?teng frag rows?>"
+      "<tr class='${_first ? 'first' : 'row'}'>"
+      "<td>${id}</td><td>${name}</td><td>${price * 2 + 1}</td>"
+      "<?teng if price > 50?><td>expensive</td><?teng endif?>"
+      "</tr>\n"
+      "<?teng endfrag?>";
+
+/** Returns the average time of one render in microseconds.
+ */
+double measure(
+    Teng::Processor_t &processor,
+    const Teng::FragmentValue_t &data,
+    Dispatch_t dispatch,
+    uint64_t rounds
+) {
+    std::size_t bytes = 0;
+    auto start = Clock_t::now();
+    for (uint64_t i = 0; i < rounds; ++i) {
+        std::string output;
+        Teng::StringWriter_t writer(output);
+        processor.run(data, writer, dispatch);
+        writer.flush();
+        bytes += output.size();
+    }
+    auto elapsed = Clock_t::now() - start;
+
+    if (!bytes) std::fprintf(stderr, "empty output\n");
+    using us = std::chrono::duration<double, std::micro>;
+    return us(elapsed).count() / static_cast<double>(rounds);
+}
+
+} // namespace
+
+int main() {
+    Teng::Error_t err;
+    auto filesystem = std::make_shared<Teng::InMemoryFilesystem_t>();
+    Teng::Dictionary_t dict(err, filesystem);
+    Teng::Configuration_t params(err, filesystem);
+    auto program = Teng::compile_string(
+        err, &dict, &params, filesystem.get(), source, "utf-8", "text/html"
+    );
+
+    std::printf("%10s %14s %14s\n", "rows", "switch [us]", "threaded [us]");
+    for (unsigned int size: {1u, 10u, 100u, 1000u}) {
+        Teng::Fragment_t root;
+        for (unsigned int i = 0; i < size; ++i) {
+            auto &row = root.addFragment("rows");
+            row.addVariable("id", i);
+            row.addVariable("name", "item-" + std::to_string(i));
+            row.addVariable("price", i % 100);
+        }
+        Data_t data(&root);
+        Teng::Processor_t processor(err, *program, dict, params, "utf-8", "text/html");
+        auto rounds = 1000000 / size;
+        auto switched = measure(processor, data, Dispatch_t::SWITCH, rounds);
+        auto threaded = measure(processor, data, Dispatch_t::THREADED, rounds);
+        std::printf("%10u %14.2f %14.2f\n", size, switched, threaded);
+    }
+
+    if (!err.empty()) std::fprintf(stderr, "unexpected errors\n");
+    return 0;
+}
@@ -0,0 +1,142 @@
+/*
+ * Teng -- a general purpose templating engine.
+ * Copyright (C) 2004  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Naskove 1, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:teng@firma.seznam.cz
+ *
+ *
+ * $Id: $
+ *
+ * DESCRIPTION
+ * Teng engine -- profile of the opcode sequences in the template corpus.
+ *
+ * AUTHORS
+ * Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * HISTORY
+ * 2026-10-16  (burlog)
+ *             Created.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "teng/filesystem.h"
+#include "configuration.h"
+#include "parsercontext.h"
+#include "dictionary.h"
+#include "peephole.h"
+#include "program.h"
+
+namespace {
+
+/** The corpus used if no template is given on the command line.
+ */
+const char *samples[] = {
+    "<?teng frag rows?>"
+    "<tr class='${_first ? 'first' : 'row'}'>"
+    "<td>${id}</td><td>${name}</td><td>${price * 2 + 1}</td>"
+    "<?teng if price > 50?><td>expensive</td><?teng endif?>"
+    "</tr>\n"
+    "<?teng endfrag?>",
+
+    "<?teng frag items?>"
+    "<li<?teng if $_number % 2?> class='odd'<?teng endif?>>"
+    "<a href='${url}'>${title}</a>"
+    "<?teng if !_last?>, <?teng endif?></li>"
+    "<?teng endfrag?>",
+
+    "<?teng if user?>Hello ${user.name}!<?teng else?>Hello guest!"
+    "<?teng endif?><?teng frag menu?><?teng if active?><b>${label}</b>"
+    "<?teng else?>${label}<?teng endif?><?teng endfrag?>",
+};
+
+/** Prints the most frequent sequences of given length.
+ */
+void report(const std::vector<std::unique_ptr<Teng::Program_t>> &programs,
+            std::size_t length, std::size_t limit
+) {
+    Teng::SequenceCounts_t counts;
+    for (auto &program: programs)
+        Teng::count_sequences(*program, length, counts);
+
+    std::vector<std::pair<uint64_t, Teng::OpcodeSequence_t>> sorted;
+    uint64_t total = 0;
+    for (auto &entry: counts) {
+        sorted.emplace_back(entry.second, entry.first);
+        total += entry.second;
+    }
+    std::sort(sorted.rbegin(), sorted.rend());
+    if (sorted.size() > limit) sorted.resize(limit);
+
+    std::printf("\n%zu-instruction sequences (%lu in total)\n", length, total);
+    for (auto &entry: sorted) {
+        std::string sequence;
+        for (auto opcode: entry.second)
+            sequence.append(sequence.empty()? "": " ")
+                    .append(Teng::opcode_str(opcode));
+        std::printf(
+            "%8lu %6.2f%% %-6s %s\n",
+            entry.first,
+            100.0 * static_cast<double>(entry.first)
+                  / static_cast<double>(total),
+            Teng::is_fused_sequence(entry.second)? "fused": "",
+            sequence.c_str()
+        );
+    }
+}
+
+} // namespace
+
+/** Compiles the templates given on the command line (or the builtin samples)
+ * and prints the most frequent opcode sequences that could be fused into
+ * superinstructions.
+ */
+int main(int argc, char *argv[]) {
+    Teng::Error_t err;
+    auto filesystem = std::make_shared<Teng::Filesystem_t>("");
+    Teng::Dictionary_t dict(err, filesystem);
+    Teng::Configuration_t params(err, filesystem);
+
+    std::vector<std::unique_ptr<Teng::Program_t>> programs;
+    for (int i = 1; i < argc; ++i) {
+        programs.push_back(Teng::compile_file(
+            err, &dict, &params, filesystem.get(), argv[i], "utf-8",
+            "text/html"
+        ));
+    }
+    if (programs.empty()) {
+        for (auto *source: samples) {
+            programs.push_back(Teng::compile_string(
+                err, &dict, &params, filesystem.get(), source, "utf-8",
+                "text/html"
+            ));
+        }
+    }
+
+    std::size_t instrs = 0;
+    for (auto &program: programs) instrs += program->size();
+    std::printf("%zu programs, %zu instructions\n", programs.size(), instrs);
+    for (std::size_t length: {2, 3, 4})
+        report(programs, length, 15);
+    return 0;
+}
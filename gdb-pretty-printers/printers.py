@@ -68,6 +68,12 @@ class TengFragmentValuePrinter:
             return "%s(%s)" % (self.typename, self.val["real_value"])
         elif tag_value == 5:
             return "%s(%s)" % (self.typename, self.val["string_value"])
+        elif tag_value == 6:
+            ref = self.val["string_view_value"]
+            return "%s(@\"%s\")" % (self.typename, ref["ptr"].string(length=ref["len"]))
+        elif tag_value == 7:
+            ref = self.val["lazy_value"]["_M_t"]["_M_t"]["_M_head_impl"]
+            return "%s(lazy_value=%s)" % (self.typename, ref)
         return "%s(unknown_frag_value_of_tag=%s)" % (self.typename, tag_value)
 
 class TengValuePrinter:
@@ -34,6 +34,7 @@
  *             reference counting ptr
  */
 
+#include <atomic>
 #include <memory>
 
 #ifndef TENGCOUNTED_PTR_H
@@ -41,8 +42,9 @@
 
 namespace Teng {
 
-/** It's similar to shared_ptr but does not provide any thread safety and can
- * release the held pointer.
+/** It's similar to shared_ptr but it is much simpler. The reference counter
+ * is atomic because the held objects (compiled regexes) live in programs that
+ * are shared by threads generating pages.
  */
 template <typename type_t>
 class counted_ptr {
@@ -124,7 +126,7 @@ protected:
     friend counted_ptr<fact_type_t> make_counted(args_t &&...);
 
     // types
-    using refs_t = std::size_t;
+    using refs_t = std::atomic<std::size_t>;
 
     /** C'tor: taking ownership.
      */
@@ -140,7 +142,7 @@ protected:
  */
 template <typename type_t, typename... args_t>
 counted_ptr<type_t> make_counted(args_t &&...args) {
-    struct memory_t {type_t value; std::size_t refs;};
+    struct memory_t {type_t value; std::atomic<std::size_t> refs;};
     auto *bytes = new char[sizeof(memory_t)];
     try {
         auto *memory = new (bytes) memory_t{{std::forward<args_t>(args)...}, 1};
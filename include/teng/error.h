@@ -149,6 +149,25 @@ public:
         append_impl(level, filename, lineno, colno, std::move(msg));
     }
 
+    /** Appends new entry. The filename is copied, so unlike the filename
+     * passed by pointer, it doesn't have to outlive the error log.
+     * @param entry new entry to append
+     */
+    void append(
+        Level_t level,
+        const std::string &filename,
+        int64_t lineno,
+        int64_t colno,
+        std::string msg
+    ) {
+        // increase level if lower than that of err
+        if (level > max_level)
+            max_level = level;
+
+        // append error log
+        append_impl(level, filename, lineno, colno, std::move(msg));
+    }
+
     /** Dumps log into stream.
      * @param out output stream
      */
@@ -212,6 +231,20 @@ private:
         std::string msg
     );
 
+    /** Inserts record to errors according to its position in source code.
+     */
+    void append_impl(
+        Level_t level,
+        const std::string &filename,
+        int64_t lineno,
+        int64_t colno,
+        std::string msg
+    );
+
+    /** Inserts the message to the record of given key.
+     */
+    void append_record(RecordKey_t key, Level_t level, std::string msg);
+
     // types
     using Filenames_t = std::vector<std::pair<const void *, char *>>;
     using Entries_t = std::unordered_map<RecordKey_t, RecordValue_t, RecordHash_t>;
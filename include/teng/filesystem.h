@@ -54,6 +54,13 @@ public:
     virtual std::string read(const std::string &filename) const;
     virtual size_t hash(const std::string &filename) const;
 
+    /**
+     * @short Make path of the file in real filesystem.
+     * @param filename Name of the file in filesystem
+     * @return Normalized absolute path of the file
+     */
+    std::string path(const std::string &filename) const;
+
 protected:
     std::string root;
 };
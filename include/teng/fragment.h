@@ -37,12 +37,18 @@
 #ifndef TENGFRAGMENT_H
 #define TENGFRAGMENT_H
 
-#include <map>
+#include <memory>
 #include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
 #include <cstdint>
+#include <iterator>
+#include <memory_resource>
 #include <type_traits>
 
 #include <teng/config.h>
+#include <teng/stringview.h>
 
 namespace Teng {
 
@@ -50,6 +56,7 @@ namespace Teng {
 class Fragment_t;
 class FragmentValue_t;
 class FragmentList_t;
+class FragmentProvider_t;
 
 /** Transparent string comparator.
  */
@@ -61,14 +68,137 @@ struct StrCmp_t {
 
 /**
  * @short Single fragment. Maps names to variables and nested fragments.
+ *
+ * The items are stored in one array. The small fragments keep the array ordered
+ * by the item names and search it linearly. The fragments with many items
+ * append new items to the array and look them up through the flat hash index
+ * that also keeps the order of names, so the iteration is always ordered by
+ * names. The nested fragment lists are allocated out of the array, so the
+ * list returned by addFragmentList() stays valid while the fragment lives.
+ *
+ * The whole data tree can be built in an arena (any memory resource, e.g.
+ * std::pmr::monotonic_buffer_resource) given to the root fragment:
+ *
+ * std::pmr::monotonic_buffer_resource arena;
+ * Teng::Fragment_t root(&arena);
+ * root.addFragment("row").addVariable("name", "value");
+ *
+ * The nested fragments and lists created by the add*() methods use the arena
+ * of their parent, so the items of the tree are allocated from the arena and
+ * released with it at once. Only the strings longer than the small string
+ * buffer are allocated from the heap. The tree must not outlive its arena.
  */
 class Fragment_t {
 public:
     // types
     using Item_t = FragmentValue_t;
-    using Items_t = std::map<std::string, Item_t, StrCmp_t>;
-    using const_iterator = Items_t::const_iterator;
-    using iterator = Items_t::iterator;
+    using Items_t = std::pmr::vector<std::pair<std::string, Item_t>>;
+
+    /**
+     * @short Iterator over the fragment items in order of their names.
+     */
+    template <typename Entry_t>
+    class Iterator_t {
+    public:
+        // types
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = std::remove_const_t<Entry_t>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Entry_t *;
+        using reference = Entry_t &;
+
+        /** C'tor.
+         */
+        Iterator_t() noexcept = default;
+
+        /** C'tor: the iterator to i-th item in order of names or, if not
+         * ranked, to the item at i-th position in items array. The order is
+         * nullptr if the items array itself is ordered.
+         */
+        Iterator_t(
+            Entry_t *items,
+            const uint32_t *order,
+            std::size_t i,
+            bool ranked = true
+        ) noexcept: items(items), order(order), i(i), ranked(ranked)
+        {}
+
+        /** C'tor: converts iterator to const_iterator.
+         */
+        template <
+            typename Other_t,
+            std::enable_if_t<
+                !std::is_same<Other_t, Entry_t>::value
+                && std::is_convertible<Other_t *, Entry_t *>::value, bool
+            > = true
+        > Iterator_t(const Iterator_t<Other_t> &other) noexcept
+            : items(other.items), order(other.order), i(other.i),
+              ranked(other.ranked)
+        {}
+
+        /** Returns the item.
+         */
+        reference operator*() const {return items[position()];}
+
+        /** Returns the pointer to item.
+         */
+        pointer operator->() const {return &**this;}
+
+        /** Moves to next item.
+         */
+        Iterator_t &operator++() {rank(); ++i; return *this;}
+
+        /** Moves to next item.
+         */
+        Iterator_t operator++(int) {auto tmp = *this; ++*this; return tmp;}
+
+        /** Moves to previous item.
+         */
+        Iterator_t &operator--() {rank(); --i; return *this;}
+
+        /** Moves to previous item.
+         */
+        Iterator_t operator--(int) {auto tmp = *this; --*this; return tmp;}
+
+        /** Returns true if both iterators refer to the same item.
+         */
+        bool operator==(const Iterator_t &other) const {
+            return position() == other.position();
+        }
+
+        /** Returns true if the iterators refer to different items.
+         */
+        bool operator!=(const Iterator_t &other) const {
+            return position() != other.position();
+        }
+
+    private:
+        template <typename> friend class Iterator_t;
+
+        /** Returns the position of item in items array. The order ends with
+         * the number of items, so the end iterator has position too.
+         */
+        std::size_t position() const {return order && ranked? order[i]: i;}
+
+        /** Converts the position of item to its place in order of names. It
+         * is needed only when the iterator returned by find() is moved.
+         */
+        void rank() {
+            if (!order || ranked) return;
+            std::size_t place = 0;
+            while (order[place] != i) ++place;
+            i = place;
+            ranked = true;
+        }
+
+        Entry_t *items = nullptr;        //!< the items array
+        const uint32_t *order = nullptr; //!< the order of items or nullptr
+        std::size_t i = 0;               //!< the index of item
+        bool ranked = true;              //!< the index is the place in order
+    };
+
+    using const_iterator = Iterator_t<const Items_t::value_type>;
+    using iterator = Iterator_t<Items_t::value_type>;
 
     // don't copy
     Fragment_t(const Fragment_t &) = delete;
@@ -77,21 +207,27 @@ public:
     /**
      * @short C'tor.
      */
-    Fragment_t() noexcept = default;
+    Fragment_t() noexcept;
+
+    /**
+     * @short C'tor: the fragment allocating its items from given arena.
+     * @param arena the memory resource (it has to outlive the fragment)
+     */
+    explicit Fragment_t(std::pmr::memory_resource *arena) noexcept;
 
     /**
      * @short C'tor: move.
      */
-    Fragment_t(Fragment_t &&other) noexcept = default;
+    Fragment_t(Fragment_t &&other) noexcept;
 
     /**
      * @short Assigment: move.
      */
-    Fragment_t &operator=(Fragment_t &&other) noexcept = default;
+    Fragment_t &operator=(Fragment_t &&other) noexcept;
 
     /** D'tor.
      */
-    ~Fragment_t() noexcept = default;
+    ~Fragment_t() noexcept;
 
     /**
      * @short Add variable to fragment.
@@ -147,6 +283,17 @@ public:
         addVariable(name, value);
     }
 
+    /**
+     * @short Add variable borrowing given string to fragment.
+     *
+     * The value is not copied, the memory it refers to has to be valid and
+     * unchanged until the last render of the data tree has finished.
+     *
+     * @param name variable name
+     * @param value variable value
+     */
+    void addVariableView(const std::string &name, string_view_t value);
+
     /**
      * @short Add nested fragment.
      * @param name fragment name
@@ -161,6 +308,17 @@ public:
      */
     FragmentList_t &addFragmentList(const std::string &name);
 
+    /**
+     * @short Add new nested fragment list that is filled by given provider
+     * when the template reads it for the first time.
+     * @param name fragment name
+     * @param provider the provider of the list fragments
+     */
+    void addLazyFragmentList(
+        const std::string &name,
+        std::unique_ptr<FragmentProvider_t> provider
+    );
+
     /**
      * @short Add some frag value to fragment.
      * @param name variable name
@@ -194,36 +352,74 @@ public:
      */
     void json(std::ostream &o) const;
 
+    /**
+     * @short Returns the hash of item name. The fragments with many items
+     * look the names up by their hashes.
+     */
+    static uint32_t hashName(const char *name, std::size_t size) {
+        uint32_t hash = 2166136261u; // FNV-1a
+        for (std::size_t i = 0; i < size; ++i) {
+            hash ^= static_cast<unsigned char>(name[i]);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    /**
+     * @short Returns the hash of item name.
+     */
+    template <typename Type_t>
+    static uint32_t hashName(const Type_t &name) {
+        return hashName(name.data(), name.size());
+    }
+
     /**
      * @short Returns iterator to fragment item of desired name.
      */
     template <typename Type_t>
-    const_iterator find(Type_t &&name) const {return items.find(name);}
+    const_iterator find(Type_t &&name) const {
+        string_view_t view(name);
+        if (index) return lookup(view.data(), view.size(), hashName(view));
+        return {items.data(), nullptr, search(view.data(), view.size())};
+    }
+
+    /**
+     * @short Returns iterator to fragment item of desired name whose hash
+     * has been already computed by hashName().
+     */
+    template <typename Type_t>
+    const_iterator find(Type_t &&name, uint32_t hash) const {
+        string_view_t view(name);
+        if (index) return lookup(view.data(), view.size(), hash);
+        return {items.data(), nullptr, search(view.data(), view.size())};
+    }
 
     /**
      * @short Returns iterator to fragment item of desired name.
      */
-    iterator find(const std::string &name) {return items.find(name);}
+    iterator find(const std::string &name);
 
     /**
      * @short Returns iterator to first fragment item.
      */
-    const_iterator begin() const {return items.begin();}
+    const_iterator begin() const {return {items.data(), order(), 0};}
 
     /**
      * @short Returns iterator one past the last fragment item.
      */
-    const_iterator end() const {return items.end();}
+    const_iterator end() const {
+        return {items.data(), order(), items.size()};
+    }
 
     /**
      * @short Returns iterator to first fragment item.
      */
-    iterator begin() {return items.begin();}
+    iterator begin() {return {items.data(), order(), 0};}
 
     /**
      * @short Returns iterator one past the last fragment item.
      */
-    iterator end() {return items.end();}
+    iterator end() {return {items.data(), order(), items.size()};}
 
     /**
      * @short Returns true if fragment is empty.
@@ -235,8 +431,64 @@ public:
      */
     std::size_t size() const {return items.size();}
 
+    /**
+     * @short Returns the memory resource the fragment allocates from.
+     */
+    std::pmr::memory_resource *arena() const {
+        return items.get_allocator().resource();
+    }
+
 protected:
-    Items_t items; //!< fragments data
+    /** The hash index of items that is built when the fragment gets
+     * index_threshold items.
+     */
+    struct Index_t;
+
+    /** The number of items since the items are looked up in hash index.
+     */
+    static constexpr std::size_t index_threshold = 8;
+
+    /** Returns the positions of items ordered by their names or nullptr if
+     * the items array itself is ordered.
+     */
+    const uint32_t *order() const;
+
+    /** Returns the position of item of desired name in the small fragment or
+     * size() if there is no such item.
+     */
+    std::size_t search(const char *name, std::size_t size) const;
+
+    /** Returns the position of item of desired name in the indexed fragment
+     * or size() if there is no such item.
+     */
+    std::size_t probe(const char *name, std::size_t size, uint32_t hash) const;
+
+    /** Returns the item of desired name looked up in the hash index or end()
+     * if there is no such item.
+     */
+    const_iterator
+    lookup(const char *name, std::size_t size, uint32_t hash) const;
+
+    /** Returns the item of desired name or nullptr.
+     */
+    Items_t::value_type *get(const std::string &name);
+
+    /** Inserts new item (the name must not be in the fragment yet).
+     */
+    template <typename... Args_t>
+    Items_t::value_type &insert(const std::string &name, Args_t &&...args);
+
+    /** Builds the index of the items ordered by their names.
+     */
+    void reindex();
+
+    /** Sets the value of the item of desired name or inserts new one.
+     */
+    template <typename Type_t>
+    void replace(const std::string &name, Type_t &&value);
+
+    Items_t items;                  //!< fragments data
+    std::unique_ptr<Index_t> index; //!< the index of items or nullptr
 };
 
 /** Writes string representation of fragment to stream.
@@ -38,10 +38,13 @@
 #define TENGFRAGMENTLIST_H
 
 #include <string>
+#include <memory>
 #include <vector>
 #include <cstdint>
+#include <memory_resource>
 
 #include <teng/config.h>
+#include <teng/stringview.h>
 
 namespace Teng {
 
@@ -49,6 +52,7 @@ namespace Teng {
 class Fragment_t;
 class FragmentValue_t;
 class FragmentList_t;
+class FragmentProvider_t;
 
 /**
  * @short List of fragment values of same name at same level.
@@ -56,7 +60,7 @@ class FragmentList_t;
 class FragmentList_t {
 public:
     // types
-    using Items_t = std::vector<FragmentValue_t>;
+    using Items_t = std::pmr::vector<FragmentValue_t>;
     using size_type = Items_t::size_type;
     using const_iterator = Items_t::const_iterator;
     using iterator = Items_t::iterator;
@@ -69,6 +73,14 @@ public:
      */
      FragmentList_t() noexcept = default;
 
+    /**
+     * @short C'tor: the list allocating its items from given arena.
+     * @param arena the memory resource (it has to outlive the list)
+     */
+    explicit FragmentList_t(std::pmr::memory_resource *arena) noexcept
+        : items(arena)
+    {}
+
     /**
      * @short C'tor: move.
      */
@@ -95,6 +107,13 @@ public:
      */
     FragmentList_t &addFragmentList();
 
+    /**
+     * @short Add fragment list, filled by given provider when the template
+     * reads it for the first time, to fragment list.
+     * @param provider the provider of the list fragments
+     */
+    void addLazyFragmentList(std::unique_ptr<FragmentProvider_t> provider);
+
     /**
      * @short Add value to list..
      * @param value variable value
@@ -143,6 +162,16 @@ public:
         addValue(value);
     }
 
+    /**
+     * @short Add value borrowing given string to list.
+     *
+     * The value is not copied, the memory it refers to has to be valid and
+     * unchanged until the last render of the data tree has finished.
+     *
+     * @param value variable value
+     */
+    void addValueView(string_view_t value);
+
     /**
      * @short Add value to list..
      * @param value variable value
@@ -199,6 +228,13 @@ public:
      */
     bool empty() const {return items.empty();}
 
+    /**
+     * @short Returns the memory resource the list allocates from.
+     */
+    std::pmr::memory_resource *arena() const {
+        return items.get_allocator().resource();
+    }
+
     /**
      * @short Returns iterator to first fragment item.
      */
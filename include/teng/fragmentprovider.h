@@ -0,0 +1,114 @@
+/*
+ * Teng -- a general purpose templating engine.
+ * Copyright (C) 2004  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Naskove 1, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:teng@firma.seznam.cz
+ *
+ *
+ * $Id: $
+ *
+ * DESCRIPTION
+ * Teng data types -- provider of lazily built fragments.
+ *
+ * AUTHORS
+ * Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * HISTORY
+ * 2026-10-16  (burlog)
+ *             Created.
+ */
+
+#ifndef TENGFRAGMENTPROVIDER_H
+#define TENGFRAGMENTPROVIDER_H
+
+#include <memory>
+#include <utility>
+#include <type_traits>
+
+namespace Teng {
+
+// forwards
+class FragmentList_t;
+
+/**
+ * @short Provider of the fragment list that is built when the template reads
+ * it for the first time.
+ *
+ * The provider is given to Fragment_t::addLazyFragmentList() instead of the
+ * list. The data of fragments that are never rendered (e.g. the ones in the
+ * disabled sections of template) are not fetched at all:
+ *
+ * root.addLazyFragmentList("comments", Teng::makeFragmentProvider(
+ *     [&] (Teng::FragmentList_t &list) {
+ *         for (auto &comment: backend.fetchComments(article_id))
+ *             list.addFragment().addVariable("text", comment.text);
+ *     }
+ * ));
+ *
+ * The provider is called at most once, the built list is kept in the data tree
+ * and the provider is destroyed right after. Since the provider is called
+ * during the page generation it must not modify other parts of the data tree.
+ * The exception thrown by the provider aborts the page generation and it is
+ * reported as fatal error; the next read calls the provider again.
+ */
+class FragmentProvider_t {
+public:
+    /** @short Destroy provider.
+     */
+    virtual ~FragmentProvider_t() = default;
+
+    /** @short Fills the empty list with fragments (or any other values).
+     *  Abstract, must be overloaded in subclass.
+     *  @param list the list that should be filled
+     */
+    virtual void materialize(FragmentList_t &list) = 0;
+};
+
+/**
+ * @short Provider calling given function.
+ */
+template <typename Fn_t>
+class FunctionFragmentProvider_t: public FragmentProvider_t {
+public:
+    /** @short Create new provider.
+     */
+    explicit FunctionFragmentProvider_t(Fn_t fn): fn(std::move(fn)) {}
+
+    /** @short Calls the function with the list that should be filled.
+     */
+    void materialize(FragmentList_t &list) override {fn(list);}
+
+protected:
+    Fn_t fn; //!< the function filling the list
+};
+
+/**
+ * @short Creates provider that calls given function to fill the list.
+ * @param fn function callable as fn(FragmentList_t &)
+ */
+template <typename Fn_t>
+std::unique_ptr<FragmentProvider_t> makeFragmentProvider(Fn_t &&fn) {
+    using Provider_t = FunctionFragmentProvider_t<std::decay_t<Fn_t>>;
+    return std::make_unique<Provider_t>(std::forward<Fn_t>(fn));
+}
+
+} // namespace Teng
+
+#endif /* TENGFRAGMENTPROVIDER_H */
+
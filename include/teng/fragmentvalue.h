@@ -42,10 +42,13 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <memory_resource>
 
 #include <teng/config.h>
+#include <teng/stringview.h>
 #include <teng/fragment.h>
 #include <teng/fragmentlist.h>
+#include <teng/fragmentprovider.h>
 
 namespace Teng {
 
@@ -59,6 +62,18 @@ struct TypeTag_t {};
  * @short Value in data tree.
  *
  * Shall be scalar (single data) or list of fragments.
+ *
+ * The string scalar is either owned (the value keeps its own copy) or borrowed
+ * (tag::string_view). The borrowed string refers to the memory of the caller
+ * that is never copied nor released by the value. The caller is responsible
+ * for keeping that memory valid and unchanged until the last render that uses
+ * the data tree has finished.
+ *
+ * The lazy value (tag::lazy) is the fragment list that is filled by the
+ * FragmentProvider_t when it is read for the first time, see materialize().
+ *
+ * The fragment list is allocated out of the value (from the arena of list), so
+ * the references to the list stay valid when the value is moved.
  */
 class FragmentValue_t {
 public:
@@ -67,7 +82,9 @@ public:
     FragmentValue_t &operator=(const FragmentValue_t &) = delete;
 
     // types
-    enum class tag {frag, frag_ptr, list, integral, real, string};
+    enum class tag {
+        frag, frag_ptr, list, integral, real, string, string_view, lazy
+    };
 
     /**
      * @short C'tor: move.
@@ -87,6 +104,14 @@ public:
         : tag_value(tag::string), string_value(std::move(value))
     {}
 
+    /**
+     * @short Create new scalar value that borrows given string.
+     * @param value value of variable (it has to outlive the renders)
+     */
+    FragmentValue_t(TypeTag_t<string_view_t>, string_view_t value) noexcept
+        : tag_value(tag::string_view), string_view_value(value)
+    {}
+
     /**
      * @short Create new scalar value with given value.
      * @param value value of variable
@@ -110,11 +135,9 @@ public:
     {}
 
     /**
-     * @short Create empty fragment list value.
+     * @short Create fragment list value.
      */
-    explicit FragmentValue_t(FragmentList_t &&value) noexcept
-        : tag_value(tag::list), list_value(std::move(value))
-    {}
+    explicit FragmentValue_t(FragmentList_t &&value);
 
     /** C'tor.
      */
@@ -122,12 +145,36 @@ public:
         : tag_value(tag::frag), frag_value()
     {}
 
+    /** C'tor: the fragment allocating from given arena.
+     */
+    FragmentValue_t(
+        TypeTag_t<Fragment_t>,
+        std::pmr::memory_resource *arena
+    ) noexcept: tag_value(tag::frag), frag_value(arena) {}
+
     /**
      * @short Create empty fragment list value.
      */
-    explicit FragmentValue_t(TypeTag_t<FragmentList_t>) noexcept
-        : tag_value(tag::list), list_value()
-    {}
+    explicit FragmentValue_t(TypeTag_t<FragmentList_t>);
+
+    /**
+     * @short Create empty fragment list value allocating from given arena.
+     */
+    FragmentValue_t(
+        TypeTag_t<FragmentList_t>,
+        std::pmr::memory_resource *arena
+    );
+
+    /**
+     * @short Create fragment list value that is filled by given provider
+     * when it is read for the first time.
+     * @param provider the provider of the list fragments
+     * @param arena the memory resource of the list
+     */
+    FragmentValue_t(
+        std::unique_ptr<FragmentProvider_t> provider,
+        std::pmr::memory_resource *arena = std::pmr::get_default_resource()
+    );
 
     /**
      * @short Destroy value.
@@ -155,6 +202,11 @@ public:
         std::enable_if_t<std::is_floating_point<type_t>::value, bool> = true
     > void setValue(type_t new_value) {setDouble(new_value);}
 
+    /**
+     * @short Sets value to string borrowed from the caller (not copied).
+     */
+    void setView(string_view_t new_value);
+
     /**
      * @short Sets value to int.
      */
@@ -203,6 +255,8 @@ public:
         case tag::integral: return true;
         case tag::real: return true;
         case tag::string: return true;
+        case tag::string_view: return true;
+        case tag::lazy: return false;
         }
     }
 
@@ -218,6 +272,16 @@ public:
      */
     tag type() const {return tag_value;}
 
+    /**
+     * @short Returns the value the lazy value stands for or this value if it
+     * isn't lazy.
+     *
+     * The provider of lazy value is called at the first call and the built
+     * list is kept for the following ones. The concurrent calls are safe, the
+     * provider is called only once.
+     */
+    const FragmentValue_t &materialize() const;
+
     /**
      * @short Returns pointer to scallar value or nullptr.
      */
@@ -225,6 +289,13 @@ public:
         return tag_value == tag::string? &string_value: nullptr;
     }
 
+    /**
+     * @short Returns pointer to borrowed scallar value or nullptr.
+     */
+    const string_view_t *view() const {
+        return tag_value == tag::string_view? &string_view_value: nullptr;
+    }
+
     /**
      * @short Returns pointer to scallar value or nullptr.
      */
@@ -243,7 +314,11 @@ public:
      * @short Returns pointer to list of values or nullptr.
      */
     const FragmentList_t *list() const {
-        return tag_value == tag::list? &list_value: nullptr;
+        switch (tag_value) {
+        case tag::list: return list_value;
+        case tag::lazy: return materialize().list_value;
+        default: return nullptr;
+        }
     }
 
     /**
@@ -275,26 +350,35 @@ protected:
 
     /**
      * @short Ensures that value is fragment list and if not then other value
-     * is destroyed and new empty fragment list is assigned to value and
-     * returned.
+     * is destroyed and new empty fragment list, allocating from given arena,
+     * is assigned to value and returned.
      */
-    FragmentList_t &ensureFragmentList();
+    FragmentList_t &ensureFragmentList(
+        std::pmr::memory_resource *arena = std::pmr::get_default_resource()
+    );
 
     /**
      * @short Ensures that value is fragment and if not then other value
-     * is destroyed and new empty fragment is assigned to value and
-     * returned.
+     * is destroyed and new empty fragment, allocating from given arena, is
+     * assigned to value and returned.
      */
-    Fragment_t &ensureFragment();
+    Fragment_t &ensureFragment(
+        std::pmr::memory_resource *arena = std::pmr::get_default_resource()
+    );
+
+    // the lazily built fragment list
+    struct Lazy_t;
 
     tag tag_value; //!< the type of value
     union {
         std::string string_value;    //!< string (scalar) value
         IntType_t integral_value;    //!< integral number (scalar) value
         double real_value;           //!< real number (scalar) value
-        FragmentList_t list_value;   //!< list of nested fragment values
+        FragmentList_t *list_value;  //!< list of nested fragment values
         Fragment_t frag_value;       //!< data fragment
         const Fragment_t *frag_ptr_value; //!< for data root
+        string_view_t string_view_value;  //!< borrowed string (scalar) value
+        std::unique_ptr<Lazy_t> lazy_value; //!< lazily built list of values
     };
 };
 
@@ -38,6 +38,7 @@
 #define TENGINVOKE_H
 
 #include <vector>
+#include <iterator>
 #include <stdexcept>
 
 #include <teng/value.h>
@@ -103,29 +104,95 @@ protected:
 using FunctionArgs_t = std::vector<Value_t>;
 using FunctionResult_t = Value_t;
 
+/** The read-only view of the function arguments that are stored on the value
+ * stack of the processor, so the call doesn't have to move them to new
+ * vector. The items are ordered in the same way as the items of
+ * FunctionArgs_t: the first item is the last argument of the call.
+ */
+class FunctionArgsView_t {
+public:
+    // types
+    using value_type = Value_t;
+    using size_type = std::size_t;
+    using const_reference = const Value_t &;
+    using const_iterator = std::reverse_iterator<const Value_t *>;
+    using iterator = const_iterator;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    using reverse_iterator = const_reverse_iterator;
+
+    /** C'tor.
+     *
+     * @param first the first argument of the call
+     * @param last one past the last argument of the call
+     */
+    FunctionArgsView_t(const Value_t *first, const Value_t *last)
+        : first(first), last(last)
+    {}
+
+    /** Returns the number of arguments.
+     */
+    size_type size() const {return static_cast<size_type>(last - first);}
+
+    /** Returns true if there is no argument.
+     */
+    bool empty() const {return first == last;}
+
+    /** Returns the i-th item (the i-th argument from the end).
+     */
+    const Value_t &operator[](size_type i) const {return *(last - 1 - i);}
+
+    /** Returns the first item (the last argument).
+     */
+    const Value_t &front() const {return *(last - 1);}
+
+    /** Returns the last item (the first argument).
+     */
+    const Value_t &back() const {return *first;}
+
+    /** Returns iterator to the first item (the last argument).
+     */
+    iterator begin() const {return iterator(last);}
+
+    /** Returns iterator one past the last item.
+     */
+    iterator end() const {return iterator(first);}
+
+    /** Returns iterator to the last item (the first argument).
+     */
+    reverse_iterator rbegin() const {return reverse_iterator(end());}
+
+    /** Returns iterator one past the first item.
+     */
+    reverse_iterator rend() const {return reverse_iterator(begin());}
+
+private:
+    const Value_t *first; //!< the first argument of the call
+    const Value_t *last;  //!< one past the last argument of the call
+};
+
 /** Invoker for teng builtin and user defined funtions.
  */
 template <typename function_type>
 struct Invoker_t {
     using Ctx_t = FunctionCtx_t;
     using Result_t = FunctionResult_t;
-    using Args_t = FunctionArgs_t;
 
     /** Invoking of functions that take context as first argument.
      */
-    template <typename call_t>
+    template <typename call_t, typename Args_t>
     auto invoke(const call_t &call, Ctx_t &ctx, const Args_t &args) const
     -> decltype(call(ctx, args)) {return call(ctx, args);}
 
     /** Invoking of functions that don't take context as first argument.
      */
-    template <typename call_t>
+    template <typename call_t, typename Args_t>
     auto invoke(const call_t &call, Ctx_t &, const Args_t &args) const
     -> decltype(call(args)) {return call(args);}
 
-    /** Invokes held function and translates all exceptions to errors.
+    /** Invokes held function and translates all exceptions to errors. The
+     * args are either FunctionArgs_t or FunctionArgsView_t.
      */
-    template <typename PCtx_t>
+    template <typename PCtx_t, typename Args_t>
     Result_t operator()(PCtx_t &pctx, Ctx_t &ctx, const Args_t &args) const {
         try {
             return invoke(function, ctx, args);
@@ -0,0 +1,197 @@
+/*
+ * Teng -- a general purpose templating engine.
+ * Copyright (C) 2004  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Naskove 1, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:teng@firma.seznam.cz
+ *
+ *
+ * $Id: $
+ *
+ * DESCRIPTION
+ * Teng profile -- the execution counters of template instructions.
+ *
+ * AUTHORS
+ * Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * HISTORY
+ * 2026-10-16  (burlog)
+ *             Created.
+ */
+
+#ifndef TENGPROFILE_H
+#define TENGPROFILE_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <iosfwd>
+
+#include <teng/error.h>
+
+namespace Teng {
+
+/** @short The profile of template rendering.
+ *
+ * The profile is filled by Teng_t::generatePage() and Teng_t::render() if
+ * it is passed to them. It contains the counters of each executed
+ * instruction of the compiled template with its position in template
+ * source, so the hot spots can be found in production without a native
+ * profiler. The profile accumulates the counters of all renders it has been
+ * passed to.
+ *
+ * The cycles are read from the CPU time stamp counter where it is available
+ * and they are nanoseconds elsewhere. Each instruction gets the time until
+ * the next instruction starts, so the jumps and function calls are
+ * accounted to the instruction that performs them.
+ *
+ * If the sample period is given the instructions aren't counted. Instead,
+ * the template stack is sampled at every period-th executed instruction:
+ * the include chain of the current source file, the names of the called
+ * blocks, the path of open fragments and the current source line. The
+ * samples can be written in the folded stack format that is accepted by
+ * the common flamegraph tools. Because the samples are taken by the number
+ * of instructions and not by time, an expensive function call counts as
+ * one instruction.
+ */
+class Profile_t {
+public:
+    /** @short Creates the profile.
+     *
+     * @param samplePeriod zero to count each instruction or the number of
+     *                     instructions between two samples of the stack
+     */
+    explicit Profile_t(uint64_t samplePeriod = 0)
+        : sample_period(samplePeriod)
+    {}
+
+    /** @short The counters of one profiled item.
+     */
+    struct Counters_t {
+        uint64_t executions = 0; //!< the number of executions
+        uint64_t cycles = 0;     //!< the number of spent cycles
+
+        /** Adds other counters to these ones.
+         */
+        Counters_t &operator+=(const Counters_t &other) {
+            executions += other.executions;
+            cycles += other.cycles;
+            return *this;
+        }
+    };
+
+    /** @short The counters of one instruction.
+     */
+    struct Instr_t {
+        Error_t::ErrorPos_t pos; //!< the position in template source
+        int64_t addr;            //!< the address in compiled program
+        std::string opcode;      //!< the name of instruction
+        Counters_t counters;     //!< the counters of instruction
+    };
+
+    /** @short The counters of all instructions with the same opcode.
+     */
+    struct Opcode_t {
+        std::string opcode;  //!< the name of instruction
+        Counters_t counters; //!< the sum of counters of the instructions
+    };
+
+    /** @short The counters of all instructions on the same source line.
+     */
+    struct Line_t {
+        std::string filename; //!< the template file path
+        int64_t lineno;       //!< the line number (starting with 1)
+        Counters_t counters;  //!< the sum of counters of the instructions
+    };
+
+    /** @short Adds the counters of instruction. The counters of the same
+     * instruction (position, address and opcode) are summed.
+     */
+    void add(const Instr_t &instr);
+
+    /** @short Returns the counters of the instructions ordered by source
+     * position and address.
+     */
+    const std::vector<Instr_t> &instructions() const {return instrs;}
+
+    /** @short Returns the counters summed by opcode ordered from the most
+     * expensive.
+     */
+    std::vector<Opcode_t> opcodes() const;
+
+    /** @short Returns the counters summed by source line ordered from the
+     * most expensive.
+     */
+    std::vector<Line_t> lines() const;
+
+    /** @short Returns the sum of counters of all instructions.
+     */
+    Counters_t total() const;
+
+    /** @short Returns the number of instructions between two samples or
+     * zero if the instructions are counted.
+     */
+    uint64_t samplePeriod() const {return sample_period;}
+
+    /** @short Adds the samples of the stack whose frames are separated by
+     * semicolons.
+     */
+    void addSample(const std::string &stack, uint64_t count = 1) {
+        stacks[stack] += count;
+    }
+
+    /** @short Returns the number of samples of each sampled stack.
+     */
+    const std::map<std::string, uint64_t> &samples() const {return stacks;}
+
+    /** @short Returns true if nothing has been profiled yet.
+     */
+    bool empty() const {return instrs.empty() && stacks.empty();}
+
+    /** @short Drops all counters and samples.
+     */
+    void clear() {instrs.clear(); stacks.clear();}
+
+    /** @short Appends the most expensive source lines to the error log as
+     * debug messages, so they can be reported the same way as the errors.
+     *
+     * @param err the error log
+     * @param limit the max number of reported lines
+     */
+    void log(Error_t &err, std::size_t limit = 10) const;
+
+    /** @short Writes the report (lines and opcodes) into stream.
+     */
+    void dump(std::ostream &out) const;
+
+    /** @short Writes the samples in the folded stack format: one stack per
+     * line followed by space and the number of its samples.
+     */
+    void dumpFolded(std::ostream &out) const;
+
+private:
+    uint64_t sample_period;                 //!< instructions between samples
+    std::vector<Instr_t> instrs;            //!< the counters of instructions
+    std::map<std::string, uint64_t> stacks; //!< the samples of stacks
+};
+
+} // namespace Teng
+
+#endif /* TENGPROFILE_H */
+
@@ -42,9 +42,11 @@
 #include <vector>
 #include <utility>
 #include <memory>
+#include <chrono>
 
 #include <teng/writer.h>
 #include <teng/error.h>
+#include <teng/profile.h>
 #include <teng/config.h>
 #include <teng/fragmentvalue.h>
 
@@ -53,20 +55,89 @@ namespace Teng {
 // forwards
 class FilesystemInterface_t;
 
+/** @short Template prepared for repeated rendering.
+ *
+ * It holds the compiled program, the dictionary and the configuration of the
+ * template, so rendering of the handle does not have to build cache keys and
+ * does no cache lookups unless the watchFiles feature is enabled. See
+ * Teng_t::prepare() and Teng_t::render().
+ */
+class TemplateHandle_t {
+public:
+    /** @short Create empty (invalid) handle.
+     */
+    TemplateHandle_t() = default;
+
+    /** @short Returns true if handle holds prepared template.
+     */
+    explicit operator bool() const {return static_cast<bool>(p);}
+
+private:
+    friend class Teng_t;
+    struct PTemplateHandle_t;
+    std::shared_ptr<const PTemplateHandle_t> p;
+};
+
 
 /** @short Templating engine.
+ *
+ * The engine is thread safe: one instance can be shared by many threads that
+ * generate pages concurrently. Use Settings_t::cacheShards to lower the
+ * contention on the template cache if there are lots of threads.
  */
 class Teng_t {
 public:
     /** @short Templating engine settings.
      */
     struct Settings_t {
-        explicit Settings_t(uint32_t prgCSize = 0, uint32_t dictCSize = 0)
-            : programCacheSize(prgCSize), dictCacheSize(dictCSize)
+        explicit Settings_t(
+            uint32_t prgCSize = 0,
+            uint32_t dictCSize = 0,
+            uint32_t cacheShards = 0,
+            std::size_t prgCBytes = 0,
+            std::size_t dictCBytes = 0,
+            const std::string &bytecodeDir = std::string(),
+            std::size_t sharedCacheBytes = 0
+        ): programCacheSize(prgCSize), dictCacheSize(dictCSize),
+           cacheShards(cacheShards), programCacheBytes(prgCBytes),
+           dictCacheBytes(dictCBytes), bytecodeDir(bytecodeDir),
+           sharedCacheBytes(sharedCacheBytes)
         {}
         // NOTE(burlog): zero is replaced by default size (50) in Cache_t
         uint32_t programCacheSize; //!< the max number of cached templates
         uint32_t dictCacheSize;    //!< the max number of cached dicts
+        // zero means one shard; the cache sizes are split among the shards
+        uint32_t cacheShards;      //!< the number of locked cache shards
+        // zero means unlimited; the least recently used entries are evicted
+        // when the memory occupied by cached objects exceeds the budget
+        std::size_t programCacheBytes; //!< the memory budget for templates
+        std::size_t dictCacheBytes;    //!< the memory budget for dicts/configs
+        // empty means disabled; the directory has to exist and be writable,
+        // the compiled templates are stored there and loaded instead of the
+        // compilation in other processes while their sources are unchanged
+        std::string bytecodeDir;       //!< the directory of compiled templates
+        // zero means disabled; the compiled templates are stored in shared
+        // memory that is shared by the processes forked after the engine
+        // has been created; it takes precedence over the bytecodeDir
+        std::size_t sharedCacheBytes;  //!< the size of shared memory
+    };
+
+    /** @short Statistics of one cache.
+     */
+    struct CacheStats_t {
+        std::size_t bytes = 0;   //!< memory occupied by the cached objects
+        std::size_t entries = 0; //!< the number of cached objects
+        uint64_t hits = 0;       //!< the number of successful lookups
+        uint64_t misses = 0;     //!< the number of failed lookups
+        uint64_t evictions = 0;  //!< the number of evicted objects
+    };
+
+    /** @short Statistics of the engine caches.
+     */
+    struct TemplateCacheStats_t {
+        CacheStats_t programs;       //!< the compiled templates
+        CacheStats_t dictionaries;   //!< the language dictionaries
+        CacheStats_t configurations; //!< the configurations (params)
     };
 
     /** @short Create new engine.
@@ -108,13 +179,16 @@ public:
      * @param args The arguments structure.
      * @param writer output writer (page destinatin)
      * @param err error log
+     * @param profile if not null the counters of executed instructions are
+     *                added to it (the rendering is slower)
      * @return 0 OK, !0 error
      */
     int generatePage(
         const GenPageArgs_t &args,
         const Fragment_t &data,
         Writer_t &writer,
-        Error_t &err
+        Error_t &err,
+        Profile_t *profile = nullptr
     ) const;
 
     /** @short Generate page from file template.
@@ -197,13 +271,88 @@ public:
         );
     }
 
+    /** @short Prepare template for repeated rendering.
+     *
+     * The template is compiled (or taken from the cache) once and the handle
+     * keeps it alive for its lifetime. Errors of the compilation are logged
+     * into the err.
+     *
+     * @param args The arguments structure.
+     * @param err error log
+     * @return handle of prepared template
+     */
+    TemplateHandle_t prepare(const GenPageArgs_t &args, Error_t &err) const;
+
+    /** @short Generate page from prepared template.
+     *
+     * If watchFiles feature is enabled in the template configuration then
+     * the sources are revalidated through the cache as generatePage does,
+     * otherwise the prepared program is rendered directly.
+     *
+     * @param handle prepared template
+     * @param data data tree
+     * @param writer output writer (page destinatin)
+     * @param err error log
+     * @param profile if not null the counters of executed instructions are
+     *                added to it (the rendering is slower)
+     * @return 0 OK, !0 error
+     */
+    int render(
+        const TemplateHandle_t &handle,
+        const Fragment_t &data,
+        Writer_t &writer,
+        Error_t &err,
+        Profile_t *profile = nullptr
+    ) const;
+
+    /** @short Result of one template preloading.
+     */
+    struct PreloadResult_t {
+        std::chrono::microseconds duration; //!< the time of preparation
+        std::vector<Error_t::Entry_t> errors; //!< the compilation errors
+    };
+
+    /** @short Compiles templates into the program cache.
+     *
+     * It's intended for warming up the cache before the process starts to
+     * serve requests. The templates are prepared in parallel by given number
+     * of threads (zero means the number of CPUs). The duration includes the
+     * loading of the dictionary and configuration if they aren't cached yet,
+     * and it is short for templates that are already in the cache. Make sure
+     * that the cache is big enough to hold all the preloaded templates.
+     *
+     * @param args the list of templates
+     * @param threads the number of threads
+     * @return the results in the order of args
+     */
+    std::vector<PreloadResult_t>
+    preload(
+        const std::vector<GenPageArgs_t> &args,
+        unsigned int threads = 0
+    ) const;
+
+    /** @short Returns statistics of the template caches.
+     *
+     * The values of each cache are consistent but the caches are read one
+     * after another while other threads can use them.
+     *
+     * @return the statistics
+     */
+    TemplateCacheStats_t getCacheStats() const;
+
     /** @short Find entry in dictionary.
+     *
+     *  The returned pointer refers to the cached dictionary that can be
+     *  released by the cache eviction or reload in other thread at any time,
+     *  so it is unsafe when the engine is shared by more threads. Use the
+     *  overload copying the value instead.
+     *
      *  @param params params dictionary path
      *  @param dict language dictionary path
      *  @param lang language
      *  @param key name of entry
      */
-    const std::string *
+    [[deprecated]] const std::string *
     dictionaryLookup(
         const std::string &params,
         const std::string &dict,
@@ -218,9 +367,19 @@ public:
     static std::vector<std::pair<std::string, std::string>>
     listSupportedContentTypes();
 
-    /** Deprecated version of dictionaryLookup.
+    /** @short Find entry in dictionary and copy its value to result.
+     *
+     *  The value is copied while the dictionary is held, so it is safe to
+     *  call it from more threads sharing the engine.
+     *
+     *  @param params params dictionary path
+     *  @param dict language dictionary path
+     *  @param lang language
+     *  @param key name of entry
+     *  @param result the value of entry (cleared if not found)
+     *  @return 0 if entry has been found, -1 otherwise
      */
-    [[deprecated]] int
+    int
     dictionaryLookup(
         const std::string &params,
         const std::string &dict,
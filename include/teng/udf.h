@@ -52,11 +52,24 @@ namespace udf {
 
 // List of values are udf arguments.
 using Args_t = FunctionArgs_t;
+using ArgsView_t = FunctionArgsView_t;
 using Result_t = FunctionResult_t;
 
 // Type for user defined functions.
 using Function_t = std::function<Result_t(const Args_t &)>;
 
+// Type for user defined functions that take the args without copying them.
+using ViewFunction_t = std::function<Result_t(const ArgsView_t &)>;
+
+/**
+ * @short The registered user-defined function. Exactly one of the members is
+ * set depending on the way the function has been registered.
+ */
+struct Slot_t {
+    Function_t function;          //!< the function taking args in vector
+    ViewFunction_t view_function; //!< the function taking view of args
+};
+
 /**
  * @short Registers user-defined function.
  * @param name name of the function (without udf.prefix)
@@ -64,12 +77,36 @@ using Function_t = std::function<Result_t(const Args_t &)>;
  */
 void registerFunction(const std::string &name, Function_t udf);
 
+/**
+ * @short Registers user-defined function that gets the view of args instead
+ * of the vector, so no vector is built for the call. The view is valid only
+ * during the call.
+ * @param name name of the function (without udf.prefix)
+ * @param udf user-defined callable object
+ */
+void registerViewFunction(const std::string &name, ViewFunction_t udf);
+
 /**
  * @short finds function in global UDF list, returns pointer or 0
  * @param name name of the function (with udf. prefix)
  */
 Invoker_t<Function_t> findFunction(const std::string &name);
 
+/**
+ * @short Finds function in global UDF list, returns it as the function
+ * taking view of args or empty function.
+ * @param name name of the function (with udf. prefix)
+ */
+Invoker_t<ViewFunction_t> findViewFunction(const std::string &name);
+
+/**
+ * @short Finds function in global UDF list, returns pointer to it or 0. The
+ * function registered once is never replaced nor removed, so the pointer
+ * can be used without locking the list until the program exits.
+ * @param name name of the function (with udf. prefix)
+ */
+const Slot_t *findSlot(const std::string &name);
+
 } // namespace udf
 } // namespace Teng
 
@@ -149,9 +149,9 @@ public:
         : tag_value(tag::list_ref), list_ref_value({value, i})
     {}
 
-    /** C'tor: fragment value.
+    /** C'tor: fragment value (the lazy value is materialized).
      */
-    explicit Value_t(const FragmentValue_t *value) noexcept;
+    explicit Value_t(const FragmentValue_t *value);
 
     /** C'tor: copy.
      */
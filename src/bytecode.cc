@@ -0,0 +1,575 @@
+/*
+ * Teng -- a general purpose templating engine.
+ * Copyright (C) 2004  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Naskove 1, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:teng@firma.seznam.cz
+ *
+ *
+ * $Id: $
+ *
+ * DESCRIPTION
+ * Teng persistent bytecode -- implementation.
+ *
+ * AUTHORS
+ * Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * HISTORY
+ * 2026-10-16  (burlog)
+ *             Created.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <system_error>
+
+#include "regex.h"
+#include "program.h"
+#include "bytecode.h"
+#include "stackdepth.h"
+#include "util.h"
+
+namespace Teng {
+namespace {
+
+/** The first bytes of each bytecode file ("TENG" in little endian).
+ */
+constexpr uint32_t MAGIC = 0x474e4554;
+
+/** The index of source for positions without filename.
+ */
+constexpr uint32_t NO_SOURCE = uint32_t(-1);
+
+/** FNV-1a hash of the data; detects the damaged files.
+ */
+uint64_t checksum(const char *ptr, const char *end) {
+    uint64_t result = 0xcbf29ce484222325ull;
+    for (; ptr != end; ++ptr) {
+        result ^= static_cast<unsigned char>(*ptr);
+        result *= 0x100000001b3ull;
+    }
+    return result;
+}
+
+/** Packs regex flags into one byte.
+ */
+uint8_t pack(regex_flags_t flags) {
+    return static_cast<uint8_t>(
+        (flags->ignore_case << 0)
+        | (flags->global << 1)
+        | (flags->multiline << 2)
+        | (flags->extended << 3)
+        | (flags->extra << 4)
+        | (flags->ungreedy << 5)
+        | (flags->anchored << 6)
+        | (flags->dollar_endonly << 7)
+    );
+}
+
+/** Unpacks regex flags from one byte.
+ */
+regex_flags_t unpack(uint8_t raw) {
+    regex_flags_t flags;
+    flags->ignore_case = raw & (1 << 0);
+    flags->global = raw & (1 << 1);
+    flags->multiline = raw & (1 << 2);
+    flags->extended = raw & (1 << 3);
+    flags->extra = raw & (1 << 4);
+    flags->ungreedy = raw & (1 << 5);
+    flags->anchored = raw & (1 << 6);
+    flags->dollar_endonly = raw & (1 << 7);
+    return flags;
+}
+
+/** Writes filenames and hashes of sources.
+ */
+void write_sources(BytecodeWriter_t &out, const SourceList_t &sources) {
+    out.write(static_cast<uint32_t>(sources.size()));
+    for (auto &source: sources) {
+        uint64_t hash = source->hash;
+        out(source->filename, hash);
+    }
+}
+
+/** Reads filenames and hashes of sources and returns true if they are the
+ * same as given sources.
+ */
+bool read_sources(BytecodeReader_t &in, const SourceList_t &sources) {
+    bool result = in.get<uint32_t>() == sources.size();
+    for (auto isource = sources.begin(); result && isource != sources.end();) {
+        auto filename = in.get<std::string>();
+        auto hash = in.get<uint64_t>();
+        auto &source = **isource++;
+        result = (filename == source.filename) && (hash == source.hash);
+    }
+    return result;
+}
+
+/** The read only memory mapping of whole file.
+ */
+struct Mapping_t {
+    Mapping_t(const std::string &path): ptr(MAP_FAILED), size(0) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return;
+        struct stat buf;
+        if (!::fstat(fd, &buf) && buf.st_size > 0) {
+            size = static_cast<std::size_t>(buf.st_size);
+            ptr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        ::close(fd);
+    }
+    ~Mapping_t() {if (ptr != MAP_FAILED) ::munmap(ptr, size);}
+    Mapping_t(const Mapping_t &) = delete;
+    Mapping_t &operator=(const Mapping_t &) = delete;
+    explicit operator bool() const {return ptr != MAP_FAILED;}
+    const char *data() const {return static_cast<const char *>(ptr);}
+    void *ptr;        //!< the first byte of mapped file
+    std::size_t size; //!< the size of mapped file
+};
+
+} // namespace
+
+void BytecodeWriter_t::write(const std::string &value) {
+    uint64_t size = value.size();
+    write(size);
+    buffer.append(value);
+}
+
+void BytecodeWriter_t::write(const Pos_t &value) {
+    uint32_t index = NO_SOURCE;
+    for (std::size_t i = 0; i < sources.size(); ++i) {
+        if (sources[i] == value.filename || *sources[i] == *value.filename) {
+            index = static_cast<uint32_t>(i);
+            break;
+        }
+    }
+    if ((index == NO_SOURCE) && (value.filename != Pos_t::no_filename()))
+        throw bad_bytecode_t("unknown source '" + *value.filename + "'");
+    (*this)(index, value.lineno, value.colno);
+}
+
+void BytecodeWriter_t::write(const Value_t &value) {
+    // string references are stored as strings
+    auto type = value.is_string_ref()? Value_t::tag::string: value.type();
+    write(static_cast<uint8_t>(type));
+    switch (value.type()) {
+    case Value_t::tag::undefined:
+        break;
+    case Value_t::tag::integral:
+        write(value.as_int());
+        break;
+    case Value_t::tag::real:
+        write(value.as_real());
+        break;
+    case Value_t::tag::string:
+        write(value.as_string());
+        break;
+    case Value_t::tag::string_ref:
+        write(value.as_string_ref().str());
+        break;
+    case Value_t::tag::regex:
+        write(value.as_regex());
+        break;
+    case Value_t::tag::frag_ref:
+    case Value_t::tag::list_ref:
+        throw bad_bytecode_t("fragment literal can't be serialized");
+    }
+}
+
+void BytecodeWriter_t::write(const counted_ptr<Regex_t> &value) {
+    (*this)(value->pattern(), pack(value->flags()));
+}
+
+void BytecodeWriter_t::write(const ContentType_t::Descriptor_t *value) {
+    write(value? value->name: std::string());
+}
+
+const char *BytecodeReader_t::consume(std::size_t size) {
+    if (std::size_t(end - ptr) < size)
+        throw bad_bytecode_t("unexpected end of data");
+    auto *result = ptr;
+    ptr += size;
+    return result;
+}
+
+void BytecodeReader_t::read(std::string &value) {
+    auto size = get<uint64_t>();
+    auto *data = consume(size);
+    value.assign(data, size);
+}
+
+void BytecodeReader_t::read(Pos_t &value) {
+    auto index = get<uint32_t>();
+    auto lineno = get<int64_t>();
+    auto colno = get<int64_t>();
+    if ((index != NO_SOURCE) && (index >= sources.size()))
+        throw bad_bytecode_t("invalid source index");
+    value = index == NO_SOURCE
+        ? Pos_t(lineno, colno)
+        : Pos_t(sources[index], lineno, colno);
+}
+
+void BytecodeReader_t::read(Value_t &value) {
+    switch (static_cast<Value_t::tag>(get<uint8_t>())) {
+    case Value_t::tag::undefined:
+        value = Value_t();
+        break;
+    case Value_t::tag::integral:
+        value = Value_t(get<Value_t::int_type>());
+        break;
+    case Value_t::tag::real:
+        value = Value_t(get<Value_t::real_type>());
+        break;
+    case Value_t::tag::string:
+        value = Value_t(get<std::string>());
+        break;
+    case Value_t::tag::regex:
+        value = Value_t(get<counted_ptr<Regex_t>>());
+        break;
+    default:
+        throw bad_bytecode_t("invalid value type");
+    }
+}
+
+void BytecodeReader_t::read(counted_ptr<Regex_t> &value) {
+    auto pattern = get<std::string>();
+    auto flags = unpack(get<uint8_t>());
+    value = make_counted<Regex_t>(pattern, flags);
+}
+
+void BytecodeReader_t::read(const ContentType_t::Descriptor_t *&value) {
+    auto name = get<std::string>();
+    value = nullptr;
+    if (name.empty()) return;
+    value = ContentType_t::find(name);
+    if (!value) throw bad_bytecode_t("unknown content type '" + name + "'");
+}
+
+std::string
+serializeProgram(
+    const std::string &key,
+    const Program_t &program,
+    const std::vector<const SourceList_t *> &deps
+) {
+    BytecodeWriter_t out(program.getSources());
+    out(MAGIC, BytecodeStore_t::VERSION, key);
+
+    // the sources of program and its dependencies
+    write_sources(out, program.getSources());
+    out.write(static_cast<uint32_t>(deps.size()));
+    for (auto *sources: deps) write_sources(out, *sources);
+
+    // the positions the sources are included from
+    out.write(static_cast<uint32_t>(program.getIncludes().size()));
+    for (auto &include: program.getIncludes())
+        out(Pos_t(include.first), include.second);
+
+    // the instructions
+    uint64_t program_size = program.size();
+    out.write(program_size);
+    for (std::size_t i = 0; i < program.size(); ++i) {
+        out(static_cast<uint8_t>(program[i].opcode()), program.pos(i));
+        program[i].write_params(out);
+    }
+
+    // the checksum of all the above
+    auto &data = out.data();
+    out.write(checksum(data.data(), data.data() + data.size()));
+    return out.data();
+}
+
+std::unique_ptr<Program_t>
+deserializeProgram(
+    Error_t &err,
+    const FilesystemInterface_t *filesystem,
+    const std::string &key,
+    const char *data,
+    std::size_t size,
+    const std::vector<const SourceList_t *> &deps
+) {
+    auto program = std::make_unique<Program_t>(err);
+    auto &sources = program->getSources();
+
+    // check the header and the checksum
+    uint64_t expected_checksum;
+    if (size < sizeof(expected_checksum))
+        throw bad_bytecode_t("unexpected end of data");
+    auto *end = data + size - sizeof(expected_checksum);
+    std::memcpy(&expected_checksum, end, sizeof(expected_checksum));
+    BytecodeReader_t in(data, end, sources, program->pool());
+    if (in.get<uint32_t>() != MAGIC) throw bad_bytecode_t("invalid magic");
+    if (in.get<uint32_t>() != BytecodeStore_t::VERSION) return nullptr;
+    if (checksum(data, end) != expected_checksum)
+        throw bad_bytecode_t("checksum mismatch");
+    if (in.get<std::string>() != key) return nullptr;
+
+    // the sources of program have to be unchanged
+    for (auto count = in.get<uint32_t>(); count; --count) {
+        auto filename = in.get<std::string>();
+        auto hash = in.get<uint64_t>();
+        auto index = program->addSource(filesystem, filename).second;
+        if ((*(sources.begin() + index))->hash != hash) return nullptr;
+    }
+
+    // the program has to be compiled with the same dict and config
+    if (in.get<uint32_t>() != deps.size()) return nullptr;
+    for (auto *dep_sources: deps)
+        if (!read_sources(in, *dep_sources)) return nullptr;
+
+    // the positions the sources are included from
+    for (auto count = in.get<uint32_t>(); count; --count) {
+        auto source = in.get<Pos_t>();
+        program->addInclude(source.filename, in.get<Pos_t>());
+    }
+
+    // the instructions
+    for (auto count = in.get<uint64_t>(); count; --count) {
+        auto opcode = static_cast<OPCODE>(in.get<uint8_t>());
+        auto pos = in.get<Pos_t>();
+        program->push_back(pos, InstrBox_t::read(opcode, in));
+    }
+    if (!in.eof()) throw bad_bytecode_t("trailing data");
+
+    // the stack depth isn't stored, it also validates the loaded program
+    try {
+        program->setMaxStackDepth(max_stack_depth(*program));
+    } catch (const bad_stack_depth_t &e) {
+        throw bad_bytecode_t(e.what());
+    }
+    program->shrink_to_fit();
+    return program;
+}
+
+std::unique_ptr<Program_t>
+BytecodeStore_t::load(
+    Error_t &err,
+    const FilesystemInterface_t *filesystem,
+    const std::string &key,
+    const std::vector<const SourceList_t *> &deps
+) const {
+    std::unique_ptr<Program_t> program;
+    read(key, [&] (const char *data, std::size_t size) {
+        try {
+            program = deserializeProgram(err, filesystem, key, data, size, deps);
+        } catch (const std::exception &) {
+            // damaged or stale bytecode (e.g. the source has gone)
+        }
+    });
+    return program;
+}
+
+bool BytecodeStore_t::save(
+    const std::string &key,
+    const Program_t &program,
+    const std::vector<const SourceList_t *> &deps
+) const {
+    std::string data;
+    try {
+        data = serializeProgram(key, program, deps);
+    } catch (const std::exception &) {
+        return false;
+    }
+    return write(key, data);
+}
+
+std::string BytecodeDirectory_t::path(const std::string &key) const {
+    return dir + "/" + MD5Hexdigest(key) + ".tengc";
+}
+
+void BytecodeDirectory_t::read(
+    const std::string &key,
+    const Reader_t &reader
+) const {
+    Mapping_t mapping(path(key));
+    if (mapping) reader(mapping.data(), mapping.size);
+}
+
+bool BytecodeDirectory_t::write(
+    const std::string &key,
+    const std::string &data
+) const {
+    // write the data to temporary file
+    auto filename = path(key);
+    std::string tmp = filename + ".XXXXXX";
+    int fd = ::mkstemp(&tmp[0]);
+    if (fd < 0) return false;
+    for (const char *ptr = data.data(), *end = ptr + data.size(); ptr < end;) {
+        auto written = ::write(fd, ptr, std::size_t(end - ptr));
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            ::close(fd);
+            ::unlink(tmp.c_str());
+            return false;
+        }
+        ptr += written;
+    }
+    ::close(fd);
+
+    // and replace the old file at once
+    if (std::rename(tmp.c_str(), filename.c_str())) {
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+/** The slot of the table of stored programs.
+ */
+struct SharedBytecodeArena_t::Slot_t {
+    uint64_t hash;   //!< the hash of key (zero means free slot)
+    uint64_t offset; //!< where the bytecode starts in the data area
+    uint64_t size;   //!< the size of bytecode
+};
+
+/** The start of the arena that is followed by the slots and data area.
+ */
+struct SharedBytecodeArena_t::Header_t {
+    pthread_mutex_t mutex; //!< guards the whole arena
+    uint64_t slots;        //!< the number of slots
+    uint64_t capacity;     //!< the size of data area
+    uint64_t used;         //!< the used bytes of data area
+    uint64_t resets;       //!< how many times the arena has been dropped
+
+    /** Returns the first slot.
+     */
+    Slot_t *table() {return reinterpret_cast<Slot_t *>(this + 1);}
+
+    /** Returns the first byte of data area.
+     */
+    char *data() {return reinterpret_cast<char *>(table() + slots);}
+};
+
+/** Locks the arena mutex. If the process holding the mutex died the arena
+ * is dropped because it could be left inconsistent.
+ */
+class SharedBytecodeArena_t::Lock_t {
+public:
+    Lock_t(const SharedBytecodeArena_t *arena): arena(arena) {
+        if (::pthread_mutex_lock(&arena->header->mutex) == EOWNERDEAD) {
+            arena->reset();
+            ::pthread_mutex_consistent(&arena->header->mutex);
+        }
+    }
+    ~Lock_t() {::pthread_mutex_unlock(&arena->header->mutex);}
+    Lock_t(const Lock_t &) = delete;
+    Lock_t &operator=(const Lock_t &) = delete;
+
+private:
+    const SharedBytecodeArena_t *arena; //!< the locked arena
+};
+
+SharedBytecodeArena_t::SharedBytecodeArena_t(std::size_t bytes)
+    : header(nullptr), size(std::max(bytes, std::size_t(64 * 1024)))
+{
+    auto *ptr = ::mmap(
+        nullptr,
+        size,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS,
+        -1,
+        0
+    );
+    if (ptr == MAP_FAILED)
+        throw std::system_error(errno, std::system_category(), "mmap");
+    header = static_cast<Header_t *>(ptr);
+
+    // the mutex has to work across processes and survive their deaths
+    pthread_mutexattr_t attr;
+    ::pthread_mutexattr_init(&attr);
+    ::pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    ::pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    ::pthread_mutex_init(&header->mutex, &attr);
+    ::pthread_mutexattr_destroy(&attr);
+
+    // one slot per each 4KiB of the arena (the memory is zeroed by mmap)
+    header->slots = std::min(size / 4096, std::size_t(64 * 1024));
+    header->capacity = size - sizeof(Header_t) - header->slots * sizeof(Slot_t);
+}
+
+SharedBytecodeArena_t::~SharedBytecodeArena_t() {
+    ::munmap(header, size);
+}
+
+uint64_t SharedBytecodeArena_t::resets() const {
+    Lock_t lock(this);
+    return header->resets;
+}
+
+SharedBytecodeArena_t::Slot_t *SharedBytecodeArena_t::find(uint64_t hash) const {
+    auto *table = header->table();
+    for (uint64_t i = 0; i < header->slots; ++i) {
+        auto &slot = table[(hash + i) % header->slots];
+        if (!slot.hash || (slot.hash == hash)) return &slot;
+    }
+    return nullptr;
+}
+
+void SharedBytecodeArena_t::reset() const {
+    std::fill(header->table(), header->table() + header->slots, Slot_t{});
+    header->used = 0;
+    ++header->resets;
+}
+
+void SharedBytecodeArena_t::read(
+    const std::string &key,
+    const Reader_t &reader
+) const {
+    // copy the bytecode, so the lock isn't held during deserialization
+    std::string data;
+    {
+        Lock_t lock(this);
+        auto *slot = find(checksum(key.data(), key.data() + key.size()) | 1);
+        if (!slot || !slot->hash) return;
+        data.assign(header->data() + slot->offset, slot->size);
+    }
+    reader(data.data(), data.size());
+}
+
+bool SharedBytecodeArena_t::write(
+    const std::string &key,
+    const std::string &data
+) const {
+    // the zero hash marks the free slots
+    auto hash = checksum(key.data(), key.data() + key.size()) | 1;
+    if (data.size() > header->capacity) return false;
+
+    // drop all programs if there is no space for the new one
+    Lock_t lock(this);
+    auto *slot = find(hash);
+    if (!slot || (data.size() > (header->capacity - header->used))) {
+        reset();
+        slot = find(hash);
+    }
+
+    // the space of replaced program is reclaimed by the next reset
+    std::memcpy(header->data() + header->used, data.data(), data.size());
+    *slot = {hash, header->used, data.size()};
+    header->used += data.size();
+    return true;
+}
+
+} // namespace Teng
+
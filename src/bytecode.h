@@ -0,0 +1,405 @@
+/*
+ * Teng -- a general purpose templating engine.
+ * Copyright (C) 2004  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Naskove 1, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:teng@firma.seznam.cz
+ *
+ *
+ * $Id: $
+ *
+ * DESCRIPTION
+ * Teng persistent bytecode -- serialization of compiled programs.
+ *
+ * AUTHORS
+ * Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * HISTORY
+ * 2026-10-16  (burlog)
+ *             Created.
+ */
+
+#ifndef TENGBYTECODE_H
+#define TENGBYTECODE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <functional>
+#include <type_traits>
+
+#include "contenttype.h"
+#include "constantpool.h"
+#include "sourcelist.h"
+#include "teng/value.h"
+#include "teng/error.h"
+#include "teng/counted_ptr.h"
+
+namespace Teng {
+
+// forwards
+class Regex_t;
+class Program_t;
+struct Pos_t;
+
+/** Thrown if the bytecode is corrupted or the program can't be serialized.
+ */
+struct bad_bytecode_t: public std::runtime_error {
+    bad_bytecode_t(const std::string &what)
+        : std::runtime_error("invalid bytecode: " + what)
+    {}
+};
+
+/** Serializes the values into the binary buffer.
+ *
+ * The bytecode is only the cache of compiled programs that is read by the
+ * same build of the engine on the same machine, so the numbers are stored
+ * in their native representation.
+ */
+class BytecodeWriter_t {
+public:
+    /** C'tor.
+     *
+     * @param sources the sources that positions are pointing to
+     */
+    BytecodeWriter_t(const SourceList_t &sources)
+        : sources(sources), buffer()
+    {}
+
+    /** Writes all given values.
+     */
+    template <typename... types_t>
+    void operator()(const types_t &...values) {(write(values), ...);}
+
+    /** Writes number.
+     */
+    template <
+        typename type_t,
+        std::enable_if_t<std::is_arithmetic_v<type_t>, bool> = true
+    > void write(type_t value) {
+        buffer.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    /** Writes string.
+     */
+    void write(const std::string &value);
+
+    /** Writes string from the constant pool.
+     */
+    void write(const std::string *value) {write(*value);}
+
+    /** Writes position as index of source file and line and column.
+     */
+    void write(const Pos_t &value);
+
+    /** Writes literal value (only literals that can appear in program).
+     */
+    void write(const Value_t &value);
+
+    /** Writes literal value from the constant pool.
+     */
+    void write(const Value_t *value) {write(*value);}
+
+    /** Writes regular expression as pattern and flags.
+     */
+    void write(const counted_ptr<Regex_t> &value);
+
+    /** Writes content type as its name.
+     */
+    void write(const ContentType_t::Descriptor_t *value);
+
+    /** Returns the serialized data.
+     */
+    const std::string &data() const {return buffer;}
+
+private:
+    const SourceList_t &sources; //!< the sources that positions point to
+    std::string buffer;          //!< the serialized data
+};
+
+/** Deserializes the values from the binary buffer written by
+ * BytecodeWriter_t. Throws bad_bytecode_t if the data are truncated or
+ * corrupted.
+ */
+class BytecodeReader_t {
+public:
+    /** C'tor.
+     *
+     * @param ptr the first byte of the data
+     * @param end one past the last byte of the data
+     * @param sources the sources that positions are pointing to
+     * @param constants the pool where the instruction operands are stored
+     */
+    BytecodeReader_t(
+        const char *ptr,
+        const char *end,
+        const SourceList_t &sources,
+        ConstantPool_t &constants
+    ): sources(sources), constants(constants), ptr(ptr), end(end)
+    {}
+
+    /** Reads all given values.
+     */
+    template <typename... types_t>
+    void operator()(types_t &...values) {(read(values), ...);}
+
+    /** Reads number.
+     */
+    template <
+        typename type_t,
+        std::enable_if_t<std::is_arithmetic_v<type_t>, bool> = true
+    > void read(type_t &value) {
+        std::memcpy(&value, consume(sizeof(value)), sizeof(value));
+    }
+
+    /** Reads string.
+     */
+    void read(std::string &value);
+
+    /** Reads string into the constant pool.
+     */
+    void read(const std::string *&value) {
+        value = constants.string(get<std::string>());
+    }
+
+    /** Reads position.
+     */
+    void read(Pos_t &value);
+
+    /** Reads literal value.
+     */
+    void read(Value_t &value);
+
+    /** Reads literal value into the constant pool.
+     */
+    void read(Value_t *&value) {value = constants.value(get<Value_t>());}
+
+    /** Reads and compiles regular expression.
+     */
+    void read(counted_ptr<Regex_t> &value);
+
+    /** Reads content type.
+     */
+    void read(const ContentType_t::Descriptor_t *&value);
+
+    /** Returns the value of given type.
+     */
+    template <typename type_t>
+    type_t get() {type_t value{}; read(value); return value;}
+
+    /** Returns true if all data has been read.
+     */
+    bool eof() const {return ptr == end;}
+
+    /** Returns the pool where the instruction operands are stored.
+     */
+    ConstantPool_t &pool() {return constants;}
+
+private:
+    /** Returns pointer to next size bytes and moves behind them.
+     */
+    const char *consume(std::size_t size);
+
+    const SourceList_t &sources; //!< the sources that positions point to
+    ConstantPool_t &constants;   //!< the storage of instruction operands
+    const char *ptr;             //!< the current position in data
+    const char *end;             //!< one past the last byte of data
+};
+
+/** The storage of serialized programs shared by engines.
+ *
+ * The stored bytecode contains the sources of the program with their
+ * hashes and the hashes of the sources of dictionary and configuration the
+ * program has been compiled with. The program is loaded only if all the
+ * hashes still match, so other engine can skip the compilation.
+ */
+class BytecodeStore_t {
+public:
+    /** The version of the bytecode format. Increment it whenever
+     * instructions or their params change.
+     */
+    static constexpr uint32_t VERSION = 4;
+
+    /** D'tor.
+     */
+    virtual ~BytecodeStore_t() = default;
+
+    /** Loads the program stored for given key.
+     *
+     * @param err the error log of the loaded program
+     * @param filesystem the filesystem used to check the template sources
+     * @param key the unique key of the program
+     * @param deps the sources of dictionary and configuration
+     * @return the program or null if it is missing, stale or corrupted
+     */
+    std::unique_ptr<Program_t>
+    load(
+        Error_t &err,
+        const FilesystemInterface_t *filesystem,
+        const std::string &key,
+        const std::vector<const SourceList_t *> &deps
+    ) const;
+
+    /** Stores the program for given key.
+     *
+     * @param key the unique key of the program
+     * @param program the compiled program
+     * @param deps the sources of dictionary and configuration
+     * @return true if the program has been stored
+     */
+    bool save(
+        const std::string &key,
+        const Program_t &program,
+        const std::vector<const SourceList_t *> &deps
+    ) const;
+
+protected:
+    /** Called with the stored bytecode; the data are valid during the call.
+     */
+    using Reader_t = std::function<void (const char *data, std::size_t size)>;
+
+    /** Calls reader with the bytecode stored for given key if there is some.
+     */
+    virtual void read(const std::string &key, const Reader_t &reader) const = 0;
+
+    /** Stores the bytecode for given key and returns true on success.
+     */
+    virtual bool write(const std::string &key, const std::string &data) const = 0;
+};
+
+/** The directory of serialized programs that survives the process.
+ *
+ * Each program is stored in its own file named by the hash of its key. The
+ * file is replaced atomically, so the concurrent readers never see
+ * partially written program.
+ */
+class BytecodeDirectory_t: public BytecodeStore_t {
+public:
+    /** C'tor.
+     *
+     * @param dir the directory where the programs are stored
+     */
+    BytecodeDirectory_t(std::string dir): dir(std::move(dir)) {}
+
+    /** Returns the path of the file for given key.
+     */
+    std::string path(const std::string &key) const;
+
+protected:
+    void read(const std::string &key, const Reader_t &reader) const override;
+    bool write(const std::string &key, const std::string &data) const override;
+
+private:
+    std::string dir; //!< the directory where the programs are stored
+};
+
+/** The serialized programs in shared memory.
+ *
+ * The arena is created in anonymous shared memory, so it is shared by all
+ * processes forked after it has been created; the program compiled in one
+ * worker is loaded by the others. The arena holds only offsets, so it is
+ * valid at any address it is mapped to. If the arena is full all programs
+ * are dropped and it is filled again.
+ */
+class SharedBytecodeArena_t: public BytecodeStore_t {
+public:
+    /** Creates the arena. Throws std::system_error if the shared memory
+     * can't be allocated.
+     *
+     * @param bytes the size of the arena
+     */
+    SharedBytecodeArena_t(std::size_t bytes);
+
+    /** Unmaps the arena (the other processes still have it mapped).
+     */
+    ~SharedBytecodeArena_t() override;
+
+    /** Returns the number of times the full arena has been dropped.
+     */
+    uint64_t resets() const;
+
+protected:
+    void read(const std::string &key, const Reader_t &reader) const override;
+    bool write(const std::string &key, const std::string &data) const override;
+
+private:
+    // don't copy
+    SharedBytecodeArena_t(const SharedBytecodeArena_t &) = delete;
+    SharedBytecodeArena_t &operator=(const SharedBytecodeArena_t &) = delete;
+
+    struct Header_t;
+    struct Slot_t;
+    class Lock_t;
+
+    /** Returns the slot for given key hash: the occupied one or the first
+     * free one or null if the table is full.
+     */
+    Slot_t *find(uint64_t hash) const;
+
+    /** Drops all stored programs.
+     */
+    void reset() const;
+
+    Header_t *header; //!< the start of shared memory
+    std::size_t size; //!< the size of shared memory
+};
+
+/** Serializes the program into the bytecode.
+ *
+ * Throws bad_bytecode_t if the program can't be serialized.
+ *
+ * @param key the unique key of the program
+ * @param program the compiled program
+ * @param deps the sources of dictionary and configuration
+ */
+std::string
+serializeProgram(
+    const std::string &key,
+    const Program_t &program,
+    const std::vector<const SourceList_t *> &deps
+);
+
+/** Deserializes the program from the bytecode.
+ *
+ * Throws bad_bytecode_t if the bytecode is corrupted.
+ *
+ * @param err the error log of the program
+ * @param filesystem the filesystem used to check the template sources
+ * @param key the unique key of the program
+ * @param data the serialized program
+ * @param size the size of serialized program
+ * @param deps the sources of dictionary and configuration
+ * @return the program or null if the bytecode is stale
+ */
+std::unique_ptr<Program_t>
+deserializeProgram(
+    Error_t &err,
+    const FilesystemInterface_t *filesystem,
+    const std::string &key,
+    const char *data,
+    std::size_t size,
+    const std::vector<const SourceList_t *> &deps
+);
+
+} // namespace Teng
+
+#endif /* TENGBYTECODE_H */
+
@@ -39,13 +39,17 @@
 #define TENGCACHE_H
 
 #include <cstdint>
-#include <map>
+#include <list>
+#include <mutex>
 #include <string>
 #include <memory>
 #include <tuple>
+#include <future>
+#include <vector>
+#include <unordered_map>
 #include <stdexcept>
 #include <algorithm>
-#include <stdexcept>
+#include <functional>
 
 #include "util.h"
 #include "teng/error.h"
@@ -85,78 +89,140 @@ public:
      * @param data associated value with its key
      * @param dependSerial serial number of data this entry depends on.
      */
-    CacheEntry_t(std::shared_ptr<Data_t> data, uint64_t dependSerial)
-        : data(std::move(data)), serial(0), dependSerial(dependSerial)
+    CacheEntry_t(
+        std::shared_ptr<Data_t> data,
+        uint64_t dependSerial,
+        std::size_t bytes
+    ): data(std::move(data)), serial(0), dependSerial(dependSerial),
+       bytes(bytes)
     {}
 
     std::shared_ptr<Data_t> data; //!< associated value
     uint64_t serial;              //!< serial number of the value
     uint64_t dependSerial;        //!< serial number of the value depends on
+    std::size_t bytes;            //!< memory occupied by the value
+};
+
+/**
+ * @short Statistics of the cache.
+ */
+struct CacheStats_t {
+    /**
+     * @short Merges statistics of other cache (shard) into this one.
+     */
+    CacheStats_t &operator+=(const CacheStats_t &other) {
+        bytes += other.bytes;
+        entries += other.entries;
+        hits += other.hits;
+        misses += other.misses;
+        evictions += other.evictions;
+        return *this;
+    }
+
+    std::size_t bytes = 0;   //!< memory occupied by the cached values
+    std::size_t entries = 0; //!< the number of cached values
+    uint64_t hits = 0;       //!< the number of successful lookups
+    uint64_t misses = 0;     //!< the number of failed lookups
+    uint64_t evictions = 0;  //!< the number of evicted values
+};
+
+/**
+ * @short Hash of the cache key.
+ */
+struct CacheKeyHash_t {
+    std::size_t operator()(const std::vector<std::string> &key) const {
+        std::size_t seed = 0;
+        for (auto &item: key)
+            seed ^= std::hash<std::string>{}(item)
+                  + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        return seed;
+    }
 };
 
 /**
  * @short LRU.
+ *
+ * The most recently used entries are at the front of the list. Touching entry
+ * splices it to the front so both hit and insert are O(1).
  */
 template <typename Type_t>
 class CacheLRU_t {
 public:
     /**
-     * @short Touches entry -> moves entry at begin of vector
-     */
-    void hit(Type_t entry) {
-        auto ilru = std::find(lru.begin(), lru.end(), entry);
-        if (ilru != lru.end()) {
-            // ok, entry found in the LRU
-            if (ilru != lru.begin()) {
-                // move entries one place to the right
-                for (; ilru != lru.begin(); --ilru)
-                    *ilru = *(ilru - 1);
-                // move found entry to the beginning
-                *ilru = entry;
-            }
-        } else {
-            // if entry not found (strange...) push it to the front
-            // of the LRU
-            lru.insert(lru.begin(), entry);
-        }
+     * @short Handle of the entry in the LRU.
+     */
+    using iterator = typename std::list<Type_t>::iterator;
+
+    /**
+     * @short The maximal number of entries the eviction examines.
+     */
+    static const unsigned int EVICTION_WINDOW = 8;
+
+    /**
+     * @short Touches entry -> moves entry at begin of list
+     */
+    void hit(iterator ilru) {
+        if (ilru != lru.begin())
+            lru.splice(lru.begin(), lru, ilru);
     }
 
     /**
-     * @short Erases least recently used entry from lru and returns it.
+     * @short Returns least recently used entry.
      *
-     * @return least recently used entry that has been removed or nullptr.
+     * It prefers unused entries but examines only few entries at the end of
+     * the LRU to keep the eviction cost constant.
+     *
+     * @return least recently used entry
      */
     template <typename unused_t>
-    Type_t popLeastRecentlyUsed(unused_t unused) {
+    iterator leastRecentlyUsed(unused_t unused) {
         if (lru.empty())
             throw std::range_error(__PRETTY_FUNCTION__);
 
-        // try pop unused entry
-        for (auto ilru = lru.rbegin(); ilru != lru.rend(); ++ilru) {
-            if (unused(*ilru)) {
-                Type_t entry = *ilru;
-                lru.erase(std::prev(ilru.base()));
-                return entry;
-            }
+        // try find unused entry
+        auto ilru = std::prev(lru.end());
+        for (unsigned int i = 0; i < EVICTION_WINDOW; ++i, --ilru) {
+            if (unused(*ilru)) return ilru;
+            if (ilru == lru.begin()) break;
         }
 
-        // if no unused entry has been found, remove the last one
-        Type_t entry = lru.back();
-        lru.pop_back();
-        return entry;
+        // if no unused entry has been found, return the last one
+        return std::prev(lru.end());
     }
 
     /**
      * @short Adds new entry to the lru.
      */
-    void insert(Type_t entry) {lru.insert(lru.begin(), entry);}
+    template <typename... Args_t>
+    iterator emplace(Args_t &&...args) {
+        lru.emplace_front(std::forward<Args_t>(args)...);
+        return lru.begin();
+    }
+
+    /**
+     * @short Removes the entry from the lru.
+     */
+    void erase(iterator ilru) {lru.erase(ilru);}
+
+    /**
+     * @short Returns the number of entries.
+     */
+    std::size_t size() const {return lru.size();}
 
 private:
-    std::vector<Type_t> lru; //!< the storage
+    std::list<Type_t> lru; //!< the storage
 };
 
 /**
  * @short Maps key from source list to cached value.
+ *
+ * The entries live in the LRU list, the hash index maps keys to the LRU list
+ * nodes. The cache is limited by the number of entries and optionally by the
+ * sum of memory occupied by the cached values. Values that provide
+ * memoryUsage() method are measured by it, the others by their sizeof.
+ *
+ * All public methods are thread safe: each of them holds the cache mutex for
+ * the time of the map lookup and the LRU update only.
  */
 template <typename Data_t>
 class Cache_t {
@@ -171,27 +237,46 @@ public:
      */
     using Entry_t = CacheEntry_t<Data_t>;
 
-    /**
-     * @short Mapping keys to entries.
-     */
-    using EntryCache_t = std::map<Key_t, Entry_t>;
-
     /**
      * @short The type of entry in cache LRU.
      */
-    using LRUEntry_t = const typename EntryCache_t::value_type *;
+    struct LRUEntry_t {
+        LRUEntry_t(const Key_t &key, Entry_t entry)
+            : key(key), entry(std::move(entry))
+        {}
+
+        Key_t key;     //!< the entry key
+        Entry_t entry; //!< the entry
+    };
 
     /**
      * @short LRU for the cache.
      */
     using LRU_t = CacheLRU_t<LRUEntry_t>;
 
+    /**
+     * @short Mapping keys to entries.
+     */
+    using EntryCache_t = std::unordered_map<
+        std::reference_wrapper<const Key_t>,
+        typename LRU_t::iterator,
+        CacheKeyHash_t,
+        std::equal_to<Key_t>
+    >;
+
     /**
      * @short Creates empty cache.
+     *
+     * @param maximalSize maximal number of entries (zero means default)
+     * @param maximalBytes maximal memory of cached values (zero means
+     *                     unlimited)
      */
-    Cache_t(unsigned int maximalSize = DEFAULT_MAXIMAL_SIZE)
-        : cache(), lru(),
-          maximalSize(maximalSize? maximalSize: DEFAULT_MAXIMAL_SIZE)
+    Cache_t(
+        unsigned int maximalSize = DEFAULT_MAXIMAL_SIZE,
+        std::size_t maximalBytes = 0
+    ): cache(), lru(), stats(),
+       maximalSize(maximalSize? maximalSize: DEFAULT_MAXIMAL_SIZE),
+       maximalBytes(maximalBytes)
     {}
 
     /**
@@ -207,16 +292,36 @@ public:
      */
     std::tuple<std::shared_ptr<Data_t>, uint64_t, uint64_t>
     find(const Key_t &key) const {
+        std::lock_guard<std::mutex> locked(mutex);
+
         // search for entry
         auto ientry = cache.find(key);
-        if (ientry == cache.end())
+        if (ientry == cache.end()) {
+            ++stats.misses;
             return {{}, 0, 0};
+        }
 
         // touch entry
-        lru.hit(&*ientry);
+        ++stats.hits;
+        lru.hit(ientry->second);
 
         // return result
-        const Entry_t &entry = ientry->second;
+        const Entry_t &entry = ientry->second->entry;
+        return {entry.data, entry.dependSerial, entry.serial};
+    }
+
+    /**
+     * @short Finds entry in the cache without touching the LRU and stats.
+     *
+     * @param key searched key
+     * @return tuple of <(found data or empty shared_ptr), dependSerial, serial>
+     */
+    std::tuple<std::shared_ptr<Data_t>, uint64_t, uint64_t>
+    peek(const Key_t &key) const {
+        std::lock_guard<std::mutex> locked(mutex);
+        auto ientry = cache.find(key);
+        if (ientry == cache.end()) return {{}, 0, 0};
+        const Entry_t &entry = ientry->second->entry;
         return {entry.data, entry.dependSerial, entry.serial};
     }
 
@@ -234,12 +339,73 @@ public:
         std::shared_ptr<Data_t> data,
         uint64_t dependSerial = 0
     ) {
+        std::lock_guard<std::mutex> locked(mutex);
         auto ientry = cache.find(key);
         return ientry != cache.end()
             ? update_old(ientry, std::move(data), dependSerial)
             : insert_new(key, std::move(data), dependSerial);
     }
 
+    /**
+     * @short Returns the cache statistics.
+     */
+    CacheStats_t getStats() const {
+        std::lock_guard<std::mutex> locked(mutex);
+        CacheStats_t result = stats;
+        result.entries = cache.size();
+        return result;
+    }
+
+private:
+    // don't copy
+    Cache_t(const Cache_t &) = delete;
+    Cache_t &operator=(const Cache_t &) = delete;
+
+    /**
+     * @short Returns memory occupied by the value that knows its footprint.
+     */
+    template <typename Value_t>
+    static auto memory_usage(const Value_t &value, int)
+        -> decltype(std::size_t(value.memoryUsage()))
+    {return value.memoryUsage();}
+
+    /**
+     * @short Returns memory occupied by the value (fallback).
+     */
+    template <typename Value_t>
+    static std::size_t memory_usage(const Value_t &, long) {
+        return sizeof(Value_t);
+    }
+
+    /**
+     * @short Returns true if the cache exceeds its limits when value of given
+     * size is added.
+     */
+    bool overflows(std::size_t entries, std::size_t bytes) const {
+        if (entries > maximalSize) return true;
+        return maximalBytes && ((stats.bytes + bytes) > maximalBytes);
+    }
+
+    /**
+     * @short Removes one least recently used entry.
+     *
+     * The kept entry is never evicted unless it is the least recently used
+     * entry of all.
+     */
+    void evict(const LRUEntry_t *keep = nullptr) {
+        // returns true if data pointer is referenced only from cache
+        auto unused = [&] (const LRUEntry_t &lru_entry) {
+            return (&lru_entry != keep)
+                && (lru_entry.entry.data.use_count() <= 1);
+        };
+
+        auto ilru = lru.leastRecentlyUsed(unused);
+        stats.bytes -= ilru->entry.bytes;
+        ++stats.evictions;
+        cache.erase(ilru->key);
+        lru.erase(ilru);
+    }
+
     /**
      * @short Inserts new entry into cache.
      */
@@ -248,21 +414,19 @@ public:
         std::shared_ptr<Data_t> &&data,
         uint64_t dependSerial
     ) {
-        // returns true if data pointer is referenced only from cache
-        auto unused = [] (LRUEntry_t lru_entry) {
-            return lru_entry->second.data.use_count() <= 1;
-        };
-
-        // at first, if size of cache is greater then limit kill some entry
-        if (cache.size() >= maximalSize)
-            cache.erase(lru.popLeastRecentlyUsed(unused)->first);
+        // at first, kill entries until there is enough space for new one
+        std::size_t bytes = data? memory_usage(*data, 0): 0;
+        while (!cache.empty() && overflows(cache.size() + 1, bytes))
+            evict();
 
         // emplace cache entry and update lru
-        auto ientry = cache.emplace(key, Entry_t(data, dependSerial)).first;
-        lru.insert(&*ientry);
+        Entry_t entry(std::move(data), dependSerial, bytes);
+        auto ilru = lru.emplace(key, std::move(entry));
+        cache.emplace(ilru->key, ilru);
+        stats.bytes += bytes;
 
         // return serial of new entry => 0
-        return ientry->second.serial;
+        return ilru->entry.serial;
     }
 
     /**
@@ -274,29 +438,199 @@ public:
         uint64_t dependSerial
     ) {
         // touch entry
-        lru.hit(&*ientry);
+        lru.hit(ientry->second);
 
         // attempt to insert same data
-        if (ientry->second.data == data)
-            return ientry->second.serial;
+        Entry_t &entry = ientry->second->entry;
+        if (entry.data == data)
+            return entry.serial;
 
         // replace old entry data with fresh one
-        Entry_t &entry = ientry->second;
+        stats.bytes -= entry.bytes;
+        entry.bytes = data? memory_usage(*data, 0): 0;
         entry.dependSerial = dependSerial;
         entry.data = std::move(data);
 
+        // kill other entries until the fresh data fit into the cache; the
+        // touched entry is at the front so it is never the last one
+        while ((cache.size() > 1) && overflows(cache.size(), entry.bytes))
+            evict(&*ientry->second);
+        stats.bytes += entry.bytes;
+
         // increment and return serial
         return ++entry.serial;
     }
 
-private:
-    // don't copy
-    Cache_t(const Cache_t &) = delete;
-    Cache_t &operator=(const Cache_t &) = delete;
-
+    mutable std::mutex mutex;  //!< guards the cache and the LRU
     EntryCache_t cache;        //!< the cache
     mutable LRU_t lru;         //!< LRU for cache entries
+    mutable CacheStats_t stats; //!< statistics (entries are not maintained)
     unsigned int maximalSize;  //!< Maximal size of cache.
+    std::size_t maximalBytes;  //!< Maximal memory of cached values.
+};
+
+/**
+ * @short Lock-striped cache.
+ *
+ * Spreads the entries over independent Cache_t instances (shards) according
+ * to the key hash, so threads looking up different keys mostly don't contend
+ * for the same mutex. Each shard gets its own share of the maximal size.
+ */
+template <typename Data_t>
+class ShardedCache_t {
+public:
+    /**
+     * @short Key type for entries in cache.
+     */
+    using Key_t = typename Cache_t<Data_t>::Key_t;
+
+    /**
+     * @short Creates empty cache.
+     *
+     * @param maximalSize maximal number of entries (zero means default)
+     * @param shards the number of shards (zero means one)
+     * @param maximalBytes maximal memory of cached values (zero means
+     *                     unlimited)
+     */
+    ShardedCache_t(
+        unsigned int maximalSize = 0,
+        unsigned int shards = 0,
+        std::size_t maximalBytes = 0
+    ): shards()
+    {
+        if (!shards) shards = 1;
+        if (!maximalSize) maximalSize = Cache_t<Data_t>::DEFAULT_MAXIMAL_SIZE;
+        unsigned int shardSize = (maximalSize + shards - 1) / shards;
+        std::size_t shardBytes = (maximalBytes + shards - 1) / shards;
+        this->shards.reserve(shards);
+        for (unsigned int i = 0; i < shards; ++i) {
+            this->shards.push_back(
+                std::make_unique<Cache_t<Data_t>>(shardSize, shardBytes)
+            );
+        }
+    }
+
+    /**
+     * @short Finds entry in the cache (see Cache_t::find).
+     */
+    std::tuple<std::shared_ptr<Data_t>, uint64_t, uint64_t>
+    find(const Key_t &key) const {return shard(key).find(key);}
+
+    /**
+     * @short Finds entry in the cache (see Cache_t::peek).
+     */
+    std::tuple<std::shared_ptr<Data_t>, uint64_t, uint64_t>
+    peek(const Key_t &key) const {return shard(key).peek(key);}
+
+    /**
+     * @short Adds new entry into cache (see Cache_t::add).
+     */
+    uint64_t add(
+        const Key_t &key,
+        std::shared_ptr<Data_t> data,
+        uint64_t dependSerial = 0
+    ) {return shard(key).add(key, std::move(data), dependSerial);}
+
+    /**
+     * @short Returns the statistics summed over all shards.
+     */
+    CacheStats_t getStats() const {
+        CacheStats_t result;
+        for (auto &shard: shards) result += shard->getStats();
+        return result;
+    }
+
+private:
+    /**
+     * @short Returns shard responsible for given key.
+     */
+    Cache_t<Data_t> &shard(const Key_t &key) const {
+        if (shards.size() == 1) return *shards.front();
+        return *shards[CacheKeyHash_t()(key) % shards.size()];
+    }
+
+    std::vector<std::unique_ptr<Cache_t<Data_t>>> shards; //!< the shards
+};
+
+/**
+ * @short Coalesces concurrent loads of values with the same key.
+ *
+ * Only the first thread that wants to load the value for the key (the
+ * leader) really loads it. The others either wait for the leader's result
+ * or, if they have some stale value, keep using the stale value until the
+ * leader is done (stale-while-revalidate).
+ */
+template <typename Data_t>
+class CacheFlights_t {
+public:
+    /**
+     * @short Key type for loaded values.
+     */
+    using Key_t = std::vector<std::string>;
+
+    /**
+     * @short Loads the value by given loader unless other thread loads it.
+     *
+     * The loader should put the value into the cache before it returns so
+     * the threads coming after the load see the fresh value. If the leader
+     * fails the waiting threads load the value on their own.
+     *
+     * @param key the key of loaded value
+     * @param stale the stale value (or empty pointer)
+     * @param loader the function that loads the value
+     *
+     * @return the loaded value or the stale one
+     */
+    template <typename loader_t>
+    std::shared_ptr<Data_t>
+    load(const Key_t &key, std::shared_ptr<Data_t> stale, loader_t &&loader) {
+        std::unique_lock<std::mutex> locked(mutex);
+
+        // someone else loads the value
+        auto iflight = flights.find(key);
+        if (iflight != flights.end()) {
+            if (stale) return stale;
+            auto result = iflight->second;
+            locked.unlock();
+            try {
+                return result.get();
+            } catch (...) {return loader();}
+        }
+
+        // this thread is the leader
+        std::promise<std::shared_ptr<Data_t>> promise;
+        flights.emplace(key, promise.get_future().share());
+        locked.unlock();
+
+        // load the value and wake the waiting threads
+        try {
+            auto result = loader();
+            finish(key);
+            promise.set_value(result);
+            return result;
+        } catch (...) {
+            finish(key);
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+    }
+
+private:
+    /**
+     * @short Removes the finished load.
+     */
+    void finish(const Key_t &key) {
+        std::lock_guard<std::mutex> locked(mutex);
+        flights.erase(key);
+    }
+
+    /**
+     * @short The result of load that is in progress.
+     */
+    using Flight_t = std::shared_future<std::shared_ptr<Data_t>>;
+
+    std::mutex mutex; //!< guards the flights
+    std::unordered_map<Key_t, Flight_t, CacheKeyHash_t> flights; //!< loads
 };
 
 } // namespace Teng
@@ -48,7 +48,8 @@ Configuration_t::Configuration_t(Error_t &err, std::shared_ptr<const FilesystemI
     : Dictionary_t(err, filesystem),
       debug(false), errorFragment(false), logToOutput(false), bytecode(false),
       watchFiles(true), alwaysEscape(true), shortTag(false), format(true),
-      maxIncludeDepth(10), maxDebugValLength(40), printEscape(true)
+      maxIncludeDepth(10), maxDebugValLength(40), printEscape(true),
+      checkInterval(0)
 {}
 
 teng_feature
@@ -80,6 +81,7 @@ std::ostream &operator<<(std::ostream &o, const Configuration_t &c) {
       << "    logtooutput: " << bool2string(c.logToOutput) << std::endl
       << "    bytecode: " << bool2string(c.bytecode) << std::endl
       << "    watchfiles: " << bool2string(c.watchFiles) << std::endl
+      << "    checkinterval: " << c.checkInterval.count() << "ms" << std::endl
       << "    maxincludedepth: " << c.maxIncludeDepth << std::endl
       << "    maxdebugvallength: " << c.maxDebugValLength << std::endl
       << "    format: " << bool2string(c.format) << std::endl
@@ -111,11 +113,33 @@ Configuration_t::new_directive(
         return error_code::invalid_number;
     };
 
+    // lambda that converts directive value (e.g. 2s) to duration
+    auto to_duration = [&] (std::chrono::milliseconds &result) {
+        if (!value.empty()) {
+            char *end;
+            auto number = strtol(value.data(), &end, 10);
+            string_view_t unit = {end, value.end()};
+            if ((number >= 0) && (end != value.data())) {
+                if (unit.empty() || (unit == "s"))
+                    result = std::chrono::seconds(number);
+                else if (unit == "ms")
+                    result = std::chrono::milliseconds(number);
+                else if (unit == "m")
+                    result = std::chrono::minutes(number);
+                else return error_code::invalid_duration;
+                return error_code::none;
+            }
+        }
+        return error_code::invalid_duration;
+    };
+
     // the numeric directives
     if (name == "maxincludedepth")
         return to_number(maxIncludeDepth);
     if (name == "maxdebugvallength")
         return to_number(maxDebugValLength);
+    if (name == "checkinterval")
+        return to_duration(checkInterval);
 
     // lambda that enables Teng features
     auto enable_feature = [&] (bool enable) {
@@ -38,6 +38,7 @@
 #ifndef TENGCONFIGURATION_H
 #define TENGCONFIGURATION_H
 
+#include <chrono>
 #include <cstdint>
 #include <iosfwd>
 #include <string>
@@ -70,6 +71,7 @@ public:
     bool isWatchFilesEnabled() const {return watchFiles;}
     uint32_t getMaxIncludeDepth() const {return maxIncludeDepth;}
     uint16_t getMaxDebugValLength() const {return maxDebugValLength;}
+    std::chrono::milliseconds getCheckInterval() const {return checkInterval;}
     bool isFormatEnabled() const {return format;}
     bool isAlwaysEscapeEnabled() const {return alwaysEscape;}
     bool isPrintEscapeEnabled() const {return printEscape;}
@@ -80,6 +82,13 @@ public:
      */
     teng_feature isEnabled(const string_view_t &name) const;
 
+    /** Returns the number of bytes occupied by the configuration.
+     */
+    std::size_t memoryUsage() const override {
+        return Dictionary_t::memoryUsage()
+            + sizeof(Configuration_t) - sizeof(Dictionary_t);
+    }
+
     /** Dumps configuration to stream.
      */
     friend std::ostream &operator<<(std::ostream &o, const Configuration_t &c);
@@ -104,6 +113,7 @@ protected:
     uint32_t maxIncludeDepth;   //!< maximal template include depth
     uint16_t maxDebugValLength; //!< maximal length of variable value length
     bool printEscape;  //!< use escaping only if values are printed
+    std::chrono::milliseconds checkInterval; //!< min time between checks (0)
 };
 
 } // namespace Teng
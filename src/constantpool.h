@@ -0,0 +1,98 @@
+/*
+ * Teng -- a general purpose templating engine.
+ * Copyright (C) 2004  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Naskove 1, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:teng@firma.seznam.cz
+ *
+ *
+ * $Id: $
+ *
+ * DESCRIPTION
+ * Teng constant pool -- the strings and literals of compiled programs.
+ *
+ * AUTHORS
+ * Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * HISTORY
+ * 2026-10-16  (burlog)
+ *             Created.
+ */
+
+#ifndef TENGCONSTANTPOOL_H
+#define TENGCONSTANTPOOL_H
+
+#include <deque>
+#include <string>
+#include <unordered_set>
+
+#include "teng/value.h"
+
+namespace Teng {
+
+/** The storage of instruction operands that don't fit into the instruction
+ * itself (names, paths and literal values).
+ *
+ * The instructions hold only pointers into the pool, so the addresses of the
+ * stored constants have to be stable -- the pool never moves them and it is
+ * not copyable.
+ */
+class ConstantPool_t {
+public:
+    /** C'tor.
+     */
+    ConstantPool_t() = default;
+
+    /** Interns given string; the equal strings share the storage.
+     */
+    const std::string *string(std::string value) {
+        return &*strings.insert(std::move(value)).first;
+    }
+
+    /** Stores given literal value. The values are not shared, so the
+     * compiler can modify them in place (e.g. when it joins the literals).
+     */
+    Value_t *value(Value_t value) {
+        values.push_back(std::move(value));
+        return &values.back();
+    }
+
+    /** Drops given value if it is the last stored one. It reclaims the
+     * values of the instructions removed right after they were generated.
+     */
+    void release(const Value_t *value) {
+        if (!values.empty() && (value == &values.back())) values.pop_back();
+    }
+
+    /** Returns the number of bytes occupied by the stored constants.
+     */
+    std::size_t memoryUsage() const;
+
+private:
+    // don't copy
+    ConstantPool_t(const ConstantPool_t &) = delete;
+    ConstantPool_t &operator=(const ConstantPool_t &) = delete;
+
+    std::unordered_set<std::string> strings; //!< the interned strings
+    std::deque<Value_t> values;              //!< the literal values
+};
+
+} // namespace Teng
+
+#endif /* TENGCONSTANTPOOL_H */
+
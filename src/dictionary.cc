@@ -52,6 +52,7 @@
 #include "logging.h"
 #include "platform.h"
 #include "dictionary.h"
+#include "util.h"
 
 namespace Teng {
 namespace {
@@ -500,6 +501,17 @@ void Dictionary_t::dump(std::ostream &out) const {
     }
 }
 
+std::size_t Dictionary_t::memoryUsage() const {
+    // the map node holds three pointers and color besides the value
+    constexpr auto node_size = sizeof(Entries_t::value_type) + 4 * sizeof(void *);
+    std::size_t result = sizeof(Dictionary_t) + sources.memoryUsage();
+    for (auto &entry: entries) {
+        result += node_size;
+        result += heapUsage(entry.first) + heapUsage(entry.second);
+    }
+    return result;
+}
+
 std::string *
 Dictionary_t::new_entry(const std::string &name, const std::string &value) {
     return replaceEntries
@@ -553,6 +565,15 @@ void Dictionary_t::parse(const std::string &filename) {
                     + " directive '" + value + "'"
                 );
                 break;
+            case error_code::invalid_duration:
+                logWarning(
+                    err,
+                    value_pos,
+                    "Invalid duration value of " + name
+                    + " directive '" + value + "'; use number followed by "
+                    "one of units {ms, s, m}"
+                );
+                break;
             case error_code::invalid_bool:
                 logWarning(
                     err,
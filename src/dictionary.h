@@ -109,6 +109,18 @@ public:
      */
     int isChanged() const {return sources.isChanged(filesystem.get());}
 
+    /**
+     * @short Starts watching source files by given watcher.
+     */
+    void watch(FileWatcher_t &watcher) const {sources.watch(watcher);}
+
+    /**
+     * @short Returns the number of bytes occupied by the dictionary.
+     *
+     * @return memory footprint of the dictionary
+     */
+    virtual std::size_t memoryUsage() const;
+
     /**
      * @short Fills dictionary with data parsed from filename.
      *
@@ -129,6 +141,7 @@ protected:
         unknown_directive,
         invalid_bool,
         invalid_number,
+        invalid_duration,
         invalid_enable,
         invalid_disable,
     };
@@ -77,6 +77,23 @@ translate(
     return filenames.back().second;
 }
 
+const char *
+intern(
+    std::vector<std::pair<const void *, char *>> &filenames,
+    const std::string &filename
+) {
+    // the copied filenames have no owner in the cache
+    static const char *empty_filename = "";
+    if (filename.empty())
+        return empty_filename;
+    for (auto item: filenames)
+        if (!item.first && (item.second == filename))
+            return item.second;
+    filenames.push_back({nullptr, nullptr});
+    filenames.back().second = strndup(filename.c_str(), filename.size());
+    return filenames.back().second;
+}
+
 template <typename Records_t>
 std::vector<Error_t::Entry_t> make_error_log(const Records_t &records) {
     using Record_t = typename Records_t::value_type;
@@ -197,7 +214,21 @@ void Error_t::append_impl(
     std::string msg
 ) {
     RecordKey_t key = {translate(filenames, filename), lineno, colno};
+    append_record(key, level, std::move(msg));
+}
+
+void Error_t::append_impl(
+    Level_t level,
+    const std::string &filename,
+    int64_t lineno,
+    int64_t colno,
+    std::string msg
+) {
+    RecordKey_t key = {intern(filenames, filename), lineno, colno};
+    append_record(key, level, std::move(msg));
+}
 
+void Error_t::append_record(RecordKey_t key, Level_t level, std::string msg) {
     // if no one error has been recorded for this position, insert new
     auto irecord = records.find(key);
     if (irecord == records.end()) {
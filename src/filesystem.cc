@@ -62,6 +62,11 @@ Filesystem_t::Filesystem_t(const std::string& root_)
     }
 }
 
+std::string Filesystem_t::path(const std::string& filename) const
+{
+    return makeFilename(root, filename);
+}
+
 std::string Filesystem_t::read(const std::string& filename_) const
 {
     std::string result;
@@ -0,0 +1,248 @@
+/*
+ * Teng -- a general purpose templating engine.
+ * Copyright (C) 2004  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Naskove 1, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:teng@firma.seznam.cz
+ *
+ *
+ * $Id: $
+ *
+ * DESCRIPTION
+ * Teng watchers of source files -- implementation.
+ *
+ * AUTHORS
+ * Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * HISTORY
+ * 2026-10-16  (burlog)
+ *             Created.
+ */
+
+#ifdef __linux__
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#endif /* __linux__ */
+
+#include <cerrno>
+
+#include "filewatcher.h"
+
+namespace Teng {
+
+std::unique_ptr<FileWatcher_t>
+create_watcher(const FilesystemInterface_t *filesystem) {
+    if (dynamic_cast<const InMemoryFilesystem_t *>(filesystem))
+        return nullptr; // nothing to watch
+#ifdef __linux__
+    if (auto *real = dynamic_cast<const Filesystem_t *>(filesystem))
+        return std::make_unique<InotifyWatcher_t>(real);
+#endif /* __linux__ */
+    return std::make_unique<PollingWatcher_t>(filesystem);
+}
+
+PollingWatcher_t::PollingWatcher_t(
+    const FilesystemInterface_t *filesystem,
+    std::chrono::milliseconds interval
+): filesystem(filesystem), interval(interval), mutex(), wakeup(), files(),
+   stopped(false), thread()
+{}
+
+PollingWatcher_t::~PollingWatcher_t() {
+    stop();
+}
+
+void PollingWatcher_t::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+    }
+    wakeup.notify_all();
+    if (thread.joinable()) thread.join();
+}
+
+void PollingWatcher_t::watch(const std::string &filename) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (files.count(filename)) return;
+    }
+
+    // stat the file without holding the lock
+    auto value = hash(filename);
+
+    // register file and start the thread if it is the first one
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopped) return;
+    files.emplace(filename, value);
+    if (!thread.joinable())
+        thread = std::thread(&PollingWatcher_t::run, this);
+}
+
+void PollingWatcher_t::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!wakeup.wait_for(lock, interval, [&] {return stopped;})) {
+        // check the files without holding the lock
+        auto snapshot = files;
+        lock.unlock();
+        bool modified = false;
+        for (auto &file: snapshot) {
+            auto value = hash(file.first);
+            if (value == file.second) continue;
+            file.second = value;
+            modified = true;
+        }
+        lock.lock();
+
+        // remember the new hashes
+        if (!modified) continue;
+        for (auto &file: snapshot) files[file.first] = file.second;
+        changed();
+    }
+}
+
+std::size_t PollingWatcher_t::hash(const std::string &filename) const {
+    try {
+        return filesystem->hash(filename);
+    } catch (const std::exception &) {
+        return 0;
+    }
+}
+
+#ifdef __linux__
+
+namespace {
+
+/** The events in watched directory that can mean change of watched file.
+ */
+constexpr uint32_t watch_mask = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE
+                              | IN_CREATE | IN_DELETE | IN_MOVED_FROM
+                              | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+
+} // namespace
+
+InotifyWatcher_t::InotifyWatcher_t(const Filesystem_t *filesystem)
+    : PollingWatcher_t(filesystem), filesystem(filesystem),
+      inotify_fd(-1), stop_fd(-1), dirs_mutex(), started(false), watched(),
+      dirs(), listener()
+{}
+
+InotifyWatcher_t::~InotifyWatcher_t() {
+    if (listener.joinable()) {
+        uint64_t one = 1;
+        if (::write(stop_fd, &one, sizeof(one)) < 0) {/* can't happen */}
+        listener.join();
+    }
+    if (stop_fd >= 0) ::close(stop_fd);
+    if (inotify_fd >= 0) ::close(inotify_fd);
+    stop();
+}
+
+bool InotifyWatcher_t::start() {
+    if (started) return listener.joinable();
+    started = true;
+
+    // the limit of inotify instances can be reached, poll files then
+    inotify_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) return false;
+    stop_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (stop_fd < 0) return false;
+
+    listener = std::thread(&InotifyWatcher_t::listen, this);
+    return true;
+}
+
+void InotifyWatcher_t::watch(const std::string &filename) {
+    auto path = filesystem->path(filename);
+    auto slash = path.rfind('/');
+    auto dir = slash == std::string::npos
+        ? std::string(".")
+        : (slash? path.substr(0, slash): std::string("/"));
+    auto base = slash == std::string::npos? path: path.substr(slash + 1);
+
+    {
+        std::lock_guard<std::mutex> lock(dirs_mutex);
+        if (!watched.insert(filename).second) return;
+        auto wd = start()
+            ? ::inotify_add_watch(inotify_fd, dir.c_str(), watch_mask)
+            : -1;
+        if (wd >= 0) {
+            dirs[wd].insert(base);
+            return;
+        }
+    }
+
+    // fallback for files that can't be watched by inotify
+    PollingWatcher_t::watch(filename);
+}
+
+void InotifyWatcher_t::listen() {
+    pollfd fds[2] = {{inotify_fd, POLLIN, 0}, {stop_fd, POLLIN, 0}};
+    for (;;) {
+        if (::poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents) break;
+        if (fds[0].revents && process_events()) changed();
+    }
+}
+
+bool InotifyWatcher_t::process_events() {
+    bool modified = false;
+    alignas(inotify_event) char buffer[4096];
+    for (;;) {
+        auto len = ::read(inotify_fd, buffer, sizeof(buffer));
+        if (len <= 0) return modified;
+
+        std::lock_guard<std::mutex> lock(dirs_mutex);
+        for (char *ptr = buffer; ptr < buffer + len;) {
+            auto *event = reinterpret_cast<const inotify_event *>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+
+            // some events has been lost
+            if (event->mask & IN_Q_OVERFLOW) {
+                modified = true;
+                continue;
+            }
+
+            // ignore events of directories that are not watched anymore
+            auto idir = dirs.find(event->wd);
+            if (idir == dirs.end()) continue;
+
+            // the directory has gone, so its files have to be watched again
+            if (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+                ::inotify_rm_watch(inotify_fd, event->wd);
+                dirs.erase(idir);
+                watched.clear();
+                modified = true;
+                continue;
+            }
+
+            // the change of watched file
+            if (event->len && idir->second.count(event->name))
+                modified = true;
+        }
+    }
+}
+
+#endif /* __linux__ */
+
+} // namespace Teng
+
@@ -0,0 +1,235 @@
+/*
+ * Teng -- a general purpose templating engine.
+ * Copyright (C) 2004  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Naskove 1, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:teng@firma.seznam.cz
+ *
+ *
+ * $Id: $
+ *
+ * DESCRIPTION
+ * Teng watchers of source files.
+ *
+ * AUTHORS
+ * Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * HISTORY
+ * 2026-10-16  (burlog)
+ *             Created.
+ */
+
+#ifndef TENGFILEWATCHER_H
+#define TENGFILEWATCHER_H
+
+#include <map>
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <cstdint>
+#include <condition_variable>
+
+#include "teng/filesystem.h"
+
+namespace Teng {
+
+/** @short Watches files for changes.
+ *
+ * Every detected change of any watched file increments the generation
+ * counter, so the users of files can cheaply find out that nothing has
+ * changed since they checked the files last time. The watcher can report
+ * changes that aren't real changes (the user has to check the files then)
+ * but it must not miss any change of the watched file.
+ */
+class FileWatcher_t {
+public:
+    virtual ~FileWatcher_t() = default;
+
+    /**
+     * @short Starts watching given file (if it isn't watched already).
+     * @param filename Name of the file in filesystem
+     */
+    virtual void watch(const std::string &filename) = 0;
+
+    /**
+     * @short Returns the generation counter.
+     * @return Value that changes whenever any of watched files changes
+     */
+    uint64_t generation() const {
+        return generation_value.load(std::memory_order_acquire);
+    }
+
+protected:
+    /**
+     * @short Should be called by implementation if some file changed.
+     */
+    void changed() {generation_value.fetch_add(1, std::memory_order_acq_rel);}
+
+    std::atomic<uint64_t> generation_value{1}; //!< the generation counter
+};
+
+/**
+ * @short Creates watcher of files in given filesystem.
+ *
+ * The files of Filesystem_t are watched by inotify (if available), the files
+ * of InMemoryFilesystem_t don't change, so no watcher is returned for them,
+ * and the files of any other filesystem are polled. No resources (threads,
+ * inotify instances) are acquired until the first file is watched.
+ *
+ * @param filesystem the filesystem that has to outlive the watcher
+ * @return New watcher of files or nullptr if files never change
+ */
+std::unique_ptr<FileWatcher_t>
+create_watcher(const FilesystemInterface_t *filesystem);
+
+/**
+ * @short Watcher that periodically checks hashes of watched files.
+ *
+ * Works with any filesystem implementation. The background thread is
+ * started when the first file is watched.
+ */
+class PollingWatcher_t: public FileWatcher_t {
+public:
+    /**
+     * @short The default period of hash checks.
+     */
+    static constexpr std::chrono::milliseconds DEFAULT_INTERVAL{1000};
+
+    /**
+     * @short Creates watcher.
+     *
+     * @param filesystem the filesystem that is asked for hashes of files
+     * @param interval the period of hash checks
+     */
+    PollingWatcher_t(
+        const FilesystemInterface_t *filesystem,
+        std::chrono::milliseconds interval = DEFAULT_INTERVAL
+    );
+
+    /**
+     * @short Stops the background thread.
+     */
+    ~PollingWatcher_t() override;
+
+    /**
+     * @short Starts watching given file.
+     */
+    void watch(const std::string &filename) override;
+
+protected:
+    /**
+     * @short Stops and joins the background thread.
+     */
+    void stop();
+
+private:
+    // don't copy
+    PollingWatcher_t(const PollingWatcher_t &) = delete;
+    PollingWatcher_t &operator=(const PollingWatcher_t &) = delete;
+
+    /**
+     * @short The body of the background thread.
+     */
+    void run();
+
+    /**
+     * @short Returns the hash of file or zero if the file can't be stat'd.
+     */
+    std::size_t hash(const std::string &filename) const;
+
+    const FilesystemInterface_t *filesystem;  //!< source of hashes
+    std::chrono::milliseconds interval;       //!< the period of checks
+    std::mutex mutex;                         //!< guards the following
+    std::condition_variable wakeup;           //!< stops the thread
+    std::map<std::string, std::size_t> files; //!< watched files and hashes
+    bool stopped;                             //!< the thread should stop
+    std::thread thread;                       //!< the background thread
+};
+
+#ifdef __linux__
+
+/**
+ * @short Watcher of real filesystem files based on inotify(7).
+ *
+ * It watches the directories containing the watched files, so the change is
+ * detected even if the file is replaced by rename. The inotify instance and
+ * the listening thread are created when the first file is watched. The files
+ * that can't be watched by inotify (e.g. the limit of instances or watches
+ * is reached) are polled.
+ */
+class InotifyWatcher_t: public PollingWatcher_t {
+public:
+    /**
+     * @short Creates watcher.
+     *
+     * @param filesystem the filesystem resolving the paths of files
+     */
+    InotifyWatcher_t(const Filesystem_t *filesystem);
+
+    /**
+     * @short Stops the background thread and closes inotify instance.
+     */
+    ~InotifyWatcher_t() override;
+
+    /**
+     * @short Starts watching given file.
+     */
+    void watch(const std::string &filename) override;
+
+private:
+    // don't copy
+    InotifyWatcher_t(const InotifyWatcher_t &) = delete;
+    InotifyWatcher_t &operator=(const InotifyWatcher_t &) = delete;
+
+    /**
+     * @short Creates inotify instance and starts the background thread if
+     * it hasn't been tried yet. Returns true if inotify can be used.
+     */
+    bool start();
+
+    /**
+     * @short The body of the background thread.
+     */
+    void listen();
+
+    /**
+     * @short Reads pending events and returns true if some watched file
+     * changed.
+     */
+    bool process_events();
+
+    const Filesystem_t *filesystem;            //!< resolves paths
+    int inotify_fd;                            //!< the inotify instance
+    int stop_fd;                               //!< eventfd waking the thread
+    std::mutex dirs_mutex;                     //!< guards the following
+    bool started;                              //!< start() has been called
+    std::set<std::string> watched;             //!< already watched files
+    std::map<int, std::set<std::string>> dirs; //!< watch -> file basenames
+    std::thread listener;                      //!< the background thread
+};
+
+#endif /* __linux__ */
+
+} // namespace Teng
+
+#endif /* TENGFILEWATCHER_H */
+
@@ -36,6 +36,12 @@
  *             Win32 support.
 */
 
+#include <tuple>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
 #include "jsonutils.h"
 #include "teng/config.h"
 #include "teng/fragmentvalue.h"
@@ -43,17 +49,210 @@
 #include "teng/fragment.h"
 
 namespace Teng {
-namespace {
 
-template <typename where_t, typename type_t>
-void replace_item(where_t &&items, const std::string &name, type_t &&value) {
-    auto iitem = items.find(name);
-    if (iitem != items.end())
-        return iitem->second.setValue(std::forward<type_t>(value));
-    items.emplace_hint(iitem, name, std::forward<type_t>(value));
+/** The open addressing hash table of the positions of items and the order of
+ * items by their names. The indexed fragment appends new items to the array,
+ * so their positions never change and only the order is updated.
+ */
+struct Fragment_t::Index_t {
+    /** The slot of table.
+     */
+    struct Slot_t {
+        uint32_t item = unused; //!< the position of item
+        uint32_t hash = 0;      //!< the hash of item name
+    };
+
+    // the value of unused slot
+    static constexpr uint32_t unused = UINT32_MAX;
+
+    /** C'tor.
+     */
+    Index_t(std::size_t capacity, std::pmr::memory_resource *arena)
+        : slots(capacity, arena), order(1, 0, arena)
+    {}
+
+    /** C'tor: copy allocating from given arena.
+     */
+    Index_t(const Index_t &other, std::pmr::memory_resource *arena)
+        : slots(other.slots, arena), order(other.order, arena)
+    {}
+
+    /** Inserts the position of item, that is the next one after the already
+     * indexed items, into the table and into the order of items. The table
+     * is kept at most half full, so the probing sequences are short.
+     */
+    void insert(const Items_t &items, uint32_t item, uint32_t hash) {
+        if (2 * order.size() > slots.size()) rehash(2 * slots.size());
+
+        // the items are often added in order
+        auto &name = items[item].first;
+        auto iorder = order.end() - 1;
+        if ((iorder != order.begin()) && !(items[iorder[-1]].first < name)) {
+            iorder = std::lower_bound(
+                order.begin(), iorder, name,
+                [&] (uint32_t i, const std::string &name) {
+                    return items[i].first < name;
+                }
+            );
+        }
+
+        // the last value of order is the number of items
+        order.insert(iorder, item);
+        order.back() = item + 1;
+
+        // register the item in table
+        auto mask = slots.size() - 1;
+        auto i = hash & mask;
+        while (slots[i].item != unused) i = (i + 1) & mask;
+        slots[i] = {item, hash};
+    }
+
+    /** Moves the items to the table of given capacity.
+     */
+    void rehash(std::size_t capacity) {
+        std::pmr::vector<Slot_t> bigger(capacity, slots.get_allocator());
+        auto mask = capacity - 1;
+        for (auto &slot: slots) {
+            if (slot.item == unused) continue;
+            auto i = slot.hash & mask;
+            while (bigger[i].item != unused) i = (i + 1) & mask;
+            bigger[i] = slot;
+        }
+        slots.swap(bigger);
+    }
+
+    std::pmr::vector<Slot_t> slots;   //!< the table (size is power of two)
+    std::pmr::vector<uint32_t> order; //!< the positions of items by names
+};
+
+Fragment_t::Fragment_t() noexcept = default;
+
+Fragment_t::Fragment_t(std::pmr::memory_resource *arena) noexcept
+    : items(arena)
+{}
+
+Fragment_t::Fragment_t(Fragment_t &&other) noexcept = default;
+
+Fragment_t &Fragment_t::operator=(Fragment_t &&other) noexcept {
+    if (&other != this) {
+        // the items are moved one by one if the arenas differ
+        auto same_arena = items.get_allocator() == other.items.get_allocator();
+        items = std::move(other.items);
+        if (!other.index || same_arena) index = std::move(other.index);
+        else index = std::make_unique<Index_t>(*other.index, arena());
+        other.index.reset();
+    }
+    return *this;
+}
+
+Fragment_t::~Fragment_t() noexcept = default;
+
+const uint32_t *Fragment_t::order() const {
+    return index? index->order.data(): nullptr;
+}
+
+std::size_t Fragment_t::search(const char *name, std::size_t size) const {
+    // the small fragments fit into few cache lines
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        auto &key = items[i].first;
+        if (key.size() != size) continue;
+        if (!std::char_traits<char>::compare(key.data(), name, size))
+            return i;
+    }
+    return items.size();
+}
+
+std::size_t
+Fragment_t::probe(const char *name, std::size_t size, uint32_t hash) const {
+    auto &slots = index->slots;
+    auto mask = slots.size() - 1;
+    for (auto i = hash & mask; slots[i].item != Index_t::unused;) {
+        auto &slot = slots[i];
+        i = (i + 1) & mask;
+        if (slot.hash != hash) continue;
+        auto &key = items[slot.item].first;
+        if (key.size() != size) continue;
+        if (!std::char_traits<char>::compare(key.data(), name, size))
+            return slot.item;
+    }
+    return items.size();
+}
+
+Fragment_t::const_iterator
+Fragment_t::lookup(const char *name, std::size_t size, uint32_t hash) const {
+    auto i = probe(name, size, hash);
+    if (i == items.size()) return end();
+    return {items.data(), index->order.data(), i, false};
+}
+
+Fragment_t::iterator Fragment_t::find(const std::string &name) {
+    if (!index)
+        return {items.data(), nullptr, search(name.data(), name.size())};
+    auto i = probe(name.data(), name.size(), hashName(name));
+    if (i == items.size()) return end();
+    return {items.data(), index->order.data(), i, false};
+}
+
+Fragment_t::Items_t::value_type *Fragment_t::get(const std::string &name) {
+    auto i = items.size();
+    if (index) i = probe(name.data(), name.size(), hashName(name));
+    else if (!items.empty() && !(items.back().first < name))
+        i = search(name.data(), name.size());
+    return i < items.size()? &items[i]: nullptr;
+}
+
+void Fragment_t::reindex() {
+    auto new_index = std::make_unique<Index_t>(4 * index_threshold, arena());
+    for (uint32_t i = 0; i < items.size(); ++i)
+        new_index->insert(items, i, hashName(items[i].first));
+    index = std::move(new_index);
 }
 
-} // namespace
+template <typename... Args_t>
+Fragment_t::Items_t::value_type &
+Fragment_t::insert(const std::string &name, Args_t &&...args) {
+    // the indexed fragment appends items and keeps their order in index
+    if (index) {
+        items.emplace_back(
+            std::piecewise_construct,
+            std::forward_as_tuple(name),
+            std::forward_as_tuple(std::forward<Args_t>(args)...)
+        );
+        try {
+            auto item = static_cast<uint32_t>(items.size() - 1);
+            index->insert(items, item, hashName(name));
+        } catch (...) {
+            items.pop_back();
+            throw;
+        }
+        return items.back();
+    }
+
+    // the small fragment keeps items ordered by names
+    auto iitem = std::lower_bound(
+        items.begin(), items.end(), name,
+        [] (const Items_t::value_type &item, const std::string &name) {
+            return item.first < name;
+        }
+    );
+    iitem = items.emplace(
+        iitem,
+        std::piecewise_construct,
+        std::forward_as_tuple(name),
+        std::forward_as_tuple(std::forward<Args_t>(args)...)
+    );
+
+    // build the index when the fragment becomes large
+    if (items.size() >= index_threshold) reindex();
+    return *iitem;
+}
+
+template <typename Type_t>
+void Fragment_t::replace(const std::string &name, Type_t &&value) {
+    if (auto *item = get(name))
+        return item->second.setValue(std::forward<Type_t>(value));
+    insert(name, std::forward<Type_t>(value));
+}
 
 void Fragment_t::json(std::ostream &o) const {
     o << '{';
@@ -78,15 +277,20 @@ void Fragment_t::dump(std::ostream &o) const {
 
 void
 Fragment_t::addVariable(const std::string &name, const std::string &value) {
-    replace_item(items, name, value);
+    replace(name, value);
 }
 
 void Fragment_t::addIntVariable(const std::string &name, IntType_t value) {
-    replace_item(items, name, value);
+    replace(name, value);
 }
 
 void Fragment_t::addRealVariable(const std::string &name, double value) {
-    replace_item(items, name, value);
+    replace(name, value);
+}
+
+void Fragment_t::addVariableView(const std::string &name, string_view_t value) {
+    if (auto *item = get(name)) return item->second.setView(value);
+    insert(name, TypeTag_t<string_view_t>(), value);
 }
 
 Fragment_t &Fragment_t::addFragment(const std::string &name) {
@@ -95,11 +299,16 @@ Fragment_t &Fragment_t::addFragment(const std::string &name) {
 
 FragmentList_t &
 Fragment_t::addFragmentList(const std::string &name) {
-    auto iitem = items.find(name);
-    if (iitem != items.end())
-        return iitem->second.ensureFragmentList();
+    if (auto *item = get(name)) return item->second.ensureFragmentList(arena());
     auto create_list = TypeTag_t<FragmentList_t>();
-    return items.emplace_hint(iitem, name, create_list)->second.list_value;
+    return *insert(name, create_list, arena()).second.list_value;
+}
+
+void Fragment_t::addLazyFragmentList(
+    const std::string &name,
+    std::unique_ptr<FragmentProvider_t> provider
+) {
+    addValue(name, FragmentValue_t(std::move(provider), arena()));
 }
 
 void Fragment_t::addValue(const std::string &name, Fragment_t &&value) {
@@ -111,10 +320,8 @@ void Fragment_t::addValue(const std::string &name, FragmentList_t &&value) {
 }
 
 void Fragment_t::addValue(const std::string &name, FragmentValue_t &&value) {
-    auto iitem = items.find(name);
-    if (iitem != items.end())
-        iitem->second = std::move(value);
-    else items.emplace_hint(iitem, name, std::move(value));
+    if (auto *item = get(name)) item->second = std::move(value);
+    else insert(name, std::move(value));
 }
 
 } // namespace Teng
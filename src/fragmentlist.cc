@@ -45,13 +45,19 @@
 namespace Teng {
 
 Fragment_t &FragmentList_t::addFragment() {
-    items.emplace_back(TypeTag_t<Fragment_t>());
+    items.emplace_back(TypeTag_t<Fragment_t>(), arena());
     return items.back().frag_value;
 }
 
 FragmentList_t &FragmentList_t::addFragmentList() {
-    items.emplace_back(TypeTag_t<FragmentList_t>());
-    return items.back().list_value;
+    items.emplace_back(TypeTag_t<FragmentList_t>(), arena());
+    return *items.back().list_value;
+}
+
+void FragmentList_t::addLazyFragmentList(
+    std::unique_ptr<FragmentProvider_t> provider
+) {
+    items.emplace_back(std::move(provider), arena());
 }
 
 void FragmentList_t::addValue(const std::string &value) {
@@ -66,6 +72,10 @@ void FragmentList_t::addRealValue(double value) {
     items.emplace_back(value);
 }
 
+void FragmentList_t::addValueView(string_view_t value) {
+    items.emplace_back(TypeTag_t<string_view_t>(), value);
+}
+
 void FragmentList_t::addValue(Fragment_t &&value) {
     items.emplace_back(std::move(value));
 }
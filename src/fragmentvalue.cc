@@ -36,6 +36,10 @@
  *             Win32 support.
 */
 
+#include <mutex>
+#include <utility>
+#include <memory_resource>
+
 #include "jsonutils.h"
 #include "teng/config.h"
 #include "teng/stringify.h"
@@ -51,8 +55,84 @@ namespace {
 template <typename type_t>
 void dispose(type_t *ptr) {ptr->~type_t();}
 
+/** Allocates new fragment list from given arena.
+ */
+template <typename... Args_t>
+FragmentList_t *
+make_list(std::pmr::memory_resource *arena, Args_t &&...args) {
+    std::pmr::polymorphic_allocator<FragmentList_t> alloc(arena);
+    auto *list = alloc.allocate(1);
+    return new (list) FragmentList_t(std::forward<Args_t>(args)...);
+}
+
+/** Destroys the fragment list and returns its memory to the list arena. The
+ * list of moved value is nullptr.
+ */
+void release(FragmentList_t *list) {
+    if (!list) return;
+    std::pmr::polymorphic_allocator<FragmentList_t> alloc(list->arena());
+    dispose(list);
+    alloc.deallocate(list, 1);
+}
+
 } // namespace
 
+/** The fragment list built by the provider when it is read first time.
+ */
+struct FragmentValue_t::Lazy_t {
+    Lazy_t(
+        std::unique_ptr<FragmentProvider_t> provider,
+        std::pmr::memory_resource *arena
+    ): provider(std::move(provider)),
+       value(TypeTag_t<FragmentList_t>(), arena)
+    {}
+
+    std::unique_ptr<FragmentProvider_t> provider; //!< the list provider
+    std::once_flag materialized;                  //!< set if list is built
+    FragmentValue_t value;                        //!< the built list
+};
+
+FragmentValue_t::FragmentValue_t(
+    std::unique_ptr<FragmentProvider_t> provider,
+    std::pmr::memory_resource *arena
+): tag_value(tag::lazy),
+   lazy_value(std::make_unique<Lazy_t>(std::move(provider), arena))
+{}
+
+const FragmentValue_t &FragmentValue_t::materialize() const {
+    if (tag_value != tag::lazy)
+        return *this;
+    auto &lazy = *lazy_value;
+    std::call_once(lazy.materialized, [&lazy] {
+        auto &list = *lazy.value.list_value;
+        try {
+            lazy.provider->materialize(list);
+        } catch (...) {
+            // drop the partially built list, the next read tries it again
+            list = FragmentList_t(list.arena());
+            throw;
+        }
+        lazy.provider.reset();
+    });
+    return lazy.value;
+}
+
+FragmentValue_t::FragmentValue_t(FragmentList_t &&value)
+    : tag_value(tag::list),
+      list_value(make_list(value.arena(), std::move(value)))
+{}
+
+FragmentValue_t::FragmentValue_t(TypeTag_t<FragmentList_t>)
+    : FragmentValue_t(
+        TypeTag_t<FragmentList_t>(),
+        std::pmr::get_default_resource()
+    ) {}
+
+FragmentValue_t::FragmentValue_t(
+    TypeTag_t<FragmentList_t>,
+    std::pmr::memory_resource *arena
+): tag_value(tag::list), list_value(make_list(arena, arena)) {}
+
 FragmentValue_t::FragmentValue_t(FragmentValue_t &&other) noexcept
     : tag_value(other.tag_value)
 {
@@ -64,7 +144,8 @@ FragmentValue_t::FragmentValue_t(FragmentValue_t &&other) noexcept
         frag_ptr_value = other.frag_ptr_value;
         break;
     case tag::list:
-        new (&list_value) FragmentList_t(std::move(other.list_value));
+        list_value = other.list_value;
+        other.list_value = nullptr;
         break;
     case tag::string:
         new (&string_value) std::string(std::move(other.string_value));
@@ -75,6 +156,12 @@ FragmentValue_t::FragmentValue_t(FragmentValue_t &&other) noexcept
     case tag::real:
         real_value = other.real_value;
         break;
+    case tag::string_view:
+        string_view_value = other.string_view_value;
+        break;
+    case tag::lazy:
+        new (&lazy_value) std::unique_ptr<Lazy_t>(std::move(other.lazy_value));
+        break;
     }
 }
 
@@ -89,7 +176,9 @@ FragmentValue_t &FragmentValue_t::operator=(FragmentValue_t &&other) noexcept {
                 frag_ptr_value = other.frag_ptr_value;
                 break;
             case tag::list:
-                list_value = std::move(other.list_value);
+                // the moved value takes the list, the existing one is kept
+                if (list_value) *list_value = std::move(*other.list_value);
+                else std::swap(list_value, other.list_value);
                 break;
             case tag::string:
                 string_value = std::move(other.string_value);
@@ -100,6 +189,12 @@ FragmentValue_t &FragmentValue_t::operator=(FragmentValue_t &&other) noexcept {
             case tag::real:
                 real_value = other.real_value;
                 break;
+            case tag::string_view:
+                string_view_value = other.string_view_value;
+                break;
+            case tag::lazy:
+                lazy_value = std::move(other.lazy_value);
+                break;
             }
         } else {
             this->~FragmentValue_t();
@@ -118,7 +213,7 @@ FragmentValue_t::~FragmentValue_t() noexcept {
     case tag::frag_ptr:
         break;
     case tag::list:
-        dispose(&list_value);
+        release(list_value);
         break;
     case tag::string:
         dispose(&string_value);
@@ -127,6 +222,11 @@ FragmentValue_t::~FragmentValue_t() noexcept {
         break;
     case tag::real:
         break;
+    case tag::string_view:
+        break;
+    case tag::lazy:
+        dispose(&lazy_value);
+        break;
     }
 }
 
@@ -141,7 +241,7 @@ void FragmentValue_t::setValue(const std::string &new_value) {
         throw std::runtime_error(__PRETTY_FUNCTION__);
         break;
     case tag::list:
-        dispose(&list_value);
+        release(list_value);
         new (&string_value) std::string(new_value);
         tag_value = tag::string;
         break;
@@ -156,6 +256,54 @@ void FragmentValue_t::setValue(const std::string &new_value) {
         new (&string_value) std::string(new_value);
         tag_value = tag::string;
         break;
+    case tag::string_view:
+        new (&string_value) std::string(new_value);
+        tag_value = tag::string;
+        break;
+    case tag::lazy:
+        dispose(&lazy_value);
+        new (&string_value) std::string(new_value);
+        tag_value = tag::string;
+        break;
+    }
+}
+
+void FragmentValue_t::setView(string_view_t new_value) {
+    switch (tag_value) {
+    case tag::frag:
+        dispose(&frag_value);
+        new (&string_view_value) string_view_t(new_value);
+        tag_value = tag::string_view;
+        break;
+    case tag::frag_ptr:
+        throw std::runtime_error(__PRETTY_FUNCTION__);
+        break;
+    case tag::list:
+        release(list_value);
+        new (&string_view_value) string_view_t(new_value);
+        tag_value = tag::string_view;
+        break;
+    case tag::string:
+        dispose(&string_value);
+        new (&string_view_value) string_view_t(new_value);
+        tag_value = tag::string_view;
+        break;
+    case tag::integral:
+        new (&string_view_value) string_view_t(new_value);
+        tag_value = tag::string_view;
+        break;
+    case tag::real:
+        new (&string_view_value) string_view_t(new_value);
+        tag_value = tag::string_view;
+        break;
+    case tag::string_view:
+        string_view_value = new_value;
+        break;
+    case tag::lazy:
+        dispose(&lazy_value);
+        new (&string_view_value) string_view_t(new_value);
+        tag_value = tag::string_view;
+        break;
     }
 }
 
@@ -170,7 +318,7 @@ void FragmentValue_t::setInt(const IntType_t new_value) {
         throw std::runtime_error(__PRETTY_FUNCTION__);
         break;
     case tag::list:
-        dispose(&list_value);
+        release(list_value);
         integral_value = new_value;
         tag_value = tag::integral;
         break;
@@ -186,6 +334,15 @@ void FragmentValue_t::setInt(const IntType_t new_value) {
         integral_value = new_value;
         tag_value = tag::integral;
         break;
+    case tag::string_view:
+        integral_value = new_value;
+        tag_value = tag::integral;
+        break;
+    case tag::lazy:
+        dispose(&lazy_value);
+        integral_value = new_value;
+        tag_value = tag::integral;
+        break;
     }
 }
 
@@ -200,7 +357,7 @@ void FragmentValue_t::setDouble(double new_value) {
         throw std::runtime_error(__PRETTY_FUNCTION__);
         break;
     case tag::list:
-        dispose(&list_value);
+        release(list_value);
         real_value = new_value;
         tag_value = tag::real;
         break;
@@ -216,6 +373,15 @@ void FragmentValue_t::setDouble(double new_value) {
     case tag::real:
         real_value = new_value;
         break;
+    case tag::string_view:
+        real_value = new_value;
+        tag_value = tag::real;
+        break;
+    case tag::lazy:
+        dispose(&lazy_value);
+        real_value = new_value;
+        tag_value = tag::real;
+        break;
     }
 }
 
@@ -237,6 +403,10 @@ std::string FragmentValue_t::toString() const {
         return stringify(integral_value);
     case tag::real:
         return stringify(real_value);
+    case tag::string_view:
+        return string_view_value.str();
+    case tag::lazy:
+        return "";
     }
     throw std::runtime_error(__PRETTY_FUNCTION__);
 }
@@ -250,7 +420,7 @@ void FragmentValue_t::json(std::ostream &o) const {
         frag_ptr_value->json(o);
         break;
     case tag::list:
-        list_value.json(o);
+        list_value->json(o);
         break;
     case tag::string:
         json::quote_string(o, string_value);
@@ -261,6 +431,12 @@ void FragmentValue_t::json(std::ostream &o) const {
     case tag::real:
         o << real_value;
         break;
+    case tag::string_view:
+        json::quote_string(o, string_view_value);
+        break;
+    case tag::lazy:
+        materialize().json(o);
+        break;
     }
 }
 
@@ -273,7 +449,7 @@ void FragmentValue_t::dump(std::ostream &o) const {
         frag_ptr_value->dump(o);
         break;
     case tag::list:
-        list_value.dump(o);
+        list_value->dump(o);
         break;
     case tag::string:
         o << '\'' << string_value << '\'';
@@ -284,39 +460,36 @@ void FragmentValue_t::dump(std::ostream &o) const {
     case tag::real:
         o << '\'' << stringify(real_value) << '\'';
         break;
+    case tag::string_view:
+        o << '\'' << string_view_value << '\'';
+        break;
+    case tag::lazy:
+        materialize().dump(o);
+        break;
     }
 }
 
-FragmentList_t &FragmentValue_t::ensureFragmentList() {
+FragmentList_t &
+FragmentValue_t::ensureFragmentList(std::pmr::memory_resource *arena) {
     switch (tag_value) {
-    case tag::frag:
-        dispose(&frag_value);
-        new (&list_value) FragmentList_t();
-        tag_value = tag::list;
-        break;
+    case tag::list:
+        return *list_value;
     case tag::frag_ptr:
         throw std::runtime_error(__PRETTY_FUNCTION__);
-        break;
-    case tag::list:
-        break;
-    case tag::string:
-        dispose(&string_value);
-        new (&list_value) FragmentList_t();
-        tag_value = tag::list;
-        break;
-    case tag::integral:
-        new (&list_value) FragmentList_t();
-        tag_value = tag::list;
-        break;
-    case tag::real:
-        new (&list_value) FragmentList_t();
-        tag_value = tag::list;
+    default:
         break;
     }
-    return list_value;
+
+    // allocate the list before the current value is destroyed
+    auto *list = make_list(arena, arena);
+    this->~FragmentValue_t();
+    tag_value = tag::list;
+    list_value = list;
+    return *list_value;
 }
 
-Fragment_t &FragmentValue_t::ensureFragment() {
+Fragment_t &
+FragmentValue_t::ensureFragment(std::pmr::memory_resource *arena) {
     switch (tag_value) {
     case tag::frag:
         break;
@@ -324,21 +497,30 @@ Fragment_t &FragmentValue_t::ensureFragment() {
         throw std::runtime_error(__PRETTY_FUNCTION__);
         break;
     case tag::list:
-        dispose(&frag_value);
-        new (&frag_value) Fragment_t();
+        release(list_value);
+        new (&frag_value) Fragment_t(arena);
         tag_value = tag::frag;
         break;
     case tag::string:
         dispose(&string_value);
-        new (&frag_value) Fragment_t();
+        new (&frag_value) Fragment_t(arena);
         tag_value = tag::frag;
         break;
     case tag::integral:
-        new (&frag_value) Fragment_t();
+        new (&frag_value) Fragment_t(arena);
         tag_value = tag::frag;
         break;
     case tag::real:
-        new (&frag_value) Fragment_t();
+        new (&frag_value) Fragment_t(arena);
+        tag_value = tag::frag;
+        break;
+    case tag::string_view:
+        new (&frag_value) Fragment_t(arena);
+        tag_value = tag::frag;
+        break;
+    case tag::lazy:
+        dispose(&lazy_value);
+        new (&frag_value) Fragment_t(arena);
         tag_value = tag::frag;
         break;
     }
@@ -105,6 +105,14 @@ FunctionStub_t builtin_functions[] = {
     {nullptr,  nullptr}                        // end of list
 };
 
+/** The builtin functions whose results don't depend on their args only.
+ */
+const char *variant_functions[] = {
+    "random",
+    "now",
+    nullptr
+};
+
 } // namespace
 
 Invoker_t<Function_t>
@@ -115,5 +123,12 @@ findFunction(const std::string &name) {
     return {name, nullptr};
 }
 
+bool isInvariantFunction(const std::string &name) {
+    for (auto *p = variant_functions; *p; ++p)
+        if (*p == name)
+            return false;
+    return true;
+}
+
 } // namespace Teng
 
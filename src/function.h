@@ -43,10 +43,11 @@
 
 namespace Teng {
 
-/** Teng builtin functions type.
+/** Teng builtin functions type. The args are view of the value stack, so
+ * they are valid only during the call.
  */
 using Function_t
-    = FunctionResult_t (*)(FunctionCtx_t &, const FunctionArgs_t &);
+    = FunctionResult_t (*)(FunctionCtx_t &, const FunctionArgsView_t &);
 
 /**
  * @short Finds builtin function in global list, returns pointer or nullptr.
@@ -55,6 +56,14 @@ using Function_t
  */
 Invoker_t<Function_t> findFunction(const std::string &name);
 
+/**
+ * @short Returns true if the builtin function returns the same result each
+ * time it is called with the same args (e.g. random() doesn't).
+ *
+ * @param name name of the function
+ */
+bool isInvariantFunction(const std::string &name);
+
 } // namespace Teng
 
 #endif // TENGFUNCTION_H
@@ -56,7 +56,7 @@ namespace builtin {
 
 // shortcuts
 using Ctx_t = FunctionCtx_t;
-using Args_t = FunctionArgs_t;
+using Args_t = FunctionArgsView_t;
 using Result_t = FunctionResult_t;
 
 /** Handy struct that caches converted numeric arguments to string.
@@ -44,8 +44,10 @@
 #include <unistd.h>
 
 #include "regex.h"
+#include "bytecode.h"
 #include "filestream.h"
 #include "instruction.h"
+#include "util.h"
 #include "contenttype.h"
 #include "teng/value.h"
 
@@ -69,6 +71,345 @@ std::string pad(std::string name) {
     return name.append(20 - name.size(), ' ');
 }
 
+/** Visits the params of instructions that have none. The archive is either
+ * BytecodeWriter_t or BytecodeReader_t.
+ */
+template <typename archive_t, typename instr_t>
+void params(archive_t &, instr_t &) {}
+
+template <typename archive_t>
+void params(archive_t &ar, PushFragIndex_t &instr) {
+    ar(instr.frame_offset, instr.frag_offset);
+}
+
+template <typename archive_t>
+void params(archive_t &ar, PushFragCount_t &instr) {
+    ar(instr.frame_offset, instr.frag_offset);
+}
+
+template <typename archive_t>
+void params(archive_t &ar, PushFragFirst_t &instr) {
+    ar(instr.frame_offset, instr.frag_offset);
+}
+
+template <typename archive_t>
+void params(archive_t &ar, PushFragInner_t &instr) {
+    ar(instr.frame_offset, instr.frag_offset);
+}
+
+template <typename archive_t>
+void params(archive_t &ar, PushFragLast_t &instr) {
+    ar(instr.frame_offset, instr.frag_offset);
+}
+
+template <typename archive_t>
+void params(archive_t &ar, PushFrag_t &instr) {
+    ar(instr.name, instr.frame_offset, instr.frag_offset);
+}
+
+template <typename archive_t>
+void params(archive_t &ar, PushValCount_t &instr) {ar(instr.path);}
+
+template <typename archive_t>
+void params(archive_t &ar, PushValFirst_t &instr) {ar(instr.path);}
+
+template <typename archive_t>
+void params(archive_t &ar, PushValLast_t &instr) {ar(instr.path);}
+
+template <typename archive_t>
+void params(archive_t &ar, PushValInner_t &instr) {ar(instr.path);}
+
+template <typename archive_t>
+void params(archive_t &ar, PushValIndex_t &instr) {ar(instr.path);}
+
+template <typename archive_t>
+void params(archive_t &ar, PushRootFrag_t &instr) {ar(instr.root_frag_offset);}
+
+template <typename archive_t>
+void params(archive_t &ar, Val_t &instr) {ar(instr.value);}
+
+template <typename archive_t>
+void params(archive_t &ar, Var_t &instr) {
+    ar(instr.name, instr.frame_offset, instr.frag_offset, instr.escape);
+}
+
+template <typename archive_t>
+void params(archive_t &ar, PrgStackAt_t &instr) {ar(instr.index);}
+
+template <typename archive_t>
+void params(archive_t &ar, And_t &instr) {ar(instr.addr_offset);}
+
+template <typename archive_t>
+void params(archive_t &ar, Or_t &instr) {ar(instr.addr_offset);}
+
+template <typename archive_t>
+void params(archive_t &ar, Func_t &instr) {
+    ar(instr.name, instr.nargs, instr.is_udf);
+}
+
+template <typename archive_t>
+void params(archive_t &ar, JmpIfNot_t &instr) {ar(instr.addr_offset);}
+
+template <typename archive_t>
+void params(archive_t &ar, Jmp_t &instr) {ar(instr.addr_offset);}
+
+template <typename archive_t>
+void params(archive_t &ar, OpenFormat_t &instr) {ar(instr.mode);}
+
+template <typename archive_t>
+void params(archive_t &ar, OpenFrag_t &instr) {
+    ar(instr.name, instr.close_frag_offset);
+}
+
+template <typename archive_t>
+void params(archive_t &ar, OpenErrorFrag_t &instr) {
+    params(ar, static_cast<OpenFrag_t &>(instr));
+}
+
+template <typename archive_t>
+void params(archive_t &ar, CloseFrag_t &instr) {ar(instr.open_frag_offset);}
+
+template <typename archive_t>
+void params(archive_t &ar, Print_t &instr) {
+    ar(instr.print_escape, instr.unoptimizable);
+}
+
+template <typename archive_t>
+void params(archive_t &ar, PrintVar_t &instr) {
+    params(ar, static_cast<Var_t &>(instr));
+}
+
+template <typename archive_t>
+void params(archive_t &ar, PrintVal_t &instr) {
+    params(ar, static_cast<Val_t &>(instr));
+}
+
+template <typename archive_t>
+void params(archive_t &ar, JmpIfVarNot_t &instr) {
+    params(ar, static_cast<Var_t &>(instr));
+}
+
+template <typename archive_t>
+void params(archive_t &ar, Set_t &instr) {
+    ar(instr.name, instr.frame_offset, instr.frag_offset);
+}
+
+template <typename archive_t>
+void params(archive_t &ar, OpenCType_t &instr) {ar(instr.ctype);}
+
+template <typename archive_t>
+void params(archive_t &ar, PushAttr_t &instr) {ar(instr.name, instr.path);}
+
+template <typename archive_t>
+void params(archive_t &ar, PushAttrAt_t &instr) {ar(instr.path);}
+
+template <typename archive_t>
+void params(archive_t &ar, MatchRegex_t &instr) {ar(instr.compiled_value);}
+
+template <typename archive_t>
+void params(archive_t &ar, PushErrorFrag_t &instr) {
+    ar(instr.discard_stack_value);
+}
+
+template <typename archive_t>
+void params(archive_t &ar, Call_t &instr) {ar(instr.name, instr.addr);}
+
+/** Mimics the semantic variable for the instructions that are built from
+ * it. The real params are read from bytecode later.
+ */
+struct BlankVariable_t {
+    struct Ident_t {string_view_t name() const {return {};}};
+    struct Offset_t {uint64_t frame = 0; uint64_t frag = 0;};
+    Ident_t ident;   //!< empty identifier
+    Offset_t offset; //!< zero offsets
+};
+
+/** Creates the instruction with blank params; the instructions that have
+ * c'tor without params.
+ */
+template <typename Impl_t>
+InstrBox_t blank(InstrType_t<Impl_t> type, ConstantPool_t &) {
+    return {type};
+}
+
+/** Creates the instruction with blank params; the instructions built from
+ * semantic variable.
+ */
+template <typename Impl_t, typename... args_t>
+InstrBox_t blank_var(InstrType_t<Impl_t> type, args_t &&...args) {
+    return {type, std::forward<args_t>(args)..., BlankVariable_t{}};
+}
+
+InstrBox_t blank(InstrType_t<PushFragIndex_t> type, ConstantPool_t &) {
+    return blank_var(type);
+}
+
+InstrBox_t blank(InstrType_t<PushFragCount_t> type, ConstantPool_t &) {
+    return blank_var(type);
+}
+
+InstrBox_t blank(InstrType_t<PushFragFirst_t> type, ConstantPool_t &) {
+    return blank_var(type);
+}
+
+InstrBox_t blank(InstrType_t<PushFragInner_t> type, ConstantPool_t &) {
+    return blank_var(type);
+}
+
+InstrBox_t blank(InstrType_t<PushFragLast_t> type, ConstantPool_t &) {
+    return blank_var(type);
+}
+
+InstrBox_t blank(InstrType_t<Var_t> type, ConstantPool_t &pool) {
+    return {type, pool, BlankVariable_t{}, false};
+}
+
+InstrBox_t blank(InstrType_t<Set_t> type, ConstantPool_t &pool) {
+    return blank_var(type, pool);
+}
+
+InstrBox_t blank(InstrType_t<PushFrag_t> type, ConstantPool_t &pool) {
+    return {type, pool, uint64_t(0), uint64_t(0)};
+}
+
+InstrBox_t blank(InstrType_t<PushValCount_t> type, ConstantPool_t &pool) {
+    return {type, pool, std::string()};
+}
+
+InstrBox_t blank(InstrType_t<PushValFirst_t> type, ConstantPool_t &pool) {
+    return {type, pool, std::string()};
+}
+
+InstrBox_t blank(InstrType_t<PushValLast_t> type, ConstantPool_t &pool) {
+    return {type, pool, std::string()};
+}
+
+InstrBox_t blank(InstrType_t<PushValInner_t> type, ConstantPool_t &pool) {
+    return {type, pool, std::string()};
+}
+
+InstrBox_t blank(InstrType_t<PushValIndex_t> type, ConstantPool_t &pool) {
+    return {type, pool, std::string()};
+}
+
+InstrBox_t blank(InstrType_t<Val_t> type, ConstantPool_t &pool) {
+    return {type, pool};
+}
+
+InstrBox_t blank(InstrType_t<PrgStackAt_t> type, ConstantPool_t &) {
+    return {type, std::size_t(0)};
+}
+
+InstrBox_t blank(InstrType_t<Func_t> type, ConstantPool_t &pool) {
+    return {type, pool, std::string(), uint32_t(0), false};
+}
+
+InstrBox_t blank(InstrType_t<OpenFormat_t> type, ConstantPool_t &) {
+    return {type, int64_t(0)};
+}
+
+InstrBox_t blank(InstrType_t<OpenFrag_t> type, ConstantPool_t &pool) {
+    return {type, pool, std::string()};
+}
+
+InstrBox_t blank(InstrType_t<OpenErrorFrag_t> type, ConstantPool_t &pool) {
+    return {type, pool};
+}
+
+InstrBox_t blank(InstrType_t<Print_t> type, ConstantPool_t &) {
+    return {type, false};
+}
+
+InstrBox_t blank(InstrType_t<PrintVar_t> type, ConstantPool_t &pool) {
+    return {type, Var_t(pool, BlankVariable_t{}, false)};
+}
+
+InstrBox_t blank(InstrType_t<PrintVal_t> type, ConstantPool_t &pool) {
+    return {type, Val_t(pool)};
+}
+
+InstrBox_t blank(InstrType_t<JmpIfVarNot_t> type, ConstantPool_t &pool) {
+    return {type, Var_t(pool, BlankVariable_t{}, false)};
+}
+
+InstrBox_t blank(InstrType_t<OpenCType_t> type, ConstantPool_t &) {
+    return {type, nullptr};
+}
+
+InstrBox_t blank(InstrType_t<PushAttr_t> type, ConstantPool_t &pool) {
+    return {type, pool, std::string(), std::string()};
+}
+
+InstrBox_t blank(InstrType_t<PushAttrAt_t> type, ConstantPool_t &pool) {
+    return {type, pool, std::string()};
+}
+
+InstrBox_t blank(InstrType_t<MatchRegex_t> type, ConstantPool_t &) {
+    return {type, counted_ptr<Regex_t>()};
+}
+
+InstrBox_t blank(InstrType_t<PushErrorFrag_t> type, ConstantPool_t &) {
+    return {type, false};
+}
+
+InstrBox_t blank(InstrType_t<Call_t> type, ConstantPool_t &pool) {
+    return {type, pool, std::string(), int64_t(0)};
+}
+
+/** Creates the instruction of given type and reads its params from the
+ * bytecode.
+ */
+template <typename Impl_t>
+InstrBox_t read_instr(InstrType_t<Impl_t> type, BytecodeReader_t &in) {
+    auto instr = blank(type, in.pool());
+    params(in, instr.template as<Impl_t>());
+    return instr;
+}
+
+/** Creates the function call instruction and reads its params from the
+ * bytecode. The function pointers aren't stored, so the function is looked
+ * up again in the current process.
+ */
+InstrBox_t read_instr(InstrType_t<Func_t> type, BytecodeReader_t &in) {
+    auto instr = blank(type, in.pool());
+    params(in, instr.as<Func_t>());
+    instr.as<Func_t>().bind();
+    return instr;
+}
+
+/** Creates the variable instruction and reads its params from the bytecode.
+ * The hash of variable name isn't stored, so it is computed again.
+ */
+template <
+    typename Impl_t,
+    std::enable_if_t<std::is_base_of<Var_t, Impl_t>::value, bool> = true
+> InstrBox_t read_var_instr(InstrType_t<Impl_t> type, BytecodeReader_t &in) {
+    auto instr = blank(type, in.pool());
+    params(in, instr.template as<Impl_t>());
+    instr.template as<Impl_t>().bind();
+    return instr;
+}
+
+InstrBox_t read_instr(InstrType_t<Var_t> type, BytecodeReader_t &in) {
+    return read_var_instr(type, in);
+}
+
+InstrBox_t read_instr(InstrType_t<PrintVar_t> type, BytecodeReader_t &in) {
+    return read_var_instr(type, in);
+}
+
+InstrBox_t read_instr(InstrType_t<JmpIfVarNot_t> type, BytecodeReader_t &in) {
+    return read_var_instr(type, in);
+}
+
+/** Pretends the instruction of any type, so eval() can be used to map
+ * opcode to the type of instruction.
+ */
+struct InstrTypeOf_t {
+    template <typename Impl_t>
+    InstrType_t<Impl_t> as() const {return {};}
+};
+
 } // namespace
 
 /** Casts given value to appropriate type and calls given callback with given
@@ -482,6 +823,21 @@ static auto eval(OPCODE opcode, type_t &self, call_t &&call, args_t &&...args) {
             self.template as<LogSuppress_t>(),
             std::forward<args_t>(args)...
         );
+    case OPCODE::PRINT_VAR:
+        return call(
+            self.template as<PrintVar_t>(),
+            std::forward<args_t>(args)...
+        );
+    case OPCODE::PRINT_VAL:
+        return call(
+            self.template as<PrintVal_t>(),
+            std::forward<args_t>(args)...
+        );
+    case OPCODE::JMP_IF_VAR_NOT:
+        return call(
+            self.template as<JmpIfVarNot_t>(),
+            std::forward<args_t>(args)...
+        );
     case OPCODE::RETURN:
         return call(
             self.template as<Return_t>(),
@@ -578,6 +934,9 @@ const char *opcode_str(OPCODE opcode) {
     case OPCODE::CLOSE_FRAME: return "CLOSE_FRAME";
     case OPCODE::MATCH_REGEX: return "MATCH_REGEX";
     case OPCODE::LOG_SUPPRESS: return "LOG_SUPPRESS";
+    case OPCODE::PRINT_VAR: return "PRINT_VAR";
+    case OPCODE::PRINT_VAL: return "PRINT_VAL";
+    case OPCODE::JMP_IF_VAR_NOT: return "JMP_IF_VAR_NOT";
     case OPCODE::RETURN: return "RETURN";
     case OPCODE::CALL: return "CALL";
     }
@@ -594,6 +953,14 @@ void Instruction_t::dump(std::ostream &os) const {
     eval(opcode_value, *this, [&] (auto &self) {self.dump_params(os);});
 }
 
+void Instruction_t::write_params(BytecodeWriter_t &out) const {
+    eval(opcode_value, *this, [&] (auto &self) {
+        // the writer only reads the params
+        using Impl_t = std::decay_t<decltype(self)>;
+        params(out, const_cast<Impl_t &>(self));
+    });
+}
+
 template <typename ImplArg_t>
 InstrBox_t::InstrBox_t(ImplArg_t &&other) noexcept
     : Instruction_t(nullptr)
@@ -604,6 +971,11 @@ InstrBox_t::InstrBox_t(ImplArg_t &&other) noexcept
         "The size of InstrBox_t padding has to be updated because used "
         "Instruction_t is bigger than current padding!"
     );
+    static_assert(
+        alignof(Impl_t) <= alignof(InstrBox_t),
+        "The alignment of InstrBox_t has to be updated because used "
+        "Instruction_t requires stricter alignment!"
+    );
     static_assert(
         std::is_base_of<Instruction_t, Impl_t>::value,
         "The given instruction is not inherited from Instruction_t "
@@ -620,9 +992,6 @@ InstrBox_t::InstrBox_t(ImplArg_t &&other) noexcept
     new (this) Impl_t(std::move(other));
 }
 
-template
-InstrBox_t::InstrBox_t(PushFrag_t &&);
-
 InstrBox_t::InstrBox_t(InstrBox_t &&other) noexcept
     : Instruction_t(nullptr)
 {
@@ -638,6 +1007,15 @@ InstrBox_t::~InstrBox_t() noexcept {
     });
 }
 
+InstrBox_t InstrBox_t::read(OPCODE opcode, BytecodeReader_t &in) {
+    if (opcode > OPCODE::CALL)
+        throw bad_bytecode_t("unknown opcode " + std::to_string(int(opcode)));
+    const InstrTypeOf_t type_of;
+    return eval(opcode, type_of, [&] (auto type) {
+        return read_instr(type, in);
+    });
+}
+
 void PushFragIndex_t::dump_params(std::ostream &os) const {
     os << "<frame-offset=" << frame_offset
        << ",frag-offset=" << frag_offset
@@ -669,32 +1047,32 @@ void PushFragLast_t::dump_params(std::ostream &os) const {
 }
 
 void PushValCount_t::dump_params(std::ostream &os) const {
-    os << "<path=" << path
+    os << "<path=" << *path
        << '>';
 }
 
 void PushValIndex_t::dump_params(std::ostream &os) const {
-    os << "<path=" << path
+    os << "<path=" << *path
        << '>';
 }
 
 void PushValFirst_t::dump_params(std::ostream &os) const {
-    os << "<path=" << path
+    os << "<path=" << *path
        << '>';
 }
 
 void PushValLast_t::dump_params(std::ostream &os) const {
-    os << "<path=" << path
+    os << "<path=" << *path
        << '>';
 }
 
 void PushValInner_t::dump_params(std::ostream &os) const {
-    os << "<path=" << path
+    os << "<path=" << *path
        << '>';
 }
 
 void PushFrag_t::dump_params(std::ostream &os) const {
-    os << "<name=" << name
+    os << "<name=" << *name
        << ",frame-offset=" << frame_offset
        << ",frag-offset=" << frag_offset
        << '>';
@@ -706,13 +1084,13 @@ void PushRootFrag_t::dump_params(std::ostream &os) const {
 }
 
 void Val_t::dump_params(std::ostream &os) const {
-    os << "<value=" << escapenl(value.printable())
-       << ",type=" << value.type_str()
+    os << "<value=" << escapenl(value->printable())
+       << ",type=" << value->type_str()
        << '>';
 }
 
 void Var_t::dump_params(std::ostream &os) const {
-    os << "<name=" << name
+    os << "<name=" << *name
        << ",escape=" << std::boolalpha << escape << std::noboolalpha
        << ",frame-offset=" << frame_offset
        << ",frag-offset=" << frag_offset
@@ -732,7 +1110,12 @@ void Or_t::dump_params(std::ostream &os) const {
 }
 
 void Func_t::dump_params(std::ostream &os) const {
-    os << "<name=" << name << ",#args=" << nargs << '>';
+    os << "<name=" << *name << ",#args=" << nargs << '>';
+}
+
+void Func_t::bind() {
+    if (is_udf) udf = udf::findSlot(*name);
+    else builtin = findFunction(*name).function;
 }
 
 void JmpIfNot_t::dump_params(std::ostream &os) const {
@@ -748,7 +1131,7 @@ void OpenFormat_t::dump_params(std::ostream &os) const {
 }
 
 void OpenFrag_t::dump_params(std::ostream &os) const {
-    os << "<name=" << name
+    os << "<name=" << *name
        << ",close-frag-offset=" << std::showpos << close_frag_offset
        << '>' << std::noshowpos;
 }
@@ -765,7 +1148,7 @@ void Print_t::dump_params(std::ostream &os) const {
 }
 
 void Set_t::dump_params(std::ostream &os) const {
-    os << "<name=" << name
+    os << "<name=" << *name
        << ",frame-offset=" << frame_offset
        << ",frag-offset=" << frag_offset
        << '>';
@@ -776,13 +1159,13 @@ void OpenCType_t::dump_params(std::ostream &os) const {
 }
 
 void PushAttr_t::dump_params(std::ostream &os) const {
-    os << "<name=" << name
-       << ",path=" << path
+    os << "<name=" << *name
+       << ",path=" << *path
        << '>';
 }
 
 void PushAttrAt_t::dump_params(std::ostream &os) const {
-    os << "<path=" << path
+    os << "<path=" << *path
        << '>';
 }
 
@@ -790,8 +1173,8 @@ void MatchRegex_t::dump_params(std::ostream &os) const {
     os << "<regex=" << compiled_value->pattern() << '>';
 }
 
-MatchRegex_t::MatchRegex_t(counted_ptr<Regex_t> regex, const Pos_t &pos)
-    : Instruction_t(instr_opcode, pos),
+MatchRegex_t::MatchRegex_t(counted_ptr<Regex_t> regex)
+    : Instruction_t(instr_opcode),
       compiled_value(std::move(regex))
 {}
 
@@ -809,7 +1192,7 @@ void PushErrorFrag_t::dump_params(std::ostream &os) const {
 
 void Call_t::dump_params(std::ostream &os) const {
     os << "<addr=" << addr
-       << ",name=" << name
+       << ",name=" << *name
        << '>';
 }
 
@@ -41,20 +41,30 @@
 #include <string>
 #include <vector>
 #include <iosfwd>
+#include <limits>
+#include <cstdint>
+#include <stdexcept>
 
 #include "position.h"
 #include "identifier.h"
 #include "contenttype.h"
+#include "constantpool.h"
+#include "function.h"
 #include "teng/value.h"
+#include "teng/structs.h"
+#include "teng/udf.h"
 
 namespace Teng {
 
 // forwards
 class Regex_t;
+class BytecodeWriter_t;
+class BytecodeReader_t;
 
-/** Allowed operation codes.
+/** Allowed operation codes; one byte, so the instruction params can be
+ * packed right behind it.
  */
-enum class OPCODE {
+enum class OPCODE: uint8_t {
     NOOP,            //!< Does nothing (used as the first instruction)
     VAL,             //!< Value literal
     VAR,             //!< Get value from variable
@@ -136,6 +146,9 @@ enum class OPCODE {
     ISREGEX,         //!< Push true on stack if arg is regular expression
     MATCH_REGEX,     //!< Matching of regular expression
     LOG_SUPPRESS,    //!< Suppressing error log
+    PRINT_VAR,       //!< Fused VAR and PRINT
+    PRINT_VAL,       //!< Fused VAL and PRINT
+    JMP_IF_VAR_NOT,  //!< Fused VAR and JMP_IF_NOT
     RETURN,          //!< Implements return from subroutine
     CALL,            //!< Pushes return address and jumps to subroutine
 };
@@ -156,6 +169,19 @@ struct bad_instr_cast_t: public std::runtime_error {
     {}
 };
 
+/** Narrows the relative jump offset (or the address of subroutine) to the
+ * int32 operand of instruction. Throws if the program is so large that the
+ * target can't be reached.
+ */
+inline int32_t jump_offset(int64_t offset) {
+    if ((offset < std::numeric_limits<int32_t>::min())
+        || (offset > std::numeric_limits<int32_t>::max()))
+        throw std::length_error(
+            "the jump offset is out of range: " + std::to_string(offset)
+        );
+    return static_cast<int32_t>(offset);
+}
+
 /** Instruction for "teng computer".
   * Syntax & semanthics analyzer creates program (sequence of instructions).
   */
@@ -179,10 +205,10 @@ public:
      */
     const char *instr_name() const {return opcode_str(opcode_value);}
 
-    /** Returns position of token in source code that generates this
-     * instruction.
+    /** Writes the instruction params (not the opcode and position) to the
+     * bytecode.
      */
-    const Pos_t &pos() const {return pos_value;}
+    void write_params(BytecodeWriter_t &out) const;
 
     /** Casts this instruction to its real type. Does not any checks, so don't
      * shoot your foot.
@@ -219,15 +245,14 @@ protected:
 
     /** Create simple instruction without params.
      * @param op Inctruction code.
-     * @param pos Position of instruction in source file.
      */
-    Instruction_t(OPCODE opcode_value, const Pos_t &pos)
-        : opcode_value(opcode_value), pos_value(pos)
+    explicit Instruction_t(OPCODE opcode_value)
+        : opcode_value(opcode_value)
     {}
 
     /** @short Lefts instruction object uninitialized.
      */
-    Instruction_t(std::nullptr_t): pos_value(nullptr) {}
+    Instruction_t(std::nullptr_t) {}
 
     /** The instruction implementation can override dump_params to write its
      * parametr to stream.
@@ -235,360 +260,359 @@ protected:
     void dump_params(std::ostream &) const {}
 
     OPCODE opcode_value; //!< operation to perform
-    Pos_t pos_value;     //!< the position of instruction in source file
 };
 
 struct Noop_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::NOOP;
-    Noop_t(const Pos_t &pos = {})
-        : Instruction_t(instr_opcode, pos)
+    Noop_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct Dict_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::DICT;
-    Dict_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    Dict_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct PrgStackPush_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::PRG_STACK_PUSH;
-    PrgStackPush_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    PrgStackPush_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct PrgStackPop_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::PRG_STACK_POP;
-    PrgStackPop_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    PrgStackPop_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct UnaryPlus_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::UNARY_PLUS;
-    UnaryPlus_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    UnaryPlus_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct UnaryMinus_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::UNARY_MINUS;
-    UnaryMinus_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    UnaryMinus_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct Plus_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::PLUS;
-    Plus_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    Plus_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct Minus_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::MINUS;
-    Minus_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    Minus_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct Mul_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::MUL;
-    Mul_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    Mul_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct Div_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::DIV;
-    Div_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    Div_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct Mod_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::MOD;
-    Mod_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    Mod_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct Concat_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::CONCAT;
-    Concat_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    Concat_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct Repeat_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::REPEAT;
-    Repeat_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    Repeat_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct BitAnd_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::BIT_AND;
-    BitAnd_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    BitAnd_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct BitXor_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::BIT_XOR;
-    BitXor_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    BitXor_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct BitOr_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::BIT_OR;
-    BitOr_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    BitOr_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct BitNot_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::BIT_NOT;
-    BitNot_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    BitNot_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct Not_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::NOT;
-    Not_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    Not_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct EQ_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::EQ;
-    EQ_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    EQ_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct NE_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::NE;
-    NE_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    NE_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct GE_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::GE;
-    GE_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    GE_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct GT_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::GT;
-    GT_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    GT_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct LE_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::LE;
-    LE_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    LE_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct LT_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::LT;
-    LT_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    LT_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct StrEQ_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::STR_EQ;
-    StrEQ_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    StrEQ_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct StrNE_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::STR_NE;
-    StrNE_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    StrNE_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct Halt_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::HALT;
-    Halt_t(const Pos_t &pos = {})
-        : Instruction_t(instr_opcode, pos)
+    Halt_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct DebugFrag_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::DEBUG_FRAG;
-    DebugFrag_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    DebugFrag_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct BytecodeFrag_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::BYTECODE_FRAG;
-    BytecodeFrag_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    BytecodeFrag_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct CloseFormat_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::CLOSE_FORMAT;
-    CloseFormat_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    CloseFormat_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct CloseCType_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::CLOSE_CTYPE;
-    CloseCType_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    CloseCType_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct PopAttr_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::POP_ATTR;
-    PopAttr_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    PopAttr_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct PushThisFrag_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::PUSH_THIS_FRAG;
-    PushThisFrag_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    PushThisFrag_t()
+        : Instruction_t(instr_opcode)
     {}
     // provide same iface as push root frag has
-    PushThisFrag_t(uint64_t, const Pos_t &pos)
-        : PushThisFrag_t(pos)
+    PushThisFrag_t(uint64_t)
+        : PushThisFrag_t()
     {}
 };
 
 struct OpenFrame_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::OPEN_FRAME;
-    OpenFrame_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    OpenFrame_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct CloseFrame_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::CLOSE_FRAME;
-    CloseFrame_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    CloseFrame_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct Repr_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::REPR;
-    Repr_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    Repr_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct QueryRepr_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::QUERY_REPR;
-    QueryRepr_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    QueryRepr_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct QueryCount_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::QUERY_COUNT;
-    QueryCount_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    QueryCount_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct QueryType_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::QUERY_TYPE;
-    QueryType_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    QueryType_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct QueryDefined_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::QUERY_DEFINED;
-    QueryDefined_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    QueryDefined_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct QueryExists_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::QUERY_EXISTS;
-    QueryExists_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    QueryExists_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct IsEmpty_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::ISEMPTY;
-    IsEmpty_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    IsEmpty_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct IsUndefined_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::ISUNDEFINED;
-    IsUndefined_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    IsUndefined_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct IsIntegral_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::ISINTEGRAL;
-    IsIntegral_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    IsIntegral_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct IsReal_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::ISREAL;
-    IsReal_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    IsReal_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct IsString_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::ISSTRING;
-    IsString_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    IsString_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct IsFrag_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::ISFRAG;
-    IsFrag_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    IsFrag_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct IsFragList_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::ISFRAGLIST;
-    IsFragList_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    IsFragList_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct IsRegex_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::ISREGEX;
-    IsRegex_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    IsRegex_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct LogSuppress_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::LOG_SUPPRESS;
-    LogSuppress_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    LogSuppress_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
@@ -596,7 +620,7 @@ struct PushFragIndex_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::PUSH_FRAG_INDEX;
     template <typename Variable_t>
     PushFragIndex_t(const Variable_t &var)
-        : Instruction_t(instr_opcode, var.pos),
+        : Instruction_t(instr_opcode),
           frame_offset(static_cast<uint16_t>(var.offset.frame)),
           frag_offset(static_cast<uint16_t>(var.offset.frag))
     {}
@@ -609,7 +633,7 @@ struct PushFragCount_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::PUSH_FRAG_COUNT;
     template <typename Variable_t>
     PushFragCount_t(const Variable_t &var)
-        : Instruction_t(instr_opcode, var.pos),
+        : Instruction_t(instr_opcode),
           frame_offset(static_cast<uint16_t>(var.offset.frame)),
           frag_offset(static_cast<uint16_t>(var.offset.frag))
     {}
@@ -622,7 +646,7 @@ struct PushFragFirst_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::PUSH_FRAG_FIRST;
     template <typename Variable_t>
     PushFragFirst_t(const Variable_t &var)
-        : Instruction_t(instr_opcode, var.pos),
+        : Instruction_t(instr_opcode),
           frame_offset(static_cast<uint16_t>(var.offset.frame)),
           frag_offset(static_cast<uint16_t>(var.offset.frag))
     {}
@@ -635,7 +659,7 @@ struct PushFragInner_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::PUSH_FRAG_INNER;
     template <typename Variable_t>
     PushFragInner_t(const Variable_t &var)
-        : Instruction_t(instr_opcode, var.pos),
+        : Instruction_t(instr_opcode),
           frame_offset(static_cast<uint16_t>(var.offset.frame)),
           frag_offset(static_cast<uint16_t>(var.offset.frag))
     {}
@@ -648,7 +672,7 @@ struct PushFragLast_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::PUSH_FRAG_LAST;
     template <typename Variable_t>
     PushFragLast_t(const Variable_t &var)
-        : Instruction_t(instr_opcode, var.pos),
+        : Instruction_t(instr_opcode),
           frame_offset(static_cast<uint16_t>(var.offset.frame)),
           frag_offset(static_cast<uint16_t>(var.offset.frag))
     {}
@@ -659,86 +683,87 @@ struct PushFragLast_t: public Instruction_t {
 
 struct PushFrag_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::PUSH_FRAG;
-    PushFrag_t(uint64_t frame_offset, uint64_t frag_offset, const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
+    PushFrag_t(ConstantPool_t &pool, uint64_t frame_offset, uint64_t frag_offset)
+        : Instruction_t(instr_opcode),
           frame_offset(static_cast<uint16_t>(frame_offset)),
-          frag_offset(static_cast<uint16_t>(frag_offset))
+          frag_offset(static_cast<uint16_t>(frag_offset)),
+          name(pool.string({}))
     {}
     template <typename Variable_t>
-    PushFrag_t(const Variable_t &var, uint64_t frag_offset)
-        : Instruction_t(instr_opcode, var.pos),
-          name(var.ident.name().str()),
+    PushFrag_t(ConstantPool_t &pool, const Variable_t &var, uint64_t frag_offset)
+        : Instruction_t(instr_opcode),
           frame_offset(static_cast<uint16_t>(var.offset.frame)),
-          frag_offset(static_cast<uint16_t>(frag_offset))
+          frag_offset(static_cast<uint16_t>(frag_offset)),
+          name(pool.string(var.ident.name().str()))
     {}
     template <typename Variable_t>
-    PushFrag_t(const Variable_t &var)
-        : PushFrag_t(var, var.offset.frag)
+    PushFrag_t(ConstantPool_t &pool, const Variable_t &var)
+        : PushFrag_t(pool, var, var.offset.frag)
     {}
     void dump_params(std::ostream &os) const;
-    std::string name;      //!< the frag identifier
-    uint16_t frame_offset; //!< the offset of frame (NOT fragment!)
-    uint16_t frag_offset;  //!< the offset of fragment in frame
+    uint16_t frame_offset;   //!< the offset of frame (NOT fragment!)
+    uint16_t frag_offset;    //!< the offset of fragment in frame
+    const std::string *name; //!< the frag identifier
 };
 
 struct PushValCount_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::PUSH_VAL_COUNT;
-    PushValCount_t(std::string path, const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
-          path(std::move(path))
+    PushValCount_t(ConstantPool_t &pool, std::string path)
+        : Instruction_t(instr_opcode),
+          path(pool.string(std::move(path)))
     {}
     void dump_params(std::ostream &os) const;
-    std::string path; //!< path from rtvar start to this attribute
+    const std::string *path; //!< path from rtvar start to this attribute
 };
 
 struct PushValFirst_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::PUSH_VAL_FIRST;
-    PushValFirst_t(std::string path, const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
-          path(std::move(path))
+    PushValFirst_t(ConstantPool_t &pool, std::string path)
+        : Instruction_t(instr_opcode),
+          path(pool.string(std::move(path)))
     {}
     void dump_params(std::ostream &os) const;
-    std::string path; //!< path from rtvar start to this attribute
+    const std::string *path; //!< path from rtvar start to this attribute
 };
 
 struct PushValLast_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::PUSH_VAL_LAST;
-    PushValLast_t(std::string path, const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
-          path(std::move(path))
+    PushValLast_t(ConstantPool_t &pool, std::string path)
+        : Instruction_t(instr_opcode),
+          path(pool.string(std::move(path)))
     {}
     void dump_params(std::ostream &os) const;
-    std::string path; //!< path from rtvar start to this attribute
+    const std::string *path; //!< path from rtvar start to this attribute
 };
 
 struct PushValInner_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::PUSH_VAL_INNER;
-    PushValInner_t(std::string path, const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
-          path(std::move(path))
+    PushValInner_t(ConstantPool_t &pool, std::string path)
+        : Instruction_t(instr_opcode),
+          path(pool.string(std::move(path)))
     {}
     void dump_params(std::ostream &os) const;
-    std::string path; //!< path from rtvar start to this attribute
+    const std::string *path; //!< path from rtvar start to this attribute
 };
 
 struct PushValIndex_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::PUSH_VAL_INDEX;
-    PushValIndex_t(std::string path, const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
-          path(std::move(path))
+    PushValIndex_t(ConstantPool_t &pool, std::string path)
+        : Instruction_t(instr_opcode),
+          path(pool.string(std::move(path)))
     {}
     void dump_params(std::ostream &os) const;
-    std::string path; //!< path from rtvar start to this attribute
+    const std::string *path; //!< path from rtvar start to this attribute
 };
 
 struct PushRootFrag_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::PUSH_ROOT_FRAG;
-    PushRootFrag_t(uint64_t root_frag_offset, const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
+    PushRootFrag_t(uint64_t root_frag_offset)
+        : Instruction_t(instr_opcode),
           root_frag_offset(static_cast<uint16_t>(root_frag_offset))
     {}
-    PushRootFrag_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
+    PushRootFrag_t()
+        : Instruction_t(instr_opcode),
           root_frag_offset()
     {}
     void dump_params(std::ostream &os) const;
@@ -747,40 +772,55 @@ struct PushRootFrag_t: public Instruction_t {
 
 struct Val_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::VAL;
-    Val_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
-          value()
+    Val_t(ConstantPool_t &pool)
+        : Instruction_t(instr_opcode),
+          value(pool.value(Value_t()))
     {}
     template <typename type_t>
-    Val_t(type_t &&value, const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
-          value(std::forward<type_t>(value))
+    Val_t(ConstantPool_t &pool, type_t &&value)
+        : Instruction_t(instr_opcode),
+          value(pool.value(Value_t(std::forward<type_t>(value))))
+    {}
+    Val_t(OPCODE opcode, const Val_t &other)
+        : Instruction_t(opcode),
+          value(other.value)
     {}
     void dump_params(std::ostream &os) const;
-    Value_t value; //!< the literal value (string, int, real, ...)
+    Value_t *value; //!< the literal value (string, int, real, ...)
 };
 
 struct Var_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::VAR;
     template <typename Variable_t>
-    Var_t(const Variable_t &var, bool escape)
-        : Instruction_t(instr_opcode, var.pos),
-          name(var.ident.name().str()),
+    Var_t(ConstantPool_t &pool, const Variable_t &var, bool escape)
+        : Instruction_t(instr_opcode),
+          escape(escape),
           frame_offset(static_cast<uint16_t>(var.offset.frame)),
           frag_offset(static_cast<uint16_t>(var.offset.frag)),
-          escape(escape)
-    {}
+          name(pool.string(var.ident.name().str())),
+          name_hash(Fragment_t::hashName(*name))
+    {}
+    Var_t(OPCODE opcode, const Var_t &other)
+        : Instruction_t(opcode),
+          escape(other.escape),
+          frame_offset(other.frame_offset),
+          frag_offset(other.frag_offset),
+          name(other.name),
+          name_hash(other.name_hash)
+    {}
+    void bind() {name_hash = Fragment_t::hashName(*name);}
     void dump_params(std::ostream &os) const;
-    std::string name;      //!< the variable identifier
-    uint16_t frame_offset; //!< the offset of frame (NOT fragment!)
-    uint16_t frag_offset;  //!< the offset of fragment in frame
-    bool escape;           //!< true if variable has to be escaped
+    bool escape;             //!< true if variable has to be escaped
+    uint16_t frame_offset;   //!< the offset of frame (NOT fragment!)
+    uint16_t frag_offset;    //!< the offset of fragment in frame
+    const std::string *name; //!< the variable identifier
+    uint32_t name_hash;      //!< the hash of identifier (see Fragment_t)
 };
 
 struct PrgStackAt_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::PRG_STACK_AT;
-    PrgStackAt_t(std::size_t index, const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
+    PrgStackAt_t(std::size_t index)
+        : Instruction_t(instr_opcode),
           index(index)
     {}
     void dump_params(std::ostream &os) const;
@@ -789,64 +829,69 @@ struct PrgStackAt_t: public Instruction_t {
 
 struct And_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::AND;
-    And_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
+    And_t()
+        : Instruction_t(instr_opcode),
           addr_offset(-1)
     {}
     void dump_params(std::ostream &os) const;
-    int64_t addr_offset; //!< offset where to jump if AND is not satisfied
+    int32_t addr_offset; //!< offset where to jump if AND is not satisfied
 };
 
 struct Or_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::OR;
-    Or_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
+    Or_t()
+        : Instruction_t(instr_opcode),
           addr_offset(-1)
     {}
     void dump_params(std::ostream &os) const;
-    int64_t addr_offset; //!< offset where to jump if OR is not satisfied
+    int32_t addr_offset; //!< offset where to jump if OR is not satisfied
 };
 
 struct Func_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::FUNC;
-    Func_t(std::string name, uint32_t nargs, const Pos_t &pos, bool is_udf)
-        : Instruction_t(instr_opcode, pos),
-          name(std::move(name)), nargs(nargs), is_udf(is_udf)
-    {}
+    Func_t(ConstantPool_t &pool, std::string name, uint32_t nargs, bool is_udf)
+        : Instruction_t(instr_opcode),
+          is_udf(is_udf), nargs(nargs), name(pool.string(std::move(name)))
+    {bind();}
     void dump_params(std::ostream &os) const;
-    std::string name;    //!< the function name
-    std::uint32_t nargs; //!< the number of function arguments
-    bool is_udf;         //!< true if function is user defined
+    void bind();
+    bool is_udf;             //!< true if function is user defined
+    std::uint32_t nargs;     //!< the number of function arguments
+    const std::string *name; //!< the function name
+    union {
+        Function_t builtin;             //!< the builtin function or null
+        const udf::Slot_t *udf;         //!< the registered udf or null
+    };
 };
 
 struct JmpIfNot_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::JMP_IF_NOT;
-    JmpIfNot_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
+    JmpIfNot_t()
+        : Instruction_t(instr_opcode),
           addr_offset(-1)
     {}
     void dump_params(std::ostream &os) const;
-    int64_t addr_offset; //!< offset where to jump if NOT is satisfied
+    int32_t addr_offset; //!< offset where to jump if NOT is satisfied
 };
 
 struct Jmp_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::JMP;
-    Jmp_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
+    Jmp_t()
+        : Instruction_t(instr_opcode),
           addr_offset(-1)
     {}
-    Jmp_t(int64_t addr_offset, const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
-          addr_offset(addr_offset)
+    Jmp_t(int64_t addr_offset)
+        : Instruction_t(instr_opcode),
+          addr_offset(jump_offset(addr_offset))
     {}
     void dump_params(std::ostream &os) const;
-    int64_t addr_offset; //!< offset where to jump
+    int32_t addr_offset; //!< offset where to jump
 };
 
 struct OpenFormat_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::OPEN_FORMAT;
-    OpenFormat_t(int64_t mode, const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
+    OpenFormat_t(int64_t mode)
+        : Instruction_t(instr_opcode),
           mode(mode)
     {}
     void dump_params(std::ostream &os) const;
@@ -855,40 +900,39 @@ struct OpenFormat_t: public Instruction_t {
 
 struct OpenFrag_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::OPEN_FRAG;
-    OpenFrag_t(std::string name, const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
-          name(std::move(name)), close_frag_offset(-1)
+    OpenFrag_t(ConstantPool_t &pool, std::string name)
+        : OpenFrag_t(pool, instr_opcode, std::move(name))
     {}
-    OpenFrag_t(OPCODE opcode, std::string name, const Pos_t &pos)
-        : Instruction_t(opcode, pos),
-          name(std::move(name)), close_frag_offset(-1)
+    OpenFrag_t(ConstantPool_t &pool, OPCODE opcode, std::string name)
+        : Instruction_t(opcode),
+          close_frag_offset(-1), name(pool.string(std::move(name)))
     {}
     void dump_params(std::ostream &os) const;
-    std::string name;          //!< the fragment name
-    int64_t close_frag_offset; //!< offset where to jump if frament is missing
+    int32_t close_frag_offset; //!< offset where to jump if frament is missing
+    const std::string *name;   //!< the fragment name
 };
 
 struct OpenErrorFrag_t: public OpenFrag_t {
     static constexpr auto instr_opcode = OPCODE::OPEN_ERROR_FRAG;
-    OpenErrorFrag_t(const Pos_t &pos)
-        : OpenFrag_t(instr_opcode, "_error", pos)
+    OpenErrorFrag_t(ConstantPool_t &pool)
+        : OpenFrag_t(pool, instr_opcode, "_error")
     {}
 };
 
 struct CloseFrag_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::CLOSE_FRAG;
-    CloseFrag_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
+    CloseFrag_t()
+        : Instruction_t(instr_opcode),
           open_frag_offset(-1)
     {}
     void dump_params(std::ostream &os) const;
-    int64_t open_frag_offset; //!< offset where to jump to repeat fragment
+    int32_t open_frag_offset; //!< offset where to jump to repeat fragment
 };
 
 struct Print_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::PRINT;
-    Print_t(bool print_escape, const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
+    Print_t(bool print_escape)
+        : Instruction_t(instr_opcode),
           print_escape(print_escape), unoptimizable(false)
     {}
     void dump_params(std::ostream &os) const;
@@ -896,25 +940,51 @@ struct Print_t: public Instruction_t {
     bool unoptimizable; //!< can't be optimized out
 };
 
+/** The superinstructions replace the first instruction of the sequence they
+ * fuse. The rest of the sequence is kept in the following slots, so the
+ * addresses, jumps and positions of the program remain valid and the
+ * handler reads the params of the fused instructions from there.
+ */
+struct PrintVar_t: public Var_t {
+    static constexpr auto instr_opcode = OPCODE::PRINT_VAR;
+    PrintVar_t(const Var_t &var)
+        : Var_t(instr_opcode, var)
+    {}
+};
+
+struct PrintVal_t: public Val_t {
+    static constexpr auto instr_opcode = OPCODE::PRINT_VAL;
+    PrintVal_t(const Val_t &val)
+        : Val_t(instr_opcode, val)
+    {}
+};
+
+struct JmpIfVarNot_t: public Var_t {
+    static constexpr auto instr_opcode = OPCODE::JMP_IF_VAR_NOT;
+    JmpIfVarNot_t(const Var_t &var)
+        : Var_t(instr_opcode, var)
+    {}
+};
+
 struct Set_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::SET;
     template <typename Variable_t>
-    Set_t(const Variable_t &var)
-        : Instruction_t(instr_opcode, var.pos),
-          name(var.ident.name().str()),
+    Set_t(ConstantPool_t &pool, const Variable_t &var)
+        : Instruction_t(instr_opcode),
           frame_offset(static_cast<uint16_t>(var.offset.frame)),
-          frag_offset(static_cast<uint16_t>(var.offset.frag))
+          frag_offset(static_cast<uint16_t>(var.offset.frag)),
+          name(pool.string(var.ident.name().str()))
     {}
     void dump_params(std::ostream &os) const;
-    std::string name;      //!< the variable identifier
-    uint16_t frame_offset; //!< the offset of frame (NOT fragment!)
-    uint16_t frag_offset;  //!< the offset of fragment in frame
+    uint16_t frame_offset;   //!< the offset of frame (NOT fragment!)
+    uint16_t frag_offset;    //!< the offset of fragment in frame
+    const std::string *name; //!< the variable identifier
 };
 
 struct OpenCType_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::OPEN_CTYPE;
-    OpenCType_t(const ContentType_t::Descriptor_t *ctype, const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
+    OpenCType_t(const ContentType_t::Descriptor_t *ctype)
+        : Instruction_t(instr_opcode),
           ctype(ctype)
     {}
     void dump_params(std::ostream &os) const;
@@ -923,28 +993,29 @@ struct OpenCType_t: public Instruction_t {
 
 struct PushAttr_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::PUSH_ATTR;
-    PushAttr_t(std::string name, std::string path, const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
-          name(std::move(name)), path(std::move(path))
+    PushAttr_t(ConstantPool_t &pool, std::string name, std::string path)
+        : Instruction_t(instr_opcode),
+          name(pool.string(std::move(name))),
+          path(pool.string(std::move(path)))
     {}
     void dump_params(std::ostream &os) const;
-    std::string name; //!< the attribute name
-    std::string path; //!< path from rtvar start to this attribute
+    const std::string *name; //!< the attribute name
+    const std::string *path; //!< path from rtvar start to this attribute
 };
 
 struct PushAttrAt_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::PUSH_ATTR_AT;
-    PushAttrAt_t(std::string path, const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
-          path(std::move(path))
+    PushAttrAt_t(ConstantPool_t &pool, std::string path)
+        : Instruction_t(instr_opcode),
+          path(pool.string(std::move(path)))
     {}
     void dump_params(std::ostream &os) const;
-    std::string path; //!< path from rtvar start to this attribute
+    const std::string *path; //!< path from rtvar start to this attribute
 };
 
 struct MatchRegex_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::MATCH_REGEX;
-    MatchRegex_t(counted_ptr<Regex_t> regex, const Pos_t &pos);
+    MatchRegex_t(counted_ptr<Regex_t> regex);
     MatchRegex_t(MatchRegex_t &&) noexcept = default;
     MatchRegex_t &operator=(MatchRegex_t &&) noexcept = default;
     ~MatchRegex_t() noexcept;
@@ -955,8 +1026,8 @@ struct MatchRegex_t: public Instruction_t {
 
 struct PushErrorFrag_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::PUSH_ERROR_FRAG;
-    PushErrorFrag_t(bool discard_stack_value, const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
+    PushErrorFrag_t(bool discard_stack_value)
+        : Instruction_t(instr_opcode),
           discard_stack_value(discard_stack_value)
     {}
     void dump_params(std::ostream &os) const;
@@ -965,20 +1036,20 @@ struct PushErrorFrag_t: public Instruction_t {
 
 struct Return_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::RETURN;
-    Return_t(const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos)
+    Return_t()
+        : Instruction_t(instr_opcode)
     {}
 };
 
 struct Call_t: public Instruction_t {
     static constexpr auto instr_opcode = OPCODE::CALL;
-    Call_t(std::string name, int64_t addr, const Pos_t &pos)
-        : Instruction_t(instr_opcode, pos),
-          name(std::move(name)), addr(addr)
+    Call_t(ConstantPool_t &pool, std::string name, int64_t addr)
+        : Instruction_t(instr_opcode),
+          addr(jump_offset(addr)), name(pool.string(std::move(name)))
     {}
     void dump_params(std::ostream &os) const;
-    std::string name; //!< just debug info
-    int64_t addr;     //!< where the subroutine starts
+    int32_t addr;            //!< where the subroutine starts
+    const std::string *name; //!< just debug info
 };
 
 /** The reason of this struct is lack of explicit template parameters of c'tors
@@ -990,7 +1061,7 @@ struct InstrType_t {};
 /** The static polymorphic instruction box that is used to store instructions
  * in Teng program.
  */
-class InstrBox_t: public Instruction_t {
+class alignas(PushAttr_t) InstrBox_t: public Instruction_t {
 public:
     // don't copy
     InstrBox_t(InstrBox_t &) = delete;
@@ -1027,6 +1098,11 @@ public:
      */
     ~InstrBox_t() noexcept;
 
+    /** Creates the instruction of given opcode and reads its params from
+     * the bytecode written by Instruction_t::write_params().
+     */
+    static InstrBox_t read(OPCODE opcode, BytecodeReader_t &in);
+
 protected:
     static constexpr auto p_size = sizeof(PushAttr_t) - sizeof(Instruction_t);
     char padding[p_size]; //!< ensure enough space for the biggest instr
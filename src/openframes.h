@@ -80,6 +80,34 @@ inline Value_t get_attr(const Fragment_t *frag, const string_view_t &name) {
     return Value_t(&ivalue->second);
 }
 
+/** Returns attribute for desired name whose hash has been already computed.
+ */
+inline Value_t
+get_attr(const Fragment_t *frag, const string_view_t &name, uint32_t hash) {
+    if (!frag)
+        return Value_t();
+    auto ivalue = frag->find(name, hash);
+    if (ivalue == frag->end())
+        return Value_t();
+    return Value_t(&ivalue->second);
+}
+
+/** Returns attribute for the variable name. The instructions reading the
+ * variables carry the hash of name computed by the compiler.
+ */
+template <typename VarDesc_t>
+auto get_var_attr(const Fragment_t *frag, const VarDesc_t &var, int)
+-> decltype(static_cast<void>(var.name_hash), Value_t()) {
+    return get_attr(frag, *var.name, var.name_hash);
+}
+
+/** Fallback for VarDesc_t without name hash.
+ */
+template <typename VarDesc_t>
+Value_t get_var_attr(const Fragment_t *frag, const VarDesc_t &var, long) {
+    return get_attr(frag, *var.name);
+}
+
 /** Resolves the 'frag' value:
  *
  * tag::frag_ref - this is returned,
@@ -282,9 +310,9 @@ struct FrameRec_t {
      */
     template <typename VarDesc_t>
     auto append_frag_name(std::string &result, const VarDesc_t *var) const
-    -> decltype(static_cast<void>(var->name.data())) {
+    -> decltype(static_cast<void>(var->name->data())) {
         result.push_back('.');
-        result.append(var->name.data(), var->name.size());
+        result.append(*var->name);
     }
 
     /** Fallback for VarDesc_t without name.
@@ -325,11 +353,11 @@ struct FrameRec_t {
 
         // local variables overrides
         auto i = open_frags.size() - var.frag_offset - 1;
-        if (auto *local_var = find_local(i, var.name))
+        if (auto *local_var = find_local(i, *var.name))
             return *local_var;
 
         // regular variables
-        return get_attr(get_frag(open_frags[i].frag), var.name);
+        return get_var_attr(get_frag(open_frags[i].frag), var, 0);
     }
 
     /** Returns the value of the desired variable or an undefined value. The
@@ -346,11 +374,11 @@ struct FrameRec_t {
 
         // local variables overrides
         auto i = open_frags.size() - var_frag_offset - 1;
-        if (auto *local_var = find_local(i, var.name))
+        if (auto *local_var = find_local(i, *var.name))
             return *local_var;
 
         // regular variables
-        return get_attr(get_frag(open_frags[i].frag), var.name);
+        return get_var_attr(get_frag(open_frags[i].frag), var, 0);
     }
 
     /** Get offset of variable identified by path in given list of open frames
@@ -380,14 +408,14 @@ struct FrameRec_t {
 
         // local values can't override fragment values
         auto i = open_frags.size() - var.frag_offset - 1;
-        if (get_attr(get_frag(open_frags[i].frag), var.name))
+        if (get_attr(get_frag(open_frags[i].frag), *var.name))
             return false;
 
         // insert value
         auto &locals = open_frags[i].locals;
-        auto ilocal_var = locals.find(var.name);
+        auto ilocal_var = locals.find(*var.name);
         if (ilocal_var == locals.end())
-            locals.emplace(var.name, std::move(value));
+            locals.emplace(*var.name, std::move(value));
         else ilocal_var->second = std::move(value);
         return true;
     }
@@ -433,6 +461,14 @@ struct FrameRec_t {
         return result;
     }
 
+    /** Calls fn with the name of each open fragment except the root one.
+     */
+    template <typename fn_t>
+    void for_each_open_frag(fn_t &&fn) const {
+        for (auto i = 1u; i < open_frags.size(); ++i)
+            fn(open_frags[i].name);
+    }
+
     /** Returns current fragment index in parent list.
      */
     std::size_t current_list_i() const {
@@ -513,8 +549,8 @@ public:
      * not contain offsets.
      */
     struct VarDesc_t {
-        VarDesc_t(const string_view_t &name): name(name) {}
-        string_view_t name;
+        VarDesc_t(const std::string *name): name(name) {}
+        const std::string *name;
         uint32_t frame_offset = 0;
         uint32_t frag_offset = 0;
     };
@@ -689,6 +725,14 @@ public:
         return frames.back().current_path();
     }
 
+    /** Calls fn with the name of each open fragment of all frames from the
+     * first one.
+     */
+    template <typename fn_t>
+    void for_each_open_frag(fn_t &&fn) const {
+        for (auto &frame: frames) frame.for_each_open_frag(fn);
+    }
+
     /** Returns current fragment index in parent list.
      */
     std::size_t current_list_i() const override {
@@ -46,6 +46,8 @@
 
 #include "lex1.h"
 #include "program.h"
+#include "peephole.h"
+#include "stackdepth.h"
 #include "platform.h"
 #include "logging.h"
 #include "syntax.hh"
@@ -92,6 +94,22 @@ void make_last_print_unoptimalizable(Parser::Context_t *ctx) {
     ctx->program->back().as<Print_t>().unoptimizable = true;
 }
 
+/** Computes the maximal depth of the value stack of compiled program. The
+ * malformed program is discarded because it could overrun the stack.
+ */
+void measure_stack_depth(Parser::Context_t *ctx) {
+    try {
+        ctx->program->setMaxStackDepth(max_stack_depth(*ctx->program));
+    } catch (const bad_stack_depth_t &e) {
+        ctx->program->clear();
+        logFatal(
+            ctx,
+            {/*the program is gone, no position is meaningful*/},
+            std::string(e.what()) + "; discarding whole program"
+        );
+    }
+}
+
 /** Resets level 2 lexer.
  */
 void finish_level_2_scanning(Parser::Context_t *ctx) {
@@ -125,6 +143,9 @@ compile_file(
     Parser::Context_t ctx(err, dict, params, filesystem, encoding, contentType);
     ctx.load_file(filename, Pos_t(/*base level, no include reference*/));
     compile(&ctx);
+    fuse_instructions(*ctx.program);
+    measure_stack_depth(&ctx);
+    ctx.program->shrink_to_fit();
     return std::move(ctx.program);
 }
 
@@ -141,6 +162,9 @@ compile_string(
     Parser::Context_t ctx(err, dict, params, filesystem, encoding, contentType);
     ctx.load_source(source);
     compile(&ctx);
+    fuse_instructions(*ctx.program);
+    measure_stack_depth(&ctx);
+    ctx.program->shrink_to_fit();
     return std::move(ctx.program);
 }
 
@@ -160,8 +184,9 @@ Context_t::Context_t(
    coproc_err(), coproc(coproc_err, *program, *dict, *params),
    open_frames(*program), var_sym(), opts_sym(),
    error_occurred(false), unexpected_token{LEX2::INV, {}, {}},
-   expr_start_point{{}, -1, true}, if_start_points(),
-   branch_addrs(), case_option_addrs(), optimization_points(),
+   expr_start_point{{}, -1, true}, if_start_points(), if_branches(),
+   hoisted_exprs(), branch_addrs(), case_option_addrs(),
+   case_subject_addrs(), optimization_points(),
    escaper(ContentType_t::find(contentType))
 {}
 
@@ -177,7 +202,10 @@ void Context_t::load_file(const string_view_t &path, const Pos_t &incl_pos) {
         source_codes.push_back(flex_string_value_t(filesystem->read(filename)));
         auto &source_code = source_codes.back();
 
+        auto sources_count = program->getSources().size();
         auto *source_path = program->addSource(filesystem, filename).first;
+        if (incl_pos && (program->getSources().size() > sources_count))
+            program->addInclude(source_path, incl_pos);
 
         // create the level 1 lexer for given source code
         lex1_stack.emplace(source_code, utf8, params, source_path);
@@ -42,11 +42,13 @@
 
 #include <stack>
 #include <string>
+#include <vector>
 #include <memory>
 
 #include "lex1.h"
 #include "lex2.h"
 #include "yystype.h"
+#include "program.h"
 #include "processor.h"
 #include "parserfrag.h"
 #include "parserdiag.h"
@@ -188,7 +190,31 @@ struct Context_t {
      * remember where expression begins.
      */
     struct expr_start_t {Pos_t pos; int64_t addr; bool update_allowed;};
-    using expr_starts_t = std::stack<expr_start_t>;
+
+    /** Stack of expression begins.
+     */
+    struct expr_starts_t: public std::stack<expr_start_t> {
+        const expr_start_t &below_top(std::size_t i) const {
+            return c[c.size() - i - 1];
+        }
+    };
+
+    /** The branch of if statement: the address where its condition starts
+     * (-1 for else branch) and the address where its body starts. It's used
+     * to remove the branches whose conditions are constant.
+     */
+    struct if_branch_t {int64_t cond_addr; int64_t body_addr;};
+    using if_branches_t = std::stack<std::vector<if_branch_t>>;
+
+    /** The expressions hoisted out of the body of the open frag whose
+     * OPEN_FRAG instruction is at frag_addr. The value of i-th expression is
+     * kept i-th from the top of program stack during the frag iterations.
+     */
+    struct hoisted_exprs_t {
+        int64_t frag_addr;                    //!< the OPEN_FRAG address
+        std::vector<Program_t::Code_t> exprs; //!< the code of expressions
+    };
+    using hoisted_frags_t = std::vector<hoisted_exprs_t>;
 
     /** The pair of instruction address and optimizable flag. It's used to note
      * where begins subprogram representing the expression that should be
@@ -244,10 +270,13 @@ struct Context_t {
     Token_t unexpected_token;            //!< the last unexpected token
     expr_start_t expr_start_point;       //!< address and pos where exprs starts
     expr_starts_t if_start_points;       //!< addresses where if stmnts start
+    if_branches_t if_branches;           //!< branches of open if stmnts
+    hoisted_frags_t hoisted_exprs;       //!< exprs hoisted out of open frags
     rtvar_strings_t rtvar_strings;       //!< positions where rtvar starts
     addrs_stack_t rtvar_idx_start_point; //!< stack of stacks of a[] expressions
     addrs_stack_t branch_addrs;          //!< addresses of unfinished jumps
     addrs_stack_t case_option_addrs;     //!< the list of addrs of case options
+    std::stack<int64_t> case_subject_addrs; //!< addrs of const case subjects
     optim_points_t optimization_points;  //!< adresses of "value generators"
     ExprDiag_t expr_diag;                //!< list of expr diagnostic codes
     Escaper_t escaper;                   //!< open content types / escaper
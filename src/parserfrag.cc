@@ -54,7 +54,7 @@ OpenFrames_t::~OpenFrames_t() {
             auto frag = top().close_frag();
             logWarning(
                 program.getErrors(),
-                program[frag.addr].pos(),
+                program.pos(frag.addr),
                 "Unclosed <?teng frag " + frag.name() + "?> directive"
             );
         }
@@ -0,0 +1,175 @@
+/*
+ * Teng -- a general purpose templating engine.
+ * Copyright (C) 2004  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Naskove 1, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:teng@firma.seznam.cz
+ *
+ *
+ * $Id: $
+ *
+ * DESCRIPTION
+ * Teng peephole optimizer -- fuses instruction sequences.
+ *
+ * AUTHORS
+ * Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * HISTORY
+ * 2026-10-16  (burlog)
+ *             Created.
+ */
+
+#include "program.h"
+#include "peephole.h"
+
+namespace Teng {
+namespace {
+
+/** The fused sequence: the opcodes of the sequence and the function that
+ * replaces the first instruction of the sequence with the superinstruction.
+ */
+struct Fusion_t {
+    OPCODE first;                           //!< the opcode of first instr
+    OPCODE second;                          //!< the opcode of second instr
+    InstrBox_t (*fuse)(const InstrBox_t &); //!< creates the superinstr
+};
+
+/** The sequences fused into the superinstructions.
+ */
+const Fusion_t fusions[] = {
+    {OPCODE::VAR, OPCODE::PRINT, [] (const InstrBox_t &instr) {
+        return InstrBox_t(InstrType_t<PrintVar_t>(), instr.as<Var_t>());
+    }},
+    {OPCODE::VAL, OPCODE::PRINT, [] (const InstrBox_t &instr) {
+        return InstrBox_t(InstrType_t<PrintVal_t>(), instr.as<Val_t>());
+    }},
+    {OPCODE::VAR, OPCODE::JMP_IF_NOT, [] (const InstrBox_t &instr) {
+        return InstrBox_t(InstrType_t<JmpIfVarNot_t>(), instr.as<Var_t>());
+    }},
+};
+
+/** Returns the opcode of the instruction the superinstruction has been
+ * created from.
+ */
+OPCODE compiled_opcode(OPCODE opcode) {
+    switch (opcode) {
+    case OPCODE::PRINT_VAR: return OPCODE::VAR;
+    case OPCODE::PRINT_VAL: return OPCODE::VAL;
+    case OPCODE::JMP_IF_VAR_NOT: return OPCODE::VAR;
+    default: return opcode;
+    }
+}
+
+/** Returns true if no jump points into the sequence [start, start + length)
+ * (the first instruction can be jumped onto).
+ */
+bool
+is_fusible(const std::vector<bool> &targets, std::size_t start, std::size_t length) {
+    for (auto i = start + 1; i < start + length; ++i)
+        if (targets[i]) return false;
+    return true;
+}
+
+} // namespace
+
+std::vector<bool> jump_targets(const Program_t &program) {
+    std::vector<bool> targets(program.size() + 1, false);
+    auto mark = [&] (int64_t addr) {
+        // the processor increments the ip after each jump
+        if ((addr + 1 >= 0) && (uint64_t(addr + 1) < targets.size()))
+            targets[addr + 1] = true;
+    };
+    for (int64_t i = 0; i < int64_t(program.size()); ++i) {
+        auto &instr = program[i];
+        switch (instr.opcode()) {
+        case OPCODE::AND:
+            mark(i + instr.as<And_t>().addr_offset);
+            break;
+        case OPCODE::OR:
+            mark(i + instr.as<Or_t>().addr_offset);
+            break;
+        case OPCODE::JMP_IF_NOT:
+            mark(i + instr.as<JmpIfNot_t>().addr_offset);
+            break;
+        case OPCODE::JMP:
+            mark(i + instr.as<Jmp_t>().addr_offset);
+            break;
+        case OPCODE::OPEN_FRAG:
+            mark(i + instr.as<OpenFrag_t>().close_frag_offset);
+            break;
+        case OPCODE::OPEN_ERROR_FRAG:
+            mark(i + instr.as<OpenErrorFrag_t>().close_frag_offset);
+            break;
+        case OPCODE::CLOSE_FRAG:
+            mark(i + instr.as<CloseFrag_t>().open_frag_offset);
+            break;
+        case OPCODE::CALL:
+            // the subroutine and the return from it
+            mark(instr.as<Call_t>().addr);
+            mark(i);
+            break;
+        default:
+            break;
+        }
+    }
+    return targets;
+}
+
+std::size_t fuse_instructions(Program_t &program) {
+    std::size_t fused = 0;
+    auto targets = jump_targets(program);
+    for (std::size_t i = 0; i + 1 < program.size(); ++i) {
+        if (!is_fusible(targets, i, 2)) continue;
+        for (auto &fusion: fusions) {
+            if (program[i].opcode() != fusion.first) continue;
+            if (program[i + 1].opcode() != fusion.second) continue;
+            program[i] = fusion.fuse(program[i]);
+            ++fused;
+            ++i;
+            break;
+        }
+    }
+    return fused;
+}
+
+void count_sequences(
+    const Program_t &program,
+    std::size_t length,
+    SequenceCounts_t &counts
+) {
+    if (!length) return;
+    auto targets = jump_targets(program);
+    OpcodeSequence_t sequence(length);
+    for (std::size_t i = 0; i + length <= program.size(); ++i) {
+        if (!is_fusible(targets, i, length)) continue;
+        for (std::size_t j = 0; j < length; ++j)
+            sequence[j] = compiled_opcode(program[i + j].opcode());
+        ++counts[sequence];
+    }
+}
+
+bool is_fused_sequence(const OpcodeSequence_t &sequence) {
+    if (sequence.size() != 2) return false;
+    for (auto &fusion: fusions)
+        if ((sequence[0] == fusion.first) && (sequence[1] == fusion.second))
+            return true;
+    return false;
+}
+
+} // namespace Teng
+
@@ -0,0 +1,100 @@
+/*
+ * Teng -- a general purpose templating engine.
+ * Copyright (C) 2004  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Naskove 1, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:teng@firma.seznam.cz
+ *
+ *
+ * $Id: $
+ *
+ * DESCRIPTION
+ * Teng peephole optimizer -- fuses instruction sequences.
+ *
+ * AUTHORS
+ * Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * HISTORY
+ * 2026-10-16  (burlog)
+ *             Created.
+ */
+
+#ifndef TENGPEEPHOLE_H
+#define TENGPEEPHOLE_H
+
+#include <map>
+#include <vector>
+#include <cstdint>
+
+#include "instruction.h"
+
+namespace Teng {
+
+// forwards
+class Program_t;
+
+/** The sequence of opcodes.
+ */
+using OpcodeSequence_t = std::vector<OPCODE>;
+
+/** The number of occurrences of each opcode sequence.
+ */
+using SequenceCounts_t = std::map<OpcodeSequence_t, uint64_t>;
+
+/** Returns the flags of instructions which are targets of some jump, call
+ * or subroutine return. The result has one more item than the program, so
+ * the jump behind the last instruction is also valid.
+ */
+std::vector<bool> jump_targets(const Program_t &program);
+
+/** Replaces the frequent instruction sequences with the superinstructions
+ * (e.g. VAR followed by PRINT with PRINT_VAR), so the processor dispatches
+ * once per sequence and the value doesn't go through the value stack.
+ *
+ * The superinstruction replaces only the first instruction of the sequence
+ * and the rest of the sequence is kept, so the addresses and positions of
+ * all instructions remain valid. The sequences into which some jump points
+ * are never fused.
+ *
+ * @param program the compiled program
+ * @return the number of fused sequences
+ */
+std::size_t fuse_instructions(Program_t &program);
+
+/** Counts the sequences of given length that could be fused into the
+ * superinstruction (no jump points inside the sequence). The already fused
+ * sequences are counted as they were compiled.
+ *
+ * @param program the compiled program
+ * @param length the length of the counted sequences
+ * @param counts where the sequences are counted
+ */
+void count_sequences(
+    const Program_t &program,
+    std::size_t length,
+    SequenceCounts_t &counts
+);
+
+/** Returns true if the sequence is fused into some superinstruction.
+ */
+bool is_fused_sequence(const OpcodeSequence_t &sequence);
+
+} // namespace Teng
+
+#endif /* TENGPEEPHOLE_H */
+
@@ -44,6 +44,9 @@
 
 #include <sys/types.h>
 #include <unistd.h>
+#include <array>
+#include <utility>
+#include <stdexcept>
 
 #include "instructionpointer.h"
 #include "processorcontext.h"
@@ -51,6 +54,8 @@
 #include "processordebug.h"
 #include "processorfrag.h"
 #include "processorops.h"
+#include "processorprofile.h"
+#include "stackdepth.h"
 #include "processor.h"
 
 #ifdef DEBUG
@@ -59,6 +64,11 @@
 #define DBG(...)
 #endif /* DEBUG */
 
+// computed goto is the GNU extension
+#if defined(__GNUC__) && !defined(TENG_NO_COMPUTED_GOTO)
+#define TENG_COMPUTED_GOTO
+#endif /* __GNUC__ && !TENG_NO_COMPUTED_GOTO */
+
 namespace Teng {
 namespace {
 
@@ -89,7 +99,7 @@ void dump_instr(
     Ctx_t *,
     const SubProgram_t &program,
     InstructionPointer_t &ip,
-    const std::vector<Value_t> &stack,
+    const ValueStack_t &stack,
     const std::vector<Value_t> &prg_stack,
     std::ostream &out
 ) {
@@ -115,11 +125,69 @@ void dump_instr(
     out << os.str() << std::endl;
 }
 
+#ifdef TENG_COMPUTED_GOTO
+
+/** The number of opcodes.
+ */
+constexpr std::size_t opcode_count = static_cast<std::size_t>(OPCODE::CALL) + 1;
+
+/** The addresses of instruction handlers indexed by opcode.
+ */
+using Labels_t = std::array<void *, opcode_count>;
+
+/** Converts the list of (opcode, handler) pairs to the table indexed by
+ * opcode.
+ */
+template <std::size_t size>
+Labels_t index_labels(const std::pair<OPCODE, void *> (&targets)[size]) {
+    static_assert(size == opcode_count, "each opcode needs its handler");
+    Labels_t labels{};
+    for (auto &target: targets)
+        labels[static_cast<std::size_t>(target.first)] = target.second;
+    for (auto *label: labels)
+        if (!label) throw std::logic_error("opcode without handler");
+    return labels;
+}
+
+// each instruction handler has its own label, so the threaded dispatch can
+// jump right to the handler of the next instruction instead of going back
+// to the switch
+#define TARGET(name) case OPCODE::name: op_##name
+#define DISPATCH()                                                          \
+    if constexpr (dispatch == Processor_t::Dispatch_t::THREADED) {          \
+        if (*ip + 1 < program.end) {                                        \
+            ctx->instr = &program[++ip];                                    \
+            DBG(dump_instr(ctx, program, ip, stack, prg_stack, std::cerr)); \
+            goto *labels[static_cast<std::size_t>(ctx->instr->opcode())];   \
+        }                                                                   \
+    }                                                                       \
+    break
+
+#else /* TENG_COMPUTED_GOTO */
+
+#define TARGET(name) case OPCODE::name
+#define DISPATCH() break
+
+#endif /* TENG_COMPUTED_GOTO */
+
 /** The core of Teng template engine. Renders the template.
+ *
+ * The switch dispatch returns back to the loop after each instruction. The
+ * threaded dispatch jumps from the end of each handler right to the handler
+ * of the next instruction, so each handler has its own indirect branch that
+ * the CPU predicts independently.
  */
-template <typename Ctx_t>
-bool
-process(Ctx_t *ctx, std::vector<Value_t> &stack, const SubProgram_t &program) {
+template <
+    Processor_t::Dispatch_t dispatch,
+    typename Ctx_t,
+    typename Profiler_t = NoProfiler_t
+> bool
+process(
+    Ctx_t *ctx,
+    ValueStack_t &stack,
+    const SubProgram_t &program,
+    Profiler_t &&profiler = Profiler_t()
+) {
     std::vector<FragmentList_t> error_list;
     std::vector<Value_t> prg_stack;
     prg_stack.reserve(128);
@@ -127,356 +195,475 @@ process(Ctx_t *ctx, std::vector<Value_t> &stack, const SubProgram_t &program) {
 
     // syntactic sugar
     auto push = [&] (auto &&value) {
-        stack.push_back(std::forward<decltype(value)>(value));
+        stack.push(std::forward<decltype(value)>(value));
     };
-    auto top = [&] () -> Value_t &{
-        if (stack.empty())
-            throw std::runtime_error("program stack underflow");
-        return stack.back();
+    auto top = [&] () -> Value_t &{return stack.back();};
+
+#ifdef TENG_COMPUTED_GOTO
+    // the labels are taken in both dispatch modes to keep them used
+    static const std::pair<OPCODE, void *> targets[] = {
+        {OPCODE::NOOP, &&op_NOOP},
+        {OPCODE::DEBUG_FRAG, &&op_DEBUG_FRAG},
+        {OPCODE::BYTECODE_FRAG, &&op_BYTECODE_FRAG},
+        {OPCODE::PRINT, &&op_PRINT},
+        {OPCODE::SET, &&op_SET},
+        {OPCODE::VAL, &&op_VAL},
+        {OPCODE::DICT, &&op_DICT},
+        {OPCODE::VAR, &&op_VAR},
+        {OPCODE::PRG_STACK_PUSH, &&op_PRG_STACK_PUSH},
+        {OPCODE::PRG_STACK_POP, &&op_PRG_STACK_POP},
+        {OPCODE::PRG_STACK_AT, &&op_PRG_STACK_AT},
+        {OPCODE::BIT_OR, &&op_BIT_OR},
+        {OPCODE::BIT_XOR, &&op_BIT_XOR},
+        {OPCODE::BIT_AND, &&op_BIT_AND},
+        {OPCODE::UNARY_PLUS, &&op_UNARY_PLUS},
+        {OPCODE::UNARY_MINUS, &&op_UNARY_MINUS},
+        {OPCODE::PLUS, &&op_PLUS},
+        {OPCODE::MINUS, &&op_MINUS},
+        {OPCODE::MUL, &&op_MUL},
+        {OPCODE::DIV, &&op_DIV},
+        {OPCODE::MOD, &&op_MOD},
+        {OPCODE::EQ, &&op_EQ},
+        {OPCODE::NE, &&op_NE},
+        {OPCODE::GE, &&op_GE},
+        {OPCODE::GT, &&op_GT},
+        {OPCODE::LE, &&op_LE},
+        {OPCODE::LT, &&op_LT},
+        {OPCODE::CONCAT, &&op_CONCAT},
+        {OPCODE::STR_EQ, &&op_STR_EQ},
+        {OPCODE::STR_NE, &&op_STR_NE},
+        {OPCODE::REPEAT, &&op_REPEAT},
+        {OPCODE::NOT, &&op_NOT},
+        {OPCODE::BIT_NOT, &&op_BIT_NOT},
+        {OPCODE::MATCH_REGEX, &&op_MATCH_REGEX},
+        {OPCODE::FUNC, &&op_FUNC},
+        {OPCODE::AND, &&op_AND},
+        {OPCODE::OR, &&op_OR},
+        {OPCODE::JMP_IF_NOT, &&op_JMP_IF_NOT},
+        {OPCODE::JMP, &&op_JMP},
+        {OPCODE::OPEN_FORMAT, &&op_OPEN_FORMAT},
+        {OPCODE::CLOSE_FORMAT, &&op_CLOSE_FORMAT},
+        {OPCODE::OPEN_FRAG, &&op_OPEN_FRAG},
+        {OPCODE::OPEN_ERROR_FRAG, &&op_OPEN_ERROR_FRAG},
+        {OPCODE::CLOSE_FRAG, &&op_CLOSE_FRAG},
+        {OPCODE::OPEN_FRAME, &&op_OPEN_FRAME},
+        {OPCODE::CLOSE_FRAME, &&op_CLOSE_FRAME},
+        {OPCODE::OPEN_CTYPE, &&op_OPEN_CTYPE},
+        {OPCODE::CLOSE_CTYPE, &&op_CLOSE_CTYPE},
+        {OPCODE::PUSH_FRAG_COUNT, &&op_PUSH_FRAG_COUNT},
+        {OPCODE::PUSH_FRAG_INDEX, &&op_PUSH_FRAG_INDEX},
+        {OPCODE::PUSH_FRAG_FIRST, &&op_PUSH_FRAG_FIRST},
+        {OPCODE::PUSH_FRAG_LAST, &&op_PUSH_FRAG_LAST},
+        {OPCODE::PUSH_FRAG_INNER, &&op_PUSH_FRAG_INNER},
+        {OPCODE::PUSH_VAL_COUNT, &&op_PUSH_VAL_COUNT},
+        {OPCODE::PUSH_VAL_INDEX, &&op_PUSH_VAL_INDEX},
+        {OPCODE::PUSH_VAL_FIRST, &&op_PUSH_VAL_FIRST},
+        {OPCODE::PUSH_VAL_LAST, &&op_PUSH_VAL_LAST},
+        {OPCODE::PUSH_VAL_INNER, &&op_PUSH_VAL_INNER},
+        {OPCODE::PUSH_FRAG, &&op_PUSH_FRAG},
+        {OPCODE::PUSH_ROOT_FRAG, &&op_PUSH_ROOT_FRAG},
+        {OPCODE::PUSH_THIS_FRAG, &&op_PUSH_THIS_FRAG},
+        {OPCODE::PUSH_ERROR_FRAG, &&op_PUSH_ERROR_FRAG},
+        {OPCODE::PUSH_ATTR_AT, &&op_PUSH_ATTR_AT},
+        {OPCODE::POP_ATTR, &&op_POP_ATTR},
+        {OPCODE::PUSH_ATTR, &&op_PUSH_ATTR},
+        {OPCODE::REPR, &&op_REPR},
+        {OPCODE::QUERY_REPR, &&op_QUERY_REPR},
+        {OPCODE::QUERY_COUNT, &&op_QUERY_COUNT},
+        {OPCODE::QUERY_TYPE, &&op_QUERY_TYPE},
+        {OPCODE::QUERY_DEFINED, &&op_QUERY_DEFINED},
+        {OPCODE::QUERY_EXISTS, &&op_QUERY_EXISTS},
+        {OPCODE::ISEMPTY, &&op_ISEMPTY},
+        {OPCODE::ISUNDEFINED, &&op_ISUNDEFINED},
+        {OPCODE::ISINTEGRAL, &&op_ISINTEGRAL},
+        {OPCODE::ISREAL, &&op_ISREAL},
+        {OPCODE::ISSTRING, &&op_ISSTRING},
+        {OPCODE::ISFRAG, &&op_ISFRAG},
+        {OPCODE::ISFRAGLIST, &&op_ISFRAGLIST},
+        {OPCODE::ISREGEX, &&op_ISREGEX},
+        {OPCODE::LOG_SUPPRESS, &&op_LOG_SUPPRESS},
+        {OPCODE::PRINT_VAR, &&op_PRINT_VAR},
+        {OPCODE::PRINT_VAL, &&op_PRINT_VAL},
+        {OPCODE::JMP_IF_VAR_NOT, &&op_JMP_IF_VAR_NOT},
+        {OPCODE::RETURN, &&op_RETURN},
+        {OPCODE::CALL, &&op_CALL},
+        {OPCODE::HALT, &&op_HALT},
     };
+    static const Labels_t labels = index_labels(targets);
+#endif /* TENG_COMPUTED_GOTO */
 
     // exec program on stack-based processor
     GetArg_t get_arg(stack);
     for (InstructionPointer_t ip(program); ip < program.end; ++ip) try {
         ctx->instr = &program[*ip];
+        profiler.enter(*ip);
         DBG(dump_instr(ctx, program, ip, stack, prg_stack, std::cerr));
 
         switch (ctx->instr->opcode()) {
-        case OPCODE::NOOP:
-            break;
+        TARGET(NOOP):
+            DISPATCH();
 
-        case OPCODE::DEBUG_FRAG:
+        TARGET(DEBUG_FRAG):
             exec::debug_frag(ctx);
-            break;
+            DISPATCH();
 
-        case OPCODE::BYTECODE_FRAG:
+        TARGET(BYTECODE_FRAG):
             exec::bytecode_frag(ctx);
-            break;
+            DISPATCH();
 
-        case OPCODE::PRINT:
+        TARGET(PRINT):
             exec::print(ctx, get_arg);
-            break;
+            DISPATCH();
 
-        case OPCODE::SET:
+        TARGET(SET):
             exec::set_var(ctx, get_arg);
-            break;
+            DISPATCH();
 
-        case OPCODE::VAL:
+        TARGET(VAL):
             push(exec::val(ctx));
-            break;
+            DISPATCH();
 
-        case OPCODE::DICT:
+        TARGET(DICT):
             push(exec::dict(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::VAR:
+        TARGET(VAR):
             push(exec::var(ctx, program[ip + 1].opcode() == OPCODE::PRINT));
-            break;
+            DISPATCH();
 
-        case OPCODE::PRG_STACK_PUSH:
+        TARGET(PRG_STACK_PUSH):
             exec::prg_stack_push(prg_stack, get_arg);
-            break;
+            DISPATCH();
 
-        case OPCODE::PRG_STACK_POP:
+        TARGET(PRG_STACK_POP):
             exec::prg_stack_pop(prg_stack);
-            break;
+            DISPATCH();
 
-        case OPCODE::PRG_STACK_AT:
+        TARGET(PRG_STACK_AT):
             push(exec::prg_stack_at(ctx, prg_stack));
-            break;
+            DISPATCH();
 
-        case OPCODE::BIT_OR:
+        TARGET(BIT_OR):
             push(exec::numop(ctx, get_arg, std::bit_or<int64_t>()));
-            break;
+            DISPATCH();
 
-        case OPCODE::BIT_XOR:
+        TARGET(BIT_XOR):
             push(exec::numop(ctx, get_arg, std::bit_xor<int64_t>()));
-            break;
+            DISPATCH();
 
-        case OPCODE::BIT_AND:
+        TARGET(BIT_AND):
             push(exec::numop(ctx, get_arg, std::bit_and<int64_t>()));
-            break;
+            DISPATCH();
 
-        case OPCODE::UNARY_PLUS:
+        TARGET(UNARY_PLUS):
             push(exec::unary_plus(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::UNARY_MINUS:
+        TARGET(UNARY_MINUS):
             push(exec::unary_minus(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::PLUS:
+        TARGET(PLUS):
             push(exec::strnumop(ctx, get_arg, std::plus<>()));
-            break;
+            DISPATCH();
 
-        case OPCODE::MINUS:
+        TARGET(MINUS):
             push(exec::numop(ctx, get_arg, std::minus<>()));
-            break;
+            DISPATCH();
 
-        case OPCODE::MUL:
+        TARGET(MUL):
             push(exec::numop(ctx, get_arg, std::multiplies<>()));
-            break;
+            DISPATCH();
 
-        case OPCODE::DIV:
+        TARGET(DIV):
             push(exec::numop(ctx, get_arg, std::divides<>()));
-            break;
+            DISPATCH();
 
-        case OPCODE::MOD:
+        TARGET(MOD):
             push(exec::numop(ctx, get_arg, std::modulus<int64_t>()));
-            break;
+            DISPATCH();
 
-        case OPCODE::EQ:
+        TARGET(EQ):
             push(exec::strnumop(ctx, get_arg, std::equal_to<>()));
-            break;
+            DISPATCH();
 
-        case OPCODE::NE:
+        TARGET(NE):
             push(exec::strnumop(ctx, get_arg, std::not_equal_to<>()));
-            break;
+            DISPATCH();
 
-        case OPCODE::GE:
+        TARGET(GE):
             push(exec::strnumop(ctx, get_arg, std::greater_equal<>()));
-            break;
+            DISPATCH();
 
-        case OPCODE::GT:
+        TARGET(GT):
             push(exec::strnumop(ctx, get_arg, std::greater<>()));
-            break;
+            DISPATCH();
 
-        case OPCODE::LE:
+        TARGET(LE):
             push(exec::strnumop(ctx, get_arg, std::less_equal<>()));
-            break;
+            DISPATCH();
 
-        case OPCODE::LT:
+        TARGET(LT):
             push(exec::strnumop(ctx, get_arg, std::less<>()));
-            break;
+            DISPATCH();
 
-        case OPCODE::CONCAT:
+        TARGET(CONCAT):
             push(exec::strop(ctx, get_arg, std::plus<>()));
-            break;
+            DISPATCH();
 
-        case OPCODE::STR_EQ:
+        TARGET(STR_EQ):
             push(exec::strop(ctx, get_arg, std::equal_to<>()));
-            break;
+            DISPATCH();
 
-        case OPCODE::STR_NE:
+        TARGET(STR_NE):
             push(exec::strop(ctx, get_arg, std::not_equal_to<>()));
-            break;
+            DISPATCH();
 
-        case OPCODE::REPEAT:
+        TARGET(REPEAT):
             push(exec::repeat_string(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::NOT:
+        TARGET(NOT):
             push(exec::logic_not(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::BIT_NOT:
+        TARGET(BIT_NOT):
             push(exec::bit_not(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::MATCH_REGEX:
+        TARGET(MATCH_REGEX):
             push(exec::regex_match(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::FUNC:
+        TARGET(FUNC):
             push(exec::func(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::AND:
+        TARGET(AND):
             if (top()) stack.pop_back();
             else ip += ctx->instr->template as<And_t>().addr_offset;
-            break;
+            DISPATCH();
 
-        case OPCODE::OR:
+        TARGET(OR):
             if (!top()) stack.pop_back();
             else ip += ctx->instr->template as<Or_t>().addr_offset;
-            break;
+            DISPATCH();
 
-        case OPCODE::JMP_IF_NOT:
+        TARGET(JMP_IF_NOT):
             if (!get_arg())
                 ip += ctx->instr->template as<JmpIfNot_t>().addr_offset;
-            break;
+            DISPATCH();
 
-        case OPCODE::JMP:
+        TARGET(JMP):
             ip += ctx->instr->template as<Jmp_t>().addr_offset;
-            break;
+            DISPATCH();
 
-        case OPCODE::OPEN_FORMAT:
+        TARGET(OPEN_FORMAT):
             exec::push_formatter(ctx);
-            break;
+            DISPATCH();
 
-        case OPCODE::CLOSE_FORMAT:
+        TARGET(CLOSE_FORMAT):
             exec::pop_formatter(ctx);
-            break;
+            DISPATCH();
 
-        case OPCODE::OPEN_FRAG:
+        TARGET(OPEN_FRAG):
             if (auto shift = exec::open_frag(ctx))
                 ip += shift;
-            break;
+            DISPATCH();
 
-        case OPCODE::OPEN_ERROR_FRAG:
+        TARGET(OPEN_ERROR_FRAG):
             if (auto shift = exec::open_error_frag(ctx))
                 ip += shift;
-            break;
+            DISPATCH();
 
-        case OPCODE::CLOSE_FRAG:
+        TARGET(CLOSE_FRAG):
             if (auto shift = exec::close_frag(ctx))
                 ip += shift;
-            break;
+            DISPATCH();
 
-        case OPCODE::OPEN_FRAME:
+        TARGET(OPEN_FRAME):
             exec::open_frame(ctx);
-            break;
+            DISPATCH();
 
-        case OPCODE::CLOSE_FRAME:
+        TARGET(CLOSE_FRAME):
             exec::close_frame(ctx);
-            break;
+            DISPATCH();
 
-        case OPCODE::OPEN_CTYPE:
+        TARGET(OPEN_CTYPE):
             exec::push_escaper(ctx);
-            break;
+            DISPATCH();
 
-        case OPCODE::CLOSE_CTYPE:
+        TARGET(CLOSE_CTYPE):
             exec::pop_escaper(ctx);
-            break;
+            DISPATCH();
 
-        case OPCODE::PUSH_FRAG_COUNT:
+        TARGET(PUSH_FRAG_COUNT):
             push(exec::frag_count(ctx));
-            break;
+            DISPATCH();
 
-        case OPCODE::PUSH_FRAG_INDEX:
+        TARGET(PUSH_FRAG_INDEX):
             push(exec::frag_index(ctx));
-            break;
+            DISPATCH();
 
-        case OPCODE::PUSH_FRAG_FIRST:
+        TARGET(PUSH_FRAG_FIRST):
             push(exec::is_first_frag(ctx));
-            break;
+            DISPATCH();
 
-        case OPCODE::PUSH_FRAG_LAST:
+        TARGET(PUSH_FRAG_LAST):
             push(exec::is_last_frag(ctx));
-            break;
+            DISPATCH();
 
-        case OPCODE::PUSH_FRAG_INNER:
+        TARGET(PUSH_FRAG_INNER):
             push(exec::is_inner_frag(ctx));
-            break;
+            DISPATCH();
 
-        case OPCODE::PUSH_VAL_COUNT:
+        TARGET(PUSH_VAL_COUNT):
             push(exec::frag_count(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::PUSH_VAL_INDEX:
+        TARGET(PUSH_VAL_INDEX):
             push(exec::frag_index(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::PUSH_VAL_FIRST:
+        TARGET(PUSH_VAL_FIRST):
             push(exec::is_first_frag(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::PUSH_VAL_LAST:
+        TARGET(PUSH_VAL_LAST):
             push(exec::is_last_frag(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::PUSH_VAL_INNER:
+        TARGET(PUSH_VAL_INNER):
             push(exec::is_inner_frag(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::PUSH_FRAG:
+        TARGET(PUSH_FRAG):
             push(exec::push_frag(ctx));
-            break;
+            DISPATCH();
 
-        case OPCODE::PUSH_ROOT_FRAG:
+        TARGET(PUSH_ROOT_FRAG):
             push(exec::push_root_frag(ctx));
-            break;
+            DISPATCH();
 
-        case OPCODE::PUSH_THIS_FRAG:
+        TARGET(PUSH_THIS_FRAG):
             push(exec::push_this_frag(ctx));
-            break;
+            DISPATCH();
 
-        case OPCODE::PUSH_ERROR_FRAG:
+        TARGET(PUSH_ERROR_FRAG):
             push(exec::push_error_frag(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::PUSH_ATTR_AT:
+        TARGET(PUSH_ATTR_AT):
             push(exec::push_attr_at(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::POP_ATTR:
+        TARGET(POP_ATTR):
             push(exec::pop_attr(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::PUSH_ATTR:
+        TARGET(PUSH_ATTR):
             push(exec::push_attr(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::REPR:
+        TARGET(REPR):
             push(exec::repr(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::QUERY_REPR:
+        TARGET(QUERY_REPR):
             push(exec::query_repr(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::QUERY_COUNT:
+        TARGET(QUERY_COUNT):
             push(exec::query_count(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::QUERY_TYPE:
+        TARGET(QUERY_TYPE):
             push(exec::query_type(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::QUERY_DEFINED:
+        TARGET(QUERY_DEFINED):
             push(exec::query_defined(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::QUERY_EXISTS:
+        TARGET(QUERY_EXISTS):
             push(exec::query_exists(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::ISEMPTY:
+        TARGET(ISEMPTY):
             push(exec::query_isempty(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::ISUNDEFINED:
+        TARGET(ISUNDEFINED):
             push(exec::query_isundefined(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::ISINTEGRAL:
+        TARGET(ISINTEGRAL):
             push(exec::query_isintegral(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::ISREAL:
+        TARGET(ISREAL):
             push(exec::query_isreal(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::ISSTRING:
+        TARGET(ISSTRING):
             push(exec::query_isstring(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::ISFRAG:
+        TARGET(ISFRAG):
             push(exec::query_isfrag(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::ISFRAGLIST:
+        TARGET(ISFRAGLIST):
             push(exec::query_isfraglist(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::ISREGEX:
+        TARGET(ISREGEX):
             push(exec::query_isregex(ctx, get_arg));
-            break;
+            DISPATCH();
 
-        case OPCODE::LOG_SUPPRESS:
+        TARGET(LOG_SUPPRESS):
             ++ctx->log_suppressed;
-            break;
+            DISPATCH();
+
+        // the superinstructions pass the value right to the consumer and
+        // then move the ip onto the last instruction of the fused sequence
+        // whose params they use
+        TARGET(PRINT_VAR): {
+            auto &instr = ctx->instr->template as<PrintVar_t>();
+            auto value = exec::var(ctx, instr, true);
+            ctx->instr = &program[++ip];
+            exec::print(ctx, value);
+            DISPATCH();
+        }
+
+        TARGET(PRINT_VAL): {
+            auto &instr = ctx->instr->template as<PrintVal_t>();
+            ctx->instr = &program[++ip];
+            exec::print(ctx, *instr.value);
+            DISPATCH();
+        }
+
+        TARGET(JMP_IF_VAR_NOT): {
+            auto &instr = ctx->instr->template as<JmpIfVarNot_t>();
+            auto value = exec::var(ctx, instr, false);
+            ctx->instr = &program[++ip];
+            if (!value)
+                ip += ctx->instr->template as<JmpIfNot_t>().addr_offset;
+            DISPATCH();
+        }
 
-        case OPCODE::RETURN:
+        TARGET(RETURN):
             ip = exec::return_impl(prg_stack);
-            break;
+            profiler.ret();
+            DISPATCH();
 
-        case OPCODE::CALL:
+        TARGET(CALL):
+            profiler.call(ctx->instr->template as<Call_t>());
             ip = exec::call_impl(ctx, prg_stack, *ip);
-            break;
+            DISPATCH();
 
-        case OPCODE::HALT:
-            break;
+        TARGET(HALT):
+            DISPATCH();
         }
 
     } catch (const runtime_ctx_needed_t &) {
@@ -507,6 +694,9 @@ process(Ctx_t *ctx, std::vector<Value_t> &stack, const SubProgram_t &program) {
     return true;
 }
 
+#undef DISPATCH
+#undef TARGET
+
 int logErrors(const ContentType_t *ct, Writer_t &writer, Error_t &err) {
     if (!err) return 0;
     bool useLineComment = false;
@@ -534,6 +724,23 @@ int logErrors(const ContentType_t *ct, Writer_t &writer, Error_t &err) {
     return 0;
 }
 
+/** Returns the content type of given name or the default one if there is no
+ * such content type.
+ */
+const ContentType_t *
+resolve_content_type(Error_t &err, const string_view_t &contentType) {
+    auto *desc = ContentType_t::find(contentType);
+    if (!desc) {
+        logError(
+            err,
+            "Invalid content-type in argument of Teng::generatePage(): "
+            + contentType + "; using default"
+        );
+        desc = ContentType_t::getDefault();
+    }
+    return desc->contentType.get();
+}
+
 } // namespace
 
 Processor_t::Processor_t(
@@ -547,25 +754,60 @@ Processor_t::Processor_t(
    encoding(encoding), contentType(contentType)
 {srand(static_cast<uint32_t>(time(nullptr) ^ getpid()));}
 
-void Processor_t::run(const FragmentValue_t &data, Writer_t &writer) {
-    // ensure content type
-    auto *desc = ContentType_t::find(contentType);
-    if (!desc) {
-        logError(
-            err,
-            "Invalid content-type in argument of Teng::generatePage(): "
-            + contentType + "; using default"
-        );
-        desc = ContentType_t::getDefault();
+Processor_t::Dispatch_t Processor_t::defaultDispatch() {
+#ifdef TENG_COMPUTED_GOTO
+    return Dispatch_t::THREADED;
+#else /* TENG_COMPUTED_GOTO */
+    return Dispatch_t::SWITCH;
+#endif /* TENG_COMPUTED_GOTO */
+}
+
+void Processor_t::run(
+    const FragmentValue_t &data,
+    Writer_t &writer,
+    Dispatch_t dispatch
+) {
+    // run the program
+    const ContentType_t *ct = resolve_content_type(err, contentType);
+    ValueStack_t stack(program.maxStackDepth());
+    Formatter_t output(writer);
+    RunCtx_t ctx{err, program, dict, params, encoding, ct, data, output};
+    SubProgram_t whole{0, static_cast<int64_t>(program.size()), program};
+    switch (dispatch) {
+    case Dispatch_t::THREADED:
+#ifdef TENG_COMPUTED_GOTO
+        process<Dispatch_t::THREADED>(&ctx, stack, whole);
+        break;
+#endif /* TENG_COMPUTED_GOTO */
+    case Dispatch_t::SWITCH:
+        process<Dispatch_t::SWITCH>(&ctx, stack, whole);
+        break;
     }
-    const ContentType_t *ct = desc->contentType.get();
 
+    // log errors into log, if said
+    if (params.isLogToOutputEnabled()) logErrors(ct, writer, err);
+}
+
+void Processor_t::run(
+    const FragmentValue_t &data,
+    Writer_t &writer,
+    Profile_t &profile
+) {
     // run the program
-    std::vector<Value_t> stack;
-    stack.reserve(128);
+    const ContentType_t *ct = resolve_content_type(err, contentType);
+    ValueStack_t stack(program.maxStackDepth());
     Formatter_t output(writer);
     RunCtx_t ctx{err, program, dict, params, encoding, ct, data, output};
-    process(&ctx, stack, {0, static_cast<int64_t>(program.size()), program});
+    SubProgram_t whole{0, static_cast<int64_t>(program.size()), program};
+    if (profile.samplePeriod()) {
+        StackSampler_t sampler(program, ctx.frames, profile);
+        process<Dispatch_t::SWITCH>(&ctx, stack, whole, sampler);
+    } else {
+        InstrProfiler_t profiler(program.size());
+        process<Dispatch_t::SWITCH>(&ctx, stack, whole, profiler);
+        profiler.leave();
+        profiler.report(program, profile);
+    }
 
     // log errors into log, if said
     if (params.isLogToOutputEnabled()) logErrors(ct, writer, err);
@@ -577,14 +819,22 @@ Processor_t::eval(const OFFApi_t *frames, int64_t start) {
     if (start < 0) return Value_t();
     int64_t end = program.size();
 
+    // the program is still being compiled, so the stack depth is computed
+    // just for the evaluated expression
+    std::size_t depth = 0;
+    try {
+        depth = max_stack_depth(program, start, end);
+    } catch (const bad_stack_depth_t &) {return Value_t();}
+
     // init processor context (no run context - we are in compile time)
-    std::vector<Value_t> stack;
-    stack.reserve(128);
+    ValueStack_t stack(depth);
     Error_t opt_err;
     EvalCtx_t ctx{opt_err, program, dict, params, encoding, frames};
 
     // after evaluation the expression should left result value on the stack top
-    if (!process(&ctx, stack, {start, end, program})) return Value_t();
+    // the expressions are short, so the threaded dispatch doesn't pay off
+    SubProgram_t expr{start, end, program};
+    if (!process<Dispatch_t::SWITCH>(&ctx, stack, expr)) return Value_t();
     if (!opt_err.empty()) return Value_t();
     if (stack.size() != 1) return Value_t();
     return Value_t(std::move(stack.back()));
@@ -59,6 +59,7 @@ class FragmentValue_t;
 class Dictionary_t;
 class Configuration_t;
 class ContentType_t;
+class Profile_t;
 
 /** Does the template interpretation.
  */
@@ -82,12 +83,45 @@ public:
         const string_view_t &contentType = {}
     );
 
+    /** The ways the instructions are dispatched.
+     */
+    enum class Dispatch_t {
+        SWITCH,   //!< the portable switch over opcodes
+        THREADED, //!< computed goto from handler to handler
+    };
+
+    /** Returns the threaded dispatch if the compiler supports it and the
+     * switch dispatch otherwise.
+     */
+    static Dispatch_t defaultDispatch();
+
     /** Execute program.
      *
      * @param data Application data supplied by user.
      * @param writer Output stream object.
+     * @param dispatch The way the instructions are dispatched; the threaded
+     *                 one falls back to switch if it isn't supported.
      */
-    void run(const FragmentValue_t &data, Writer_t &writer);
+    void run(
+        const FragmentValue_t &data,
+        Writer_t &writer,
+        Dispatch_t dispatch = defaultDispatch()
+    );
+
+    /** Execute program and add the counters of its instructions or the
+     * samples of template stack to the profile (see Profile_t). The
+     * profiled program is always dispatched by the switch, so the counters
+     * can be taken at one place.
+     *
+     * @param data Application data supplied by user.
+     * @param writer Output stream object.
+     * @param profile The profile where the counters are added.
+     */
+    void run(
+        const FragmentValue_t &data,
+        Writer_t &writer,
+        Profile_t &profile
+    );
 
     /** Try to evaluate an expression.
      *
@@ -37,7 +37,11 @@
 #ifndef TENGPROCESSORCONTEXT_H
 #define TENGPROCESSORCONTEXT_H
 
+#include <new>
 #include <stack>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
 
 #include "logging.h"
 #include "program.h"
@@ -106,6 +110,115 @@ struct RunCtxPtr_t {
     RunCtx_t *ptr;
 };
 
+/** The value stack of the processor. The whole stack is allocated before the
+ * program is run because its maximal depth is known from the compile time
+ * (see max_stack_depth()), so the push and pop are just the pointer bumps.
+ * The bounds are checked only in debug builds.
+ */
+class ValueStack_t {
+public:
+    // types
+    using iterator = Value_t *;
+    using const_iterator = const Value_t *;
+
+    /** C'tor.
+     *
+     * @param capacity the maximal depth of the stack
+     */
+    explicit ValueStack_t(std::size_t capacity)
+        : slots(new Slot_t[capacity]),
+          first(reinterpret_cast<Value_t *>(slots.get())),
+          last(first), limit(first + capacity)
+    {}
+
+    /** D'tor - destroys the values left on the stack.
+     */
+    ~ValueStack_t() {drop(size());}
+
+    /** Pushes the value on the top of the stack.
+     */
+    template <typename type_t>
+    void push(type_t &&value) {
+#ifdef DEBUG
+        if (last == limit)
+            throw std::runtime_error("program stack overflow");
+#endif /* DEBUG */
+        new (last) Value_t(std::forward<type_t>(value));
+        ++last;
+    }
+
+    /** Removes the value from the top of the stack and returns it.
+     */
+    Value_t pop() {
+        Value_t value = std::move(back());
+        pop_back();
+        return value;
+    }
+
+    /** Removes the value from the top of the stack.
+     */
+    void pop_back() {
+#ifdef DEBUG
+        if (last == first)
+            throw std::runtime_error("program stack underflow");
+#endif /* DEBUG */
+        (--last)->~Value_t();
+    }
+
+    /** Removes the count values from the top of the stack.
+     */
+    void drop(std::size_t count) {
+#ifdef DEBUG
+        if (size() < count)
+            throw std::runtime_error("program stack underflow");
+#endif /* DEBUG */
+        for (; count; --count) (--last)->~Value_t();
+    }
+
+    /** Returns the value on the top of the stack.
+     */
+    Value_t &back() {
+#ifdef DEBUG
+        if (last == first)
+            throw std::runtime_error("program stack underflow");
+#endif /* DEBUG */
+        return *(last - 1);
+    }
+
+    /** Returns the number of values on the stack.
+     */
+    std::size_t size() const {return static_cast<std::size_t>(last - first);}
+
+    /** Returns true if there is no value on the stack.
+     */
+    bool empty() const {return last == first;}
+
+    /** Returns the maximal depth of the stack.
+     */
+    std::size_t capacity() const {return static_cast<std::size_t>(limit - first);}
+
+    /** Returns the bottom of the stack.
+     */
+    const_iterator begin() const {return first;}
+
+    /** Returns one past the top of the stack.
+     */
+    const_iterator end() const {return last;}
+
+private:
+    // don't copy
+    ValueStack_t(const ValueStack_t &) = delete;
+    ValueStack_t &operator=(const ValueStack_t &) = delete;
+
+    // the uninitialized storage of one value
+    using Slot_t = std::aligned_storage_t<sizeof(Value_t), alignof(Value_t)>;
+
+    std::unique_ptr<Slot_t[]> slots; //!< the storage of the stack
+    Value_t *first;                  //!< the bottom of the stack
+    Value_t *last;                   //!< one past the top of the stack
+    Value_t *limit;                  //!< the end of the storage
+};
+
 /** Because of undefined order of function arguments evaluation, you can't use
  * somehing like: some_function(pop(stack), pop(stack)).
  * (Supposing that pop returns a value.)
@@ -116,47 +229,56 @@ struct GetArg_t {
 public:
     /** C'tor.
      */
-    GetArg_t(std::vector<Value_t> &stack): stack(stack) {}
+    GetArg_t(ValueStack_t &stack): stack(stack) {}
 
     /** Returns the most recent arg.
      */
-    Value_t operator()() const {
-        if (stack.empty())
+    Value_t operator()() const {return stack.pop();}
+
+    /** Returns the view of the count most recent args; they stay on the
+     * stack until they are dropped.
+     */
+    FunctionArgsView_t view(std::size_t count) const {
+#ifdef DEBUG
+        if (stack.size() < count)
             throw std::runtime_error("program stack underflow");
-        Value_t value = std::move(stack.back());
-        stack.pop_back();
-        return value;
+#endif /* DEBUG */
+        return {stack.end() - count, stack.end()};
     }
 
+    /** Removes the count most recent args.
+     */
+    void drop(std::size_t count) const {stack.drop(count);}
+
 protected:
-    std::vector<Value_t> &stack; //!< where are arguments stored
+    ValueStack_t &stack; //!< where are arguments stored
 };
 
-/** Returns position of instruction in template source.
+/** Returns position of current instruction in template source.
  */
-inline Pos_t position(const Instruction_t *instr) {
-    return instr? instr->pos(): Pos_t();
+inline Pos_t position(const EvalCtx_t &ctx) {
+    return ctx.instr? ctx.program.pos(*ctx.instr): Pos_t();
 }
 
 /** Writes fatal message to log.
  */
 inline void logFatal(EvalCtx_t &ctx, const std::string &msg) {
     if (ctx.log_suppressed) return;
-    logFatal(ctx.err, position(ctx.instr), "Runtime: " + msg);
+    logFatal(ctx.err, position(ctx), "Runtime: " + msg);
 }
 
 /** Writes error message to log.
  */
 inline void logError(EvalCtx_t &ctx, const std::string &msg) {
     if (ctx.log_suppressed) return;
-    logError(ctx.err, position(ctx.instr), "Runtime: " + msg);
+    logError(ctx.err, position(ctx), "Runtime: " + msg);
 }
 
 /** Writes warning message to log.
  */
 inline void logWarning(EvalCtx_t &ctx, const std::string &msg) {
     if (ctx.log_suppressed) return;
-    logWarning(ctx.err, position(ctx.instr), "Runtime: " + msg);
+    logWarning(ctx.err, position(ctx), "Runtime: " + msg);
 }
 
 } // namespace Teng
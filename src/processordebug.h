@@ -67,12 +67,14 @@ bool has_vars_and_frags(const Fragment_t &frag) {
         case FragmentValue_t::tag::frag:
         case FragmentValue_t::tag::list:
         case FragmentValue_t::tag::frag_ptr:
+        case FragmentValue_t::tag::lazy:
             if (vars) return true;
             frags = true;
             break;
         case FragmentValue_t::tag::integral:
         case FragmentValue_t::tag::real:
         case FragmentValue_t::tag::string:
+        case FragmentValue_t::tag::string_view:
             if (frags) return true;
             vars = true;
             break;
@@ -98,6 +100,7 @@ void write_vars(RunCtx_t *ctx, const Fragment_t &frag, std::string indent) {
         case FragmentValue_t::tag::frag:
         case FragmentValue_t::tag::list:
         case FragmentValue_t::tag::frag_ptr:
+        case FragmentValue_t::tag::lazy:
             // skip frags, they will be written after variables
             break;
         case FragmentValue_t::tag::integral:
@@ -121,6 +124,13 @@ void write_vars(RunCtx_t *ctx, const Fragment_t &frag, std::string indent) {
             write_escaped(clip(*var.second.string(), max_val_len));
             write_escaped("'\n");
             break;
+        case FragmentValue_t::tag::string_view:
+            write_escaped(indent);
+            write_escaped(var.first);
+            write_escaped(": '");
+            write_escaped(clip(var.second.view()->str(), max_val_len));
+            write_escaped("'\n");
+            break;
         }
     }
 }
@@ -137,6 +147,7 @@ void write_frags(RunCtx_t *ctx, const Fragment_t &frag, std::string indent) {
     for (auto &var: frag) {
         switch (var.second.type()) {
         case FragmentValue_t::tag::list:
+        case FragmentValue_t::tag::lazy:
             for (auto i = 0u; i < var.second.list()->size(); ++i) {
                 write_escaped(indent);
                 write_escaped(var.first);
@@ -160,6 +171,7 @@ void write_frags(RunCtx_t *ctx, const Fragment_t &frag, std::string indent) {
         case FragmentValue_t::tag::integral:
         case FragmentValue_t::tag::real:
         case FragmentValue_t::tag::string:
+        case FragmentValue_t::tag::string_view:
             // skip scalar values, they have been written before variables
             break;
         }
@@ -181,6 +193,7 @@ write_frag_val(RunCtx_t *ctx, const FragmentValue_t &val, std::string indent) {
     // write fragment value
     switch (val.type()) {
     case FragmentValue_t::tag::list:
+    case FragmentValue_t::tag::lazy:
         for (auto i = 0u; i < val.list()->size(); ++i) {
             write_escaped(indent);
             write_escaped("[" + std::to_string(i) + "]:\n");
@@ -202,6 +215,9 @@ write_frag_val(RunCtx_t *ctx, const FragmentValue_t &val, std::string indent) {
     case FragmentValue_t::tag::string:
         write_escaped(clip(*val.string(), max_val_len));
         break;
+    case FragmentValue_t::tag::string_view:
+        write_escaped(clip(val.view()->str(), max_val_len));
+        break;
     case FragmentValue_t::tag::real:
         write_escaped(std::to_string(*val.real()));
         break;
@@ -71,9 +71,7 @@ void warn(Ctx_t ctx, const string_view_t &msg) {
 
 /** Implementation of the variable lookup.
  */
-inline Result_t var(RunCtxPtr_t ctx, bool escape) {
-    auto &instr = ctx->instr->as<Var_t>();
-
+inline Result_t var(RunCtxPtr_t ctx, const Var_t &instr, bool escape) {
     // if variable does not exist then return empty string
     Value_t value = ctx->frames.get_var(instr);
     if (value.is_undefined()) {
@@ -97,6 +95,12 @@ inline Result_t var(RunCtxPtr_t ctx, bool escape) {
     return value;
 }
 
+/** Implementation of the variable lookup.
+ */
+inline Result_t var(RunCtxPtr_t ctx, bool escape) {
+    return var(ctx, ctx->instr->as<Var_t>(), escape);
+}
+
 /** Set variable value.
  */
 inline void set_var(RunCtxPtr_t ctx, GetArg_t get_arg) {
@@ -127,7 +131,7 @@ inline void close_frame(RunCtxPtr_t ctx) {
  */
 inline int64_t open_frag(RunCtxPtr_t ctx) {
     auto &instr = ctx->instr->as<OpenFrag_t>();
-    return ctx->frames.open_frag(instr.name)
+    return ctx->frames.open_frag(*instr.name)
         ? 0
         : instr.close_frag_offset;
 }
@@ -178,7 +182,7 @@ inline Result_t frag_count(RunCtxPtr_t ctx, GetArg_t get_arg) {
     default:
         warn(
             ctx,
-            "The path expression '" + instr.path + "' references object "
+            "The path expression '" + *instr.path + "' references object "
             "of '" + arg.type_str() + "' type with value '"
             + arg.printable() + "' for which is _count builtin variable "
             + "undefined"
@@ -212,14 +216,14 @@ inline Result_t frag_index(RunCtxPtr_t ctx, GetArg_t get_arg) {
         case 0:
             warn(
                 ctx,
-                "The path '" + instr.path + "' references fragment list that "
+                "The path '" + *instr.path + "' references fragment list that "
                 "does not contain any fragment; _index variable is undefined"
             );
             return Result_t();
         default:
             warn(
                 ctx,
-                "The path '" + instr.path + "' references fragment list of "
+                "The path '" + *instr.path + "' references fragment list of "
                 + std::to_string(arg.as_list_ref().ptr->size()) + " fragments; "
                 "_index variable is undefined"
             );
@@ -232,7 +236,7 @@ inline Result_t frag_index(RunCtxPtr_t ctx, GetArg_t get_arg) {
     default:
         warn(
             ctx,
-            "The path expression '" + instr.path + "' references object "
+            "The path expression '" + *instr.path + "' references object "
             "of '" + arg.type_str() + "' type with value '"
             + arg.printable() + "' for which is _index builtin variable "
             + "undefined"
@@ -266,14 +270,14 @@ inline Result_t is_first_frag(RunCtxPtr_t ctx, GetArg_t get_arg) {
         case 0:
             warn(
                 ctx,
-                "The path '" + instr.path + "' references fragment list that "
+                "The path '" + *instr.path + "' references fragment list that "
                 "does not contain any fragment; _first variable is undefined"
             );
             return Result_t();
         default:
             warn(
                 ctx,
-                "The path '" + instr.path + "' references fragment list of "
+                "The path '" + *instr.path + "' references fragment list of "
                 + std::to_string(arg.as_list_ref().ptr->size()) + " fragments; "
                 "_first variable is undefined"
             );
@@ -286,7 +290,7 @@ inline Result_t is_first_frag(RunCtxPtr_t ctx, GetArg_t get_arg) {
     default:
         warn(
             ctx,
-            "The path expression '" + instr.path + "' references object "
+            "The path expression '" + *instr.path + "' references object "
             "of '" + arg.type_str() + "' type with value '"
             + arg.printable() + "' for which is _first builtin variable "
             + "undefined"
@@ -323,14 +327,14 @@ inline Result_t is_last_frag(RunCtxPtr_t ctx, GetArg_t get_arg) {
         case 0:
             warn(
                 ctx,
-                "The path '" + instr.path + "' references fragment list that "
+                "The path '" + *instr.path + "' references fragment list that "
                 "does not contain any fragment; _last variable is undefined"
             );
             return Result_t();
         default:
             warn(
                 ctx,
-                "The path '" + instr.path + "' references fragment list of "
+                "The path '" + *instr.path + "' references fragment list of "
                 + std::to_string(arg.as_list_ref().ptr->size()) + " fragments; "
                 "_last variable is undefined"
             );
@@ -343,7 +347,7 @@ inline Result_t is_last_frag(RunCtxPtr_t ctx, GetArg_t get_arg) {
     default:
         warn(
             ctx,
-            "The path expression '" + instr.path + "' references object "
+            "The path expression '" + *instr.path + "' references object "
             "of '" + arg.type_str() + "' type with value '"
             + arg.printable() + "' for which is _last builtin variable "
             + "undefined"
@@ -380,14 +384,14 @@ inline Result_t is_inner_frag(RunCtxPtr_t ctx, GetArg_t get_arg) {
         case 0:
             warn(
                 ctx,
-                "The path '" + instr.path + "' references fragment list that "
+                "The path '" + *instr.path + "' references fragment list that "
                 "does not contain any fragment; _inner variable is undefined"
             );
             return Result_t();
         default:
             warn(
                 ctx,
-                "The path '" + instr.path + "' references fragment list of "
+                "The path '" + *instr.path + "' references fragment list of "
                 + std::to_string(arg.as_list_ref().ptr->size()) + " fragments; "
                 "_inner variable is undefined"
             );
@@ -400,7 +404,7 @@ inline Result_t is_inner_frag(RunCtxPtr_t ctx, GetArg_t get_arg) {
     default:
         warn(
             ctx,
-            "The path expression '" + instr.path + "' references object "
+            "The path expression '" + *instr.path + "' references object "
             "of '" + arg.type_str() + "' type with value '"
             + arg.printable() + "' for which is _inner builtin variable "
             + "undefined"
@@ -448,7 +452,7 @@ inline Result_t push_frag(RunCtxPtr_t ctx) {
     if (!value.is_undefined()) {
         logWarning(
             *ctx,
-            "The '" + instr.name + "' identifier is reserved; "
+            "The '" + *instr.name + "' identifier is reserved; "
             "don't use it, please"
         );
         return value;
@@ -475,18 +479,18 @@ Result_t push_attr(Ctx_t *ctx, GetArg_t get_arg) {
     // attempt to get value for desired name
     std::size_t ambiguous = std::numeric_limits<std::size_t>::infinity();
     auto &instr = ctx->instr->template as<PushAttr_t>();
-    auto result = ctx->frames_ptr->value_at(arg, instr.name, ambiguous);
+    auto result = ctx->frames_ptr->value_at(arg, *instr.name, ambiguous);
 
     // attribute has been found
     if (!result.is_undefined())
         return result;
 
     // current fragment does not contain attribute
-    if (instr.path.empty()) {
+    if (instr.path->empty()) {
         if (ambiguous != std::numeric_limits<std::size_t>::infinity()) {
             warn(
                 ctx,
-                "The key '" + instr.name + "' references frament list of '"
+                "The key '" + *instr.name + "' references frament list of '"
                 + std::to_string(ambiguous) + "' fragments; the expression "
                 "is ambiguous"
             );
@@ -494,7 +498,7 @@ Result_t push_attr(Ctx_t *ctx, GetArg_t get_arg) {
         }
         warn(
             ctx,
-            "This fragment doesn't contain any value for key '" + instr.name
+            "This fragment doesn't contain any value for key '" + *instr.name
             + "'"
         );
         return result;
@@ -504,7 +508,7 @@ Result_t push_attr(Ctx_t *ctx, GetArg_t get_arg) {
     if (ambiguous != std::numeric_limits<std::size_t>::infinity()) {
         warn(
             ctx,
-            "The path expression '" + instr.path + "' references fragment list "
+            "The path expression '" + *instr.path + "' references fragment list "
             "of '" + std::to_string(ambiguous) + "' fragments; "
             "the expression is ambiguous"
         );
@@ -514,8 +518,8 @@ Result_t push_attr(Ctx_t *ctx, GetArg_t get_arg) {
     // attribute hasn't been found
     warn(
         ctx,
-        "The path expression '" + instr.path + "' references fragment "
-        "that doesn't contain any value for key '" + instr.name + "'"
+        "The path expression '" + *instr.path + "' references fragment "
+        "that doesn't contain any value for key '" + *instr.name + "'"
     );
     return result;
 }
@@ -543,7 +547,7 @@ inline Result_t push_attr_at(EvalCtx_t *ctx, GetArg_t get_arg) {
     if (ambiguous != std::numeric_limits<std::size_t>::infinity()) {
         warn(
             ctx,
-            "The path expression '" + instr.path + "' references fragment list "
+            "The path expression '" + *instr.path + "' references fragment list "
             "of '" + std::to_string(ambiguous) + "' fragments; "
             "the expression is ambiguous"
         );
@@ -560,7 +564,7 @@ inline Result_t push_attr_at(EvalCtx_t *ctx, GetArg_t get_arg) {
     case Value_t::tag::regex:
         warn(
             ctx,
-            "The path expression '" + instr.path + "' references object "
+            "The path expression '" + *instr.path + "' references object "
             "of '" + arg.type_str() + "' type with value '"
             + arg.printable() + "' that is not subscriptable"
         );
@@ -570,14 +574,14 @@ inline Result_t push_attr_at(EvalCtx_t *ctx, GetArg_t get_arg) {
         if (index.is_string_like()) {
             warn(
                 ctx,
-                "The path expression '" + instr.path + "' references "
+                "The path expression '" + *instr.path + "' references "
                 "fragment that doesn't contain any value for key '"
                 + index.string() + "'"
             );
         } else {
             warn(
                 ctx,
-                "The path expression '" + instr.path + "' references "
+                "The path expression '" + *instr.path + "' references "
                 "fragment which can't be subscripted by values of '"
                 + index.type_str() + "' type with value '"
                 + index.printable() + "'"
@@ -592,12 +596,12 @@ inline Result_t push_attr_at(EvalCtx_t *ctx, GetArg_t get_arg) {
                 "range <0, "
                 + std::to_string(arg.as_list_ref().ptr->size())
                 + ") of the fragments list referenced by this path "
-                "expression '" + instr.path + "'"
+                "expression '" + *instr.path + "'"
             );
         } else {
             warn(
                 ctx,
-                "The path expression '" + instr.path + "' references "
+                "The path expression '" + *instr.path + "' references "
                 "fragment lists which can't be subscripted by values "
                 "of '" + index.type_str() + "' type with value '"
                 + index.printable() + "'"
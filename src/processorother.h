@@ -50,7 +50,7 @@ namespace exec {
  */
 Result_t val(EvalCtx_t *ctx) {
     auto &instr = ctx->instr->template as<Val_t>();
-    switch (instr.value.type()) {
+    switch (instr.value->type()) {
         case Value_t::tag::undefined:
         case Value_t::tag::integral:
         case Value_t::tag::real:
@@ -58,10 +58,10 @@ Result_t val(EvalCtx_t *ctx) {
         case Value_t::tag::regex:
         case Value_t::tag::frag_ref:
         case Value_t::tag::list_ref:
-            return instr.value;
+            return *instr.value;
         case Value_t::tag::string:
             // saves some allocation, instruction lives longer than value
-            return Result_t(instr.value.string());
+            return Result_t(instr.value->string());
     }
     throw std::runtime_error(__PRETTY_FUNCTION__);
 }
@@ -108,7 +108,39 @@ Result_t prg_stack_at(EvalCtx_t *ctx, std::vector<Value_t> &prg_stack) {
     return prg_stack[prg_stack.size() - 1 - instr.index];
 }
 
-/** Evaluates function if such exists.
+/** Calls the user defined function. The function taking the args in vector
+ * gets them moved from the value stack, the one taking view of args gets
+ * them right from the value stack and they are removed after the call.
+ */
+template <typename Ctx_t>
+Result_t call_udf(
+    Ctx_t *ctx,
+    const Func_t &instr,
+    FunctionCtx_t &fun_ctx,
+    const udf::Slot_t &udf,
+    GetArg_t get_arg
+) {
+    if (udf.view_function) {
+        using Udf_t = const udf::ViewFunction_t &;
+        Invoker_t<Udf_t> function{*instr.name, udf.view_function};
+        auto result = function(ctx, fun_ctx, get_arg.view(instr.nargs));
+        get_arg.drop(instr.nargs);
+        return result;
+    }
+
+    // prepare args
+    FunctionArgs_t args;
+    args.reserve(instr.nargs);
+    for (auto i = instr.nargs; i > 0; --i)
+        args.push_back(get_arg());
+
+    using Udf_t = const udf::Function_t &;
+    Invoker_t<Udf_t> function{*instr.name, udf.function};
+    return function(ctx, fun_ctx, args);
+}
+
+/** Evaluates function if such exists. The args are removed from the value
+ * stack.
  */
 template <typename Ctx_t>
 Result_t func(Ctx_t *ctx, GetArg_t get_arg) {
@@ -117,31 +149,31 @@ Result_t func(Ctx_t *ctx, GetArg_t get_arg) {
     // make function context object
     auto fun_ctx = FunctionCtx_t(
         ctx->err,
-        instr.pos(),
+        ctx->program.pos(instr),
         ctx->encoding,
         ctx->escaper_ptr,
         ctx->params,
         ctx->dict
     );
 
-    // prepare args
-    FunctionArgs_t args;
-    for (auto i = instr.nargs; i > 0; --i)
-        args.push_back(get_arg());
-
     if (!instr.is_udf) {
-        // builtin functions
-        if (auto function = findFunction(instr.name))
-            return function(ctx, fun_ctx, args);
+        // builtin functions (bound during compilation) get view of args
+        if (instr.builtin) {
+            Invoker_t<Function_t> function{*instr.name, instr.builtin};
+            auto result = function(ctx, fun_ctx, get_arg.view(instr.nargs));
+            get_arg.drop(instr.nargs);
+            return result;
+        }
 
     } else {
         // we don't know what udf function does so it can't be optimized out
         if (!std::is_same_v<std::decay_t<Ctx_t>, RunCtx_t>)
             throw runtime_ctx_needed_t();
 
-        // user defined functions
-        if (auto function = udf::findFunction(instr.name))
-            return function(ctx, fun_ctx, args);
+        // user defined functions (bound during compilation or registered
+        // after the compilation)
+        if (auto *udf = instr.udf? instr.udf: udf::findSlot(*instr.name))
+            return call_udf(ctx, instr, fun_ctx, *udf, get_arg);
     }
 
     // if function does not exist then rather skip optimization
@@ -149,17 +181,17 @@ Result_t func(Ctx_t *ctx, GetArg_t get_arg) {
         throw runtime_ctx_needed_t{};
 
     // no such function
+    get_arg.drop(instr.nargs);
     logError(
         *ctx,
-        "Call of unknown function " + instr.name + "()"
+        "Call of unknown function " + *instr.name + "()"
     );
     return Result_t();
 }
 
-/** Writes string value of top item on stack (arg) to output.
+/** Writes string value of given value to output.
  */
-void print(RunCtxPtr_t ctx, GetArg_t get_arg) {
-    auto arg = get_arg();
+void print(RunCtxPtr_t ctx, const Value_t &arg) {
     auto &instr = ctx->instr->as<Print_t>();
     arg.print([&] (const string_view_t &v, auto &&tag) {
         switch (Value_t::visited_value(tag)) {
@@ -190,6 +222,12 @@ void print(RunCtxPtr_t ctx, GetArg_t get_arg) {
     });
 }
 
+/** Writes string value of top item on stack (arg) to output.
+ */
+void print(RunCtxPtr_t ctx, GetArg_t get_arg) {
+    print(ctx, get_arg());
+}
+
 /** Push new formatter on formatter stack.
  */
 void push_formatter(RunCtxPtr_t ctx) {
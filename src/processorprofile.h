@@ -0,0 +1,214 @@
+/*
+ * Teng -- a general purpose templating engine.
+ * Copyright (C) 2004  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Naskove 1, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:teng@firma.seznam.cz
+ *
+ *
+ * $Id: $
+ *
+ * DESCRIPTION
+ * Teng processor profilers.
+ *
+ * AUTHORS
+ * Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * HISTORY
+ * 2026-10-16  (burlog)
+ *             Created.
+ */
+
+#ifndef TENGPROCESSORPROFILE_H
+#define TENGPROCESSORPROFILE_H
+
+#include <chrono>
+#include <vector>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif /* __x86_64__ || __i386__ */
+
+#include "program.h"
+#include "openframes.h"
+#include "teng/profile.h"
+
+namespace Teng {
+
+/** The profiler of unprofiled runs; the compiler removes its calls.
+ */
+struct NoProfiler_t {
+    void enter(int64_t) {}
+    void leave() {}
+    void call(const Call_t &) {}
+    void ret() {}
+};
+
+/** Counts the executions and the cycles of each instruction of program.
+ * Each instruction gets the cycles until the next one is entered.
+ */
+class InstrProfiler_t {
+public:
+    /** C'tor.
+     *
+     * @param size the number of instructions of the program
+     */
+    InstrProfiler_t(std::size_t size): counters(size) {}
+
+    /** Called before the instruction at given address is executed.
+     */
+    void enter(int64_t addr) {
+        auto now = timestamp();
+        leave(now);
+        ++counters[addr].executions;
+        current = addr;
+        start = now;
+    }
+
+    /** Called when the program ends.
+     */
+    void leave() {leave(timestamp());}
+
+    /** The subroutine calls are accounted to the CALL instruction.
+     */
+    void call(const Call_t &) {}
+    void ret() {}
+
+    /** Adds the counters of the executed instructions to the profile.
+     */
+    void report(const Program_t &program, Profile_t &profile) const {
+        for (std::size_t addr = 0; addr < counters.size(); ++addr) {
+            if (!counters[addr].executions) continue;
+            auto &pos = program.pos(addr);
+            profile.add({
+                {*pos.filename, pos.lineno, pos.colno},
+                static_cast<int64_t>(addr),
+                program[addr].instr_name(),
+                counters[addr]
+            });
+        }
+    }
+
+protected:
+    /** Accounts the cycles since the last enter to the current instruction.
+     */
+    void leave(uint64_t now) {
+        if (current >= 0) counters[current].cycles += now - start;
+        current = -1;
+    }
+
+    /** Returns the CPU time stamp counter or the monotonic nanoseconds if
+     * it isn't available.
+     */
+    static uint64_t timestamp() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else /* __x86_64__ || __i386__ */
+        using namespace std::chrono;
+        auto now = steady_clock::now().time_since_epoch();
+        return static_cast<uint64_t>(duration_cast<nanoseconds>(now).count());
+#endif /* __x86_64__ || __i386__ */
+    }
+
+    std::vector<Profile_t::Counters_t> counters; //!< indexed by address
+    int64_t current = -1; //!< the address of running instruction
+    uint64_t start = 0;   //!< the timestamp when it has been entered
+};
+
+/** Samples the template stack at every period-th executed instruction.
+ */
+class StackSampler_t {
+public:
+    /** C'tor.
+     *
+     * @param program the sampled program
+     * @param frames the open fragments of the running program
+     * @param profile where the samples are stored
+     */
+    StackSampler_t(
+        const Program_t &program,
+        const OpenFrames_t &frames,
+        Profile_t &profile
+    ): program(program), frames(frames), profile(profile),
+       countdown(profile.samplePeriod())
+    {}
+
+    /** Called before the instruction at given address is executed.
+     */
+    void enter(int64_t addr) {
+        if (--countdown) return;
+        countdown = profile.samplePeriod();
+        sample(addr);
+    }
+
+    /** Called when the program ends.
+     */
+    void leave() {}
+
+    /** Called when the subroutine (block) is called.
+     */
+    void call(const Call_t &instr) {calls.push_back(instr.name);}
+
+    /** Called when the subroutine returns.
+     */
+    void ret() {if (!calls.empty()) calls.pop_back();}
+
+protected:
+    /** Appends the frame to the stack; the semicolons separate the frames,
+     * so they are replaced in the frame name.
+     */
+    void push_frame(const string_view_t &name) {
+        if (!stack.empty()) stack.push_back(';');
+        for (char ch: name) stack.push_back(ch == ';'? ':': ch);
+    }
+
+    /** Appends the include chain of the source file to the stack.
+     */
+    void push_includes(const std::string *filename) {
+        if (auto *incl_pos = program.includedFrom(filename))
+            push_includes(incl_pos->filename);
+        push_frame(*filename);
+    }
+
+    /** Adds the sample of the current stack to the profile.
+     */
+    void sample(int64_t addr) {
+        auto &pos = program.pos(addr);
+        stack.clear();
+        push_includes(pos.filename);
+        for (auto *name: calls) push_frame("block:" + *name);
+        frames.for_each_open_frag([&] (const string_view_t &name) {
+            push_frame("frag:" + name.str());
+        });
+        push_frame(*pos.filename + ':' + std::to_string(pos.lineno));
+        profile.addSample(stack);
+    }
+
+    const Program_t &program;               //!< the sampled program
+    const OpenFrames_t &frames;             //!< the open fragments
+    Profile_t &profile;                     //!< where the samples are stored
+    uint64_t countdown;                     //!< instructions to next sample
+    std::vector<const std::string *> calls; //!< the names of called blocks
+    std::string stack;                      //!< the buffer of sampled stack
+};
+
+} // namespace Teng
+
+#endif /* TENGPROCESSORPROFILE_H */
+
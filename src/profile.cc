@@ -0,0 +1,161 @@
+/*
+ * Teng -- a general purpose templating engine.
+ * Copyright (C) 2004  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Naskove 1, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:teng@firma.seznam.cz
+ *
+ *
+ * $Id: $
+ *
+ * DESCRIPTION
+ * Teng profile -- the execution counters of template instructions.
+ *
+ * AUTHORS
+ * Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * HISTORY
+ * 2026-10-16  (burlog)
+ *             Created.
+ */
+
+#include <map>
+#include <tuple>
+#include <ostream>
+#include <algorithm>
+
+#include "teng/profile.h"
+
+namespace Teng {
+namespace {
+
+/** Returns the key that orders the instructions.
+ */
+auto key(const Profile_t::Instr_t &instr) {
+    return std::tie(
+        instr.pos.filename,
+        instr.pos.lineno,
+        instr.pos.colno,
+        instr.addr,
+        instr.opcode
+    );
+}
+
+/** Sorts the items from the most expensive.
+ */
+template <typename items_t>
+void sort_by_cycles(items_t &items) {
+    std::stable_sort(
+        items.begin(),
+        items.end(),
+        [] (auto &lhs, auto &rhs) {
+            return lhs.counters.cycles > rhs.counters.cycles;
+        }
+    );
+}
+
+} // namespace
+
+void Profile_t::add(const Instr_t &instr) {
+    auto iinstr = std::lower_bound(
+        instrs.begin(),
+        instrs.end(),
+        instr,
+        [] (auto &lhs, auto &rhs) {return key(lhs) < key(rhs);}
+    );
+    if ((iinstr != instrs.end()) && (key(*iinstr) == key(instr)))
+        iinstr->counters += instr.counters;
+    else instrs.insert(iinstr, instr);
+}
+
+std::vector<Profile_t::Opcode_t> Profile_t::opcodes() const {
+    std::map<std::string, Counters_t> sums;
+    for (auto &instr: instrs)
+        sums[instr.opcode] += instr.counters;
+
+    std::vector<Opcode_t> result;
+    result.reserve(sums.size());
+    for (auto &sum: sums)
+        result.push_back({sum.first, sum.second});
+    sort_by_cycles(result);
+    return result;
+}
+
+std::vector<Profile_t::Line_t> Profile_t::lines() const {
+    std::vector<Line_t> result;
+    for (auto &instr: instrs) {
+        // the instructions are ordered by position
+        if (result.empty()
+            || (result.back().lineno != instr.pos.lineno)
+            || (result.back().filename != instr.pos.filename))
+            result.push_back({instr.pos.filename, instr.pos.lineno, {}});
+        result.back().counters += instr.counters;
+    }
+    sort_by_cycles(result);
+    return result;
+}
+
+Profile_t::Counters_t Profile_t::total() const {
+    Counters_t result;
+    for (auto &instr: instrs)
+        result += instr.counters;
+    return result;
+}
+
+void Profile_t::log(Error_t &err, std::size_t limit) const {
+    auto hot_lines = lines();
+    if (hot_lines.size() > limit) hot_lines.resize(limit);
+    for (auto &line: hot_lines) {
+        err.append(
+            Error_t::DEBUGING,
+            line.filename,
+            line.lineno,
+            0,
+            "Profile: executions=" + std::to_string(line.counters.executions)
+            + ", cycles=" + std::to_string(line.counters.cycles)
+        );
+    }
+}
+
+void Profile_t::dump(std::ostream &out) const {
+    auto sum = total();
+    out << "total: executions=" << sum.executions
+        << ", cycles=" << sum.cycles << std::endl;
+    out << "lines:" << std::endl;
+    for (auto &line: lines()) {
+        out << "  " << (line.filename.empty()? "(no file)": line.filename)
+            << ':' << line.lineno
+            << ": executions=" << line.counters.executions
+            << ", cycles=" << line.counters.cycles << std::endl;
+    }
+    out << "opcodes:" << std::endl;
+    for (auto &opcode: opcodes()) {
+        out << "  " << opcode.opcode
+            << ": executions=" << opcode.counters.executions
+            << ", cycles=" << opcode.counters.cycles << std::endl;
+    }
+}
+
+void Profile_t::dumpFolded(std::ostream &out) const {
+    for (auto &stack: stacks)
+        out << stack.first << ' ' << stack.second << '\n';
+    out.flush();
+}
+
+} // namespace Teng
+
@@ -58,5 +58,19 @@ void Program_t::dump(std::ostream &out) const {
     }
 }
 
+void Program_t::release(const_iterator first, const_iterator last) {
+    while (last != first)
+        if ((--last)->opcode() == OPCODE::VAL)
+            constants.release(last->as<Val_t>().value);
+}
+
+std::size_t Program_t::memoryUsage() const {
+    std::size_t result = sizeof(Program_t) + sources.memoryUsage();
+    result += instrs.capacity() * sizeof(value_type);
+    result += positions.capacity() * sizeof(Pos_t);
+    result += includes.capacity() * sizeof(Includes_t::value_type);
+    return result + constants.memoryUsage();
+}
+
 } // namespace Teng
 
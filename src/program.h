@@ -42,8 +42,11 @@
 
 #include <cstdio>
 #include <vector>
+#include <type_traits>
 
+#include "position.h"
 #include "instruction.h"
+#include "constantpool.h"
 #include "sourcelist.h"
 #include "teng/error.h"
 
@@ -51,6 +54,11 @@ namespace Teng {
 
 /** Program is an instruction flow. Whole template is compiled into single
  * program that can interpret it.
+ *
+ * The instructions are kept small: the strings and literals they refer to
+ * live in the constant pool and the source positions, that are needed only
+ * for error reporting, are stored aside in the table parallel to the
+ * instructions.
  */
 class Program_t {
 public:
@@ -58,11 +66,17 @@ public:
     using value_type = InstrBox_t;
     using const_iterator = std::vector<value_type>::const_iterator;
     using iterator = std::vector<value_type>::iterator;
+    using Includes_t = std::vector<std::pair<const std::string *, Pos_t>>;
 
     /** @short Create new program. */
     Program_t(Error_t &error)
-        : sources(), error(error), instrs()
-    {instrs.reserve(1024);}
+        : sources(), error(error), instrs(), positions(), constants(),
+          stack_depth(0), includes()
+    {instrs.reserve(1024); positions.reserve(1024);}
+
+    // don't copy (the instructions point to the constant pool)
+    Program_t(const Program_t &) = delete;
+    Program_t &operator=(const Program_t &) = delete;
 
     /** Print whole program into file stream.
      * @param fp File stream for output. */
@@ -76,6 +90,9 @@ public:
       * @return 0=OK !0=changed. */
     int isChanged(const FilesystemInterface_t* filesystem) const {return sources.isChanged(filesystem);}
 
+    /** @short Starts watching source files by given watcher. */
+    void watch(FileWatcher_t &watcher) const {sources.watch(watcher);}
+
     /** @short Return error log.
       * @return Reference to error log object. */
     Error_t &getErrors() {return error;}
@@ -93,6 +110,31 @@ public:
       */
     const SourceList_t &getSources() const {return sources;}
 
+    /** Remembers the position of the directive that has included the
+     * source file. Only the first inclusion of each file is remembered, so
+     * the includes can't form a cycle.
+     */
+    void addInclude(const std::string *filename, const Pos_t &incl_pos) {
+        if (!includedFrom(filename)) includes.emplace_back(filename, incl_pos);
+    }
+
+    /** Returns the position of the directive that has included the source
+     * file or nullptr if the file hasn't been included.
+     */
+    const Pos_t *includedFrom(const std::string *filename) const {
+        for (auto &include: includes)
+            if (include.first == filename) return &include.second;
+        return nullptr;
+    }
+
+    /** Returns the included files and the positions they are included from.
+     */
+    const Includes_t &getIncludes() const {return includes;}
+
+    /** Returns the number of bytes occupied by the program.
+     */
+    std::size_t memoryUsage() const;
+
     /** Returns true if program does not contain any instruction.
      */
     bool empty() const {return instrs.empty();}
@@ -103,7 +145,21 @@ public:
 
     /** Truncates whole program.
      */
-    void clear() {instrs.clear();}
+    void clear() {instrs.clear(); positions.clear(); stack_depth = 0;}
+
+    /** Returns the maximal depth of the value stack the program can reach,
+     * so the processor can preallocate the whole stack before it runs.
+     */
+    std::size_t maxStackDepth() const {return stack_depth;}
+
+    /** Sets the maximal depth of the value stack (see max_stack_depth()).
+     */
+    void setMaxStackDepth(std::size_t depth) {stack_depth = depth;}
+
+    /** Releases the instruction storage that isn't used (the programs are
+     * cached, so they shouldn't hold the preallocated space).
+     */
+    void shrink_to_fit() {instrs.shrink_to_fit(); positions.shrink_to_fit();}
 
     /** Returns iterator to the first instruction.
      */
@@ -133,6 +189,8 @@ public:
             );
         }
 #endif /* DEBUG */
+        release(instrs.begin() + pos, instrs.end());
+        positions.erase(positions.begin() + pos, positions.end());
         return instrs.erase(instrs.begin() + pos, instrs.end());
     }
 
@@ -152,30 +210,128 @@ public:
      */
     value_type &back() {return instrs.back();}
 
-    /** Appends new instruction at the end of the program.
+    /** Returns the position in source code of the instruction at the
+     * specified index.
      */
-    void push_back(value_type &&instr) {instrs.emplace_back(std::move(instr));}
+    const Pos_t &pos(std::size_t i) const {return positions[i];}
+
+    /** Returns the position in source code of given instruction of this
+     * program.
+     */
+    const Pos_t &pos(const Instruction_t &instr) const {
+        return positions[static_cast<const value_type *>(&instr) - instrs.data()];
+    }
+
+    /** Returns the pool of constants referred by the instructions.
+     */
+    ConstantPool_t &pool() {return constants;}
 
     /** Appends new instruction at the end of the program.
      */
+    void push_back(const Pos_t &pos, value_type &&instr) {
+        positions.push_back(pos);
+        instrs.emplace_back(std::move(instr));
+    }
+
+    /** Appends new instruction at the end of the program. The instructions
+     * whose operands are stored in the constant pool get the pool as the
+     * first c'tor argument.
+     */
     template <typename Instr_t, typename... args_t>
-    void emplace_back(args_t &&...args) {
+    void emplace_back(const Pos_t &pos, args_t &&...args) {
         InstrType_t<Instr_t> type_tag; // c'tor explicit template param fixture
-        instrs.emplace_back(type_tag, std::forward<args_t>(args)...);
+        positions.push_back(pos);
+        try {
+            if constexpr (needs_pool<Instr_t, args_t...>)
+                instrs.emplace_back(type_tag, constants, std::forward<args_t>(args)...);
+            else instrs.emplace_back(type_tag, std::forward<args_t>(args)...);
+        } catch (...) {positions.pop_back(); throw;}
     }
 
     /** Pops the last instruction from the program.
      */
-    void pop_back() {instrs.pop_back();}
+    void pop_back() {
+        release(instrs.end() - 1, instrs.end());
+        instrs.pop_back();
+        positions.pop_back();
+    }
 
     /** Removes all instruction from given position.
      */
-    void erase(const_iterator ipos) {instrs.erase(ipos);}
+    void erase(const_iterator ipos) {
+        release(ipos, ipos + 1);
+        positions.erase(positions.begin() + (ipos - instrs.cbegin()));
+        instrs.erase(ipos);
+    }
+
+    /** Removes the instructions in given range from program. The following
+     * instructions are moved to the place of removed ones.
+     */
+    void erase(const_iterator first, const_iterator last) {
+        release(first, last);
+        positions.erase(
+            positions.begin() + (first - instrs.cbegin()),
+            positions.begin() + (last - instrs.cbegin())
+        );
+        instrs.erase(first, last);
+    }
+
+    /** The instructions that have been cut off the program together with
+     * their positions.
+     */
+    struct Code_t {
+        std::vector<value_type> instrs; //!< the instructions
+        std::vector<Pos_t> positions;   //!< the positions of instructions
+    };
+
+    /** Moves the instructions from given position out of the program. Unlike
+     * erase_from() it keeps their constants in the pool, so the code can be
+     * appended back to the program later.
+     */
+    Code_t cut_from(int64_t pos) {
+        Code_t code;
+        code.instrs.reserve(instrs.size() - pos);
+        for (auto i = instrs.begin() + pos; i != instrs.end(); ++i)
+            code.instrs.push_back(std::move(*i));
+        code.positions.assign(positions.begin() + pos, positions.end());
+        positions.erase(positions.begin() + pos, positions.end());
+        instrs.erase(instrs.begin() + pos, instrs.end());
+        return code;
+    }
+
+    /** Appends the code that has been cut off the program by cut_from().
+     */
+    void append(Code_t &&code) {
+        for (auto &instr: code.instrs)
+            instrs.push_back(std::move(instr));
+        positions.insert(
+            positions.end(),
+            code.positions.begin(),
+            code.positions.end()
+        );
+        code.instrs.clear();
+        code.positions.clear();
+    }
 
 protected:
+    /** Returns the literals of the instructions that are being removed back
+     * to the constant pool.
+     */
+    void release(const_iterator first, const_iterator last);
+
+    /** True if the instruction c'tor takes the constant pool.
+     */
+    template <typename Instr_t, typename... args_t>
+    static constexpr bool needs_pool
+        = std::is_constructible_v<Instr_t, ConstantPool_t &, args_t...>;
+
     SourceList_t sources;           //!< all source files for this program
     Error_t &error;                 //!< error logger
     std::vector<value_type> instrs; //!< list of program instructions
+    std::vector<Pos_t> positions;   //!< the positions of instructions
+    ConstantPool_t constants;       //!< the operands of instructions
+    std::size_t stack_depth;        //!< the maximal depth of value stack
+    Includes_t includes;            //!< where the sources are included
 };
 
 } // namespace Teng
@@ -82,7 +82,7 @@ void expr_diag_sentinel(Context_t *ctx, diag_code new_diag_code) {
 }
 
 void generate_val(Context_t *ctx, const Pos_t &pos, Value_t value) {
-    generate<Val_t>(ctx, std::move(value), pos);
+    generate<Val_t>(ctx, pos, std::move(value));
 }
 
 } // namespace Parser
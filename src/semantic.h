@@ -86,11 +86,15 @@ void expr_diag(Context_t *ctx, diag_code new_diag_code, bool pop = true);
  */
 void expr_diag_sentinel(Context_t *ctx, diag_code new_diag_code);
 
-/** Generates given instruction pass given args to instruction c'tor.
+/** Generates given instruction at given position in source code and pass
+ * given args to instruction c'tor.
  */
 template <typename Instr_t, typename Ctx_t, typename... Args_t>
-void generate(Ctx_t *ctx, Args_t &&...args) {
-    ctx->program->template emplace_back<Instr_t>(std::forward<Args_t>(args)...);
+void generate(Ctx_t *ctx, const Pos_t &pos, Args_t &&...args) {
+    ctx->program->template emplace_back<Instr_t>(
+        pos,
+        std::forward<Args_t>(args)...
+    );
 }
 
 } // namespace Parser
@@ -103,7 +103,7 @@ open_format(Context_t *ctx, const Pos_t &pos, const Options_t &opts) {
 
     // generate format instruction
     auto iopt = opts.find("space");
-    generate<OpenFormat_t>(ctx, resolve_mode_id(iopt), pos);
+    generate<OpenFormat_t>(ctx, pos, resolve_mode_id(iopt));
 }
 
 void open_inv_format(Context_t *ctx, const Pos_t &pos) {
@@ -126,7 +126,7 @@ void open_inv_format(Context_t *ctx, const Pos_t &pos) {
         break;
     }
     reset_error(ctx);
-    generate<OpenFormat_t>(ctx, Formatter_t::MODE_COPY_PREV, pos);
+    generate<OpenFormat_t>(ctx, pos, Formatter_t::MODE_COPY_PREV);
 }
 
 void close_format(Context_t *ctx, const Pos_t &pos) {
@@ -158,13 +158,13 @@ close_unclosed_format(Context_t *ctx, const Pos_t &pos, const Token_t &token) {
 void open_ctype(Context_t *ctx, const Pos_t &pos, const Literal_t &type) {
     // push new ctype instruction
     if (auto *desc = ContentType_t::find(type.value.string())) {
-        generate<OpenCType_t>(ctx, desc, pos);
+        generate<OpenCType_t>(ctx, pos, desc);
         ctx->escaper.push(desc->contentType.get());
         return;
     }
 
     // push invalid ctype
-    generate<OpenCType_t>(ctx, nullptr, pos);
+    generate<OpenCType_t>(ctx, pos, nullptr);
     ctx->escaper.push(nullptr);
 
     // log invalid conent type name
@@ -195,7 +195,7 @@ void open_inv_ctype(Context_t *ctx, const Pos_t &pos) {
         );
         break;
     }
-    generate<OpenCType_t>(ctx, nullptr, pos);
+    generate<OpenCType_t>(ctx, pos, nullptr);
     ctx->escaper.push(nullptr);
     reset_error(ctx);
 }
@@ -52,6 +52,96 @@
 
 namespace Teng {
 namespace Parser {
+namespace {
+
+/** Returns true if the case subject, whose code ends at the end of program,
+ * has been optimized to the single VAL instruction.
+ */
+bool is_const_subject(Context_t *ctx) {
+    auto &points = ctx->optimization_points;
+    if (points.empty() || !points.top().optimizable) return false;
+    auto addr = int64_t(ctx->program->size()) - 1;
+    return (points.top().addr == addr)
+        && ((*ctx->program)[addr].opcode() == OPCODE::VAL);
+}
+
+/** Compares the constant case subject with the case label in the same way
+ * as the processor does it. Returns undefined value if the comparison can't
+ * be evaluated at compile time.
+ */
+Value_t eval_case_label(Context_t *ctx, int64_t subject_addr, int64_t label_addr) {
+    auto &program = *ctx->program;
+    auto start = int64_t(program.size());
+    auto &subject = program[subject_addr].as<Val_t>();
+    generate<Val_t>(ctx, program.pos(subject_addr), *subject.value);
+    auto &label = program[label_addr].as<Val_t>();
+    generate<Val_t>(ctx, program.pos(label_addr), *label.value);
+    generate<EQ_t>(ctx, program.pos(label_addr));
+    auto result = ctx->coproc.eval(&ctx->open_frames, start);
+    program.erase_from(start);
+    return result;
+}
+
+/** Replaces the case expression with the body of the branch that is taken
+ * for the constant subject. The code of case, that ends at the end of
+ * program, is left untouched if some label can't be compared with the
+ * subject at compile time.
+ *
+ * 000 VAL                 <value=2>        (dropped)
+ * 001 PRG_STACK_PUSH                       (dropped)
+ * 002 PRG_STACK_AT        <index=0>        (dropped)
+ * 003 VAL                 <value=1>        (dropped)
+ * 004 EQ                                   (dropped)
+ * 005 JMP_IF_NOT          <jump=+2>        (dropped)
+ * 006 ...body...                           (dropped)
+ * 007 JMP                 <jump=+N>        (dropped)
+ * 008 PRG_STACK_AT        <index=0>        (dropped)
+ * 009 VAL                 <value=2>        (dropped)
+ * 010 EQ                                   (dropped)
+ * 011 JMP_IF_NOT          <jump=+2>        (dropped)
+ * 012 ...body...
+ * 013 JMP                 <jump=+N>        (dropped)
+ * 014 ...body...                           (dropped, default branch)
+ * 015 PRG_STACK_POP                        (dropped)
+ */
+void fold_case(Context_t *ctx, int64_t subject_addr) {
+    auto &program = *ctx->program;
+    auto &labels = ctx->case_option_addrs.top().stack;
+
+    // the labels of branch are ORed and the last one is followed by the jump
+    // to the next branch that is preceded by the jump to the end of case
+    int64_t first = subject_addr + 2;
+    int64_t last = int64_t(program.size()) - 1;
+    for (std::size_t i = 0; i < labels.size(); ++i) {
+        bool taken = false;
+        for (;; ++i) {
+            if (!taken) {
+                auto result = eval_case_label(ctx, subject_addr, labels[i]);
+                if (result.is_undefined()) return;
+                taken = bool(result);
+            }
+            auto opcode = program[labels[i] + 2].opcode();
+            if (opcode == OPCODE::JMP_IF_NOT) break;
+            if ((opcode != OPCODE::OR) || ((i + 1) == labels.size())) return;
+        }
+        auto jmp_addr = labels[i] + 2;
+        auto body_end = jmp_addr + program[jmp_addr].as<JmpIfNot_t>().addr_offset;
+        if (program[body_end].opcode() != OPCODE::JMP) return;
+        if (taken) {
+            first = jmp_addr + 1;
+            last = body_end;
+            break;
+        }
+        first = body_end + 1;
+    }
+
+    // remove the code from the end, so the addresses remain valid
+    DBG(std::cerr << "$$$$ case optimization" << std::endl);
+    program.erase(program.begin() + last, program.end());
+    program.erase(program.begin() + subject_addr, program.begin() + first);
+}
+
+} // namespace
 
 void prepare_case(Context_t *ctx) {
     expr_diag_sentinel(ctx, diag_code::case_cond);
@@ -60,6 +150,8 @@ void prepare_case(Context_t *ctx) {
 
 void prepare_case_cond(Context_t *ctx, const Token_t &token) {
     expr_diag(ctx, diag_code::case_option);
+    auto subject_addr = int64_t(ctx->program->size()) - 1;
+    ctx->case_subject_addrs.push(is_const_subject(ctx)? subject_addr: -1);
     generate<PrgStackPush_t>(ctx, token.pos);
 }
 
@@ -67,18 +159,18 @@ uint32_t generate_case_cmp(Context_t *ctx, Literal_t &literal) {
     // warn if there is more than one branch valid for same value
     for (auto addr: ctx->case_option_addrs.top()) {
         auto &instr = (*ctx->program)[addr].as<Val_t>();
-        if (instr.value == literal.value) {
+        if (*instr.value == literal.value) {
             auto val = literal.value.string();
-            logWarning(ctx, instr.pos(), "Duplicit case operand: " + val);
+            logWarning(ctx, ctx->program->pos(addr), "Duplicit case operand: " + val);
             logWarning(ctx, literal.pos, "Next seen here");
             break;
         }
     }
 
     // generate instructions
-    generate<PrgStackAt_t>(ctx, 0, literal.pos);
+    generate<PrgStackAt_t>(ctx, literal.pos, 0);
     ctx->case_option_addrs.top().push(ctx->program->size());
-    generate<Val_t>(ctx, std::move(literal.value), literal.pos);
+    generate<Val_t>(ctx, literal.pos, std::move(literal.value));
     generate<EQ_t>(ctx, literal.pos);
     return 0;
 }
@@ -88,7 +180,7 @@ void update_case_jmp(Context_t *ctx, const Token_t &token, uint32_t alts) {
     for (; alts; --alts) {
         auto addr = ctx->curr_branch_addrs().pop();
         auto &instr = (*ctx->program)[addr].as<Or_t>();
-        instr.addr_offset = ctx->program->size() - addr - 1;
+        instr.addr_offset = jump_offset(ctx->program->size() - addr - 1);
     }
     ctx->curr_branch_addrs().push(ctx->program->size());
     generate<JmpIfNot_t>(ctx, token.pos);
@@ -105,7 +197,7 @@ generate_case_next(Context_t *ctx, Literal_t &literal, uint32_t alts) {
 void finalize_case_branch(Context_t *ctx, const Token_t &token) {
     auto branch_case_addr = ctx->curr_branch_addrs().pop();
     auto &instr = (*ctx->program)[branch_case_addr].as<JmpIfNot_t>();
-    instr.addr_offset = ctx->program->size() - branch_case_addr;
+    instr.addr_offset = jump_offset(ctx->program->size() - branch_case_addr);
     ctx->curr_branch_addrs().push(ctx->program->size());
     generate<Jmp_t>(ctx, token.pos);
 }
@@ -115,14 +207,20 @@ NAryExpr_t finalize_case(Context_t *ctx, const Token_t &token, uint32_t arity) {
     for (auto tmp_arity = arity; --tmp_arity;) {
         auto branch_end_addr = ctx->curr_branch_addrs().pop();
         auto &instr = (*ctx->program)[branch_end_addr].as<Jmp_t>();
-        instr.addr_offset = ctx->program->size() - branch_end_addr - 1;
+        instr.addr_offset
+            = jump_offset(ctx->program->size() - branch_end_addr - 1);
     }
 
     // generate instruction that remove case value from prg stack
     generate<PrgStackPop_t>(ctx, token.pos);
 
-    // clear stored option addresses
+    // only the taken branch remains if the subject is constant
+    if (ctx->case_subject_addrs.top() >= 0)
+        fold_case(ctx, ctx->case_subject_addrs.top());
+
+    // clear stored option and subject addresses
     ctx->case_option_addrs.pop();
+    ctx->case_subject_addrs.pop();
 
     // clear case expr diagnostic code
     ctx->expr_diag.pop();
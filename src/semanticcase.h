@@ -140,6 +140,17 @@ void finalize_case_branch(Context_t *ctx, const Token_t &token);
  * Finally, the case condition value has to be pop out from value stack.
  *
  * 019 POP
+ *
+ * 6. Folding
+ *
+ * If the case condition has been optimized to the literal value, as in the
+ * example above, the labels are compared with it at compile time and the
+ * whole case expression is replaced with the body of the taken branch:
+ *
+ * 000 VAL                 <value='first'>
+ *
+ * The case expression is left as it is if some label comparison can't be
+ * evaluated at compile time.
  */
 NAryExpr_t
 finalize_case(Context_t *ctx, const Token_t &token, uint32_t arity);
@@ -42,6 +42,7 @@
 #include "instruction.h"
 #include "parsercontext.h"
 #include "semanticexpr.h"
+#include "semanticfrag.h"
 
 #ifdef DEBUG
 #include <iostream>
@@ -67,11 +68,11 @@ void generate_bin_op(Context_t *ctx, const Token_t &token) {
 template <typename Instr_t>
 void finalize_bin_op(Context_t *ctx) {
     auto bin_op_addr = ctx->branch_addrs.top().pop();
-    auto addr_offset = ctx->program->size() - bin_op_addr - 1;
+    auto addr_offset = jump_offset(ctx->program->size() - bin_op_addr - 1);
     (*ctx->program)[bin_op_addr].as<Instr_t>().addr_offset = addr_offset;
 
     // breaks invalid print optimization
-    generate<Noop_t>(ctx);
+    generate<Noop_t>(ctx, Pos_t());
 }
 
 } // namespace
@@ -111,7 +112,7 @@ void optimize_expr(Context_t *ctx, uint32_t arity, bool lazy_evaluated) {
         if (!result.is_undefined()) {
             // remove expression's program and replace it with its value
             DBG(std::cerr << "$$$$ optimized => " << result << std::endl);
-            auto pos = (*ctx->program)[args_point].pos();
+            auto pos = ctx->program->pos(args_point);
             ctx->program->erase_from(args_point);
             generate_val(ctx, pos, std::move(result));
 
@@ -137,7 +138,7 @@ void discard_expr(Context_t *ctx) {
 
     // discard whole expression code and replace it with undefined
     ctx->program->erase_from(ctx->expr_start_point.addr);
-    generate<Val_t>(ctx, Value_t(), ctx->expr_start_point.pos);
+    generate<Val_t>(ctx, ctx->expr_start_point.pos, Value_t());
 
     // if there is diagnostics then process it
     ctx->expr_diag.unwind(ctx, ctx->unexpected_token);
@@ -165,6 +166,7 @@ void finish_expr(Context_t *ctx) {
     ctx->expr_start_point.update_allowed = true;
     ctx->expr_diag.clear();
     ctx->branch_addrs.pop();
+    hoist_invariant_expr(ctx);
 }
 
 void prepare_expr(Context_t *ctx, const Pos_t &) {
@@ -178,13 +180,13 @@ uint32_t generate_str_expr(Context_t *ctx, const Token_t &token, bool negate) {
     if (!ctx->program->empty()) {
         auto &instr = ctx->program->back();
         if (instr.opcode() == OPCODE::VAL) {
-            auto &value = instr.as<Val_t>().value;
+            auto &value = *instr.as<Val_t>().value;
             if (value.is_regex()) {
                 if (!value.as_regex().unique())
                     throw std::runtime_error(__PRETTY_FUNCTION__);
                 auto regex = std::move(value.as_regex());
                 ctx->program->pop_back();
-                generate<MatchRegex_t>(ctx, std::move(regex), token.pos);
+                generate<MatchRegex_t>(ctx, token.pos, std::move(regex));
                 ctx->optimization_points.pop();
                 if (negate)
                     generate<Not_t>(ctx, token.pos);
@@ -36,9 +36,12 @@
  *             Moved from syntax.yy.
  */
 
+#include <vector>
+
 #include "syntax.hh"
 #include "logging.h"
 #include "program.h"
+#include "function.h"
 #include "instruction.h"
 #include "parsercontext.h"
 #include "configuration.h"
@@ -61,7 +64,7 @@ namespace {
 void open_frag(Context_t *ctx, const Token_t &token, const Pos_t &pos) {
     (token == LEX2::BUILTIN_ERROR) && ctx->params->isErrorFragmentEnabled()
         ? generate<OpenErrorFrag_t>(ctx, pos)
-        : generate<OpenFrag_t>(ctx, token.view().str(), pos);
+        : generate<OpenFrag_t>(ctx, pos, token.view().str());
 }
 
 /** Casts given instruction to OPEN_FRAG instruction.
@@ -77,6 +80,269 @@ OpenFrag_t &open_frag_cast(Instruction_t &instr) {
     }
 }
 
+/** Returns true if the instruction of expression yields the same value in
+ * each iteration of the innermost open frag. The frag and frame offsets of
+ * instructions are relative to that frag. The runtime variables aren't
+ * hoisted because they report the missing values in each iteration.
+ */
+bool is_invariant_instr(const Instruction_t &instr) {
+    auto is_outer = [] (const auto &instr) {
+        return instr.frame_offset || instr.frag_offset;
+    };
+    switch (instr.opcode()) {
+    case OPCODE::VAR:
+        return is_outer(instr.as<Var_t>());
+    case OPCODE::PUSH_FRAG_INDEX:
+        return is_outer(instr.as<PushFragIndex_t>());
+    case OPCODE::PUSH_FRAG_FIRST:
+        return is_outer(instr.as<PushFragFirst_t>());
+    case OPCODE::PUSH_FRAG_LAST:
+        return is_outer(instr.as<PushFragLast_t>());
+    case OPCODE::PUSH_FRAG_INNER:
+        return is_outer(instr.as<PushFragInner_t>());
+    case OPCODE::FUNC:
+        return !instr.as<Func_t>().is_udf
+            && isInvariantFunction(*instr.as<Func_t>().name);
+    case OPCODE::VAL:
+    case OPCODE::DICT:
+    case OPCODE::PRG_STACK_PUSH:
+    case OPCODE::PRG_STACK_POP:
+    case OPCODE::PRG_STACK_AT:
+    case OPCODE::UNARY_PLUS:
+    case OPCODE::UNARY_MINUS:
+    case OPCODE::PLUS:
+    case OPCODE::MINUS:
+    case OPCODE::MUL:
+    case OPCODE::DIV:
+    case OPCODE::MOD:
+    case OPCODE::BIT_AND:
+    case OPCODE::BIT_XOR:
+    case OPCODE::BIT_OR:
+    case OPCODE::BIT_NOT:
+    case OPCODE::AND:
+    case OPCODE::OR:
+    case OPCODE::NOT:
+    case OPCODE::EQ:
+    case OPCODE::NE:
+    case OPCODE::GE:
+    case OPCODE::GT:
+    case OPCODE::LE:
+    case OPCODE::LT:
+    case OPCODE::REPEAT:
+    case OPCODE::CONCAT:
+    case OPCODE::STR_EQ:
+    case OPCODE::STR_NE:
+    case OPCODE::JMP_IF_NOT:
+    case OPCODE::JMP:
+    case OPCODE::PUSH_FRAG_COUNT:
+    case OPCODE::REPR:
+    case OPCODE::QUERY_REPR:
+    case OPCODE::QUERY_COUNT:
+    case OPCODE::QUERY_TYPE:
+    case OPCODE::QUERY_DEFINED:
+    case OPCODE::QUERY_EXISTS:
+    case OPCODE::ISEMPTY:
+    case OPCODE::ISUNDEFINED:
+    case OPCODE::ISINTEGRAL:
+    case OPCODE::ISREAL:
+    case OPCODE::ISSTRING:
+    case OPCODE::ISFRAG:
+    case OPCODE::ISFRAGLIST:
+    case OPCODE::ISREGEX:
+    case OPCODE::MATCH_REGEX:
+    case OPCODE::LOG_SUPPRESS:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/** Returns pointer to the relative jump offset of instruction or nullptr if
+ * instruction doesn't jump.
+ */
+int32_t *jump_offset_operand(Instruction_t &instr) {
+    switch (instr.opcode()) {
+    case OPCODE::AND:
+        return &instr.as<And_t>().addr_offset;
+    case OPCODE::OR:
+        return &instr.as<Or_t>().addr_offset;
+    case OPCODE::JMP_IF_NOT:
+        return &instr.as<JmpIfNot_t>().addr_offset;
+    case OPCODE::JMP:
+        return &instr.as<Jmp_t>().addr_offset;
+    case OPCODE::OPEN_FRAG:
+    case OPCODE::OPEN_ERROR_FRAG:
+        return &open_frag_cast(instr).close_frag_offset;
+    case OPCODE::CLOSE_FRAG:
+        return &instr.as<CloseFrag_t>().open_frag_offset;
+    default:
+        return nullptr;
+    }
+}
+
+/** Calls the callback for each instruction of frag body that doesn't belong
+ * to some nested frag. The callback gets the index of instruction and the
+ * number of values pushed on program stack by the enclosing case
+ * expressions.
+ */
+template <typename Callback_t>
+void for_each_body_instr(const Program_t::Code_t &body, Callback_t callback) {
+    std::size_t depth = 0;
+    for (std::size_t i = 0; i < body.instrs.size(); ++i) {
+        auto &instr = body.instrs[i];
+        callback(i, depth);
+        switch (instr.opcode()) {
+        case OPCODE::OPEN_FRAG:
+            i += instr.as<OpenFrag_t>().close_frag_offset;
+            break;
+        case OPCODE::OPEN_ERROR_FRAG:
+            i += instr.as<OpenErrorFrag_t>().close_frag_offset;
+            break;
+        case OPCODE::PRG_STACK_PUSH:
+            ++depth;
+            break;
+        case OPCODE::PRG_STACK_POP:
+            --depth;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/** Returns true if the frag body can't change the values of the hoisted
+ * expressions. It can't change the content type, that is used for escaping,
+ * nor set the variables of the outer frags.
+ */
+bool is_hoisting_safe(const Program_t::Code_t &body) {
+    // frame depth and depth of nested frags in the frame of hoisting frag
+    uint64_t frames = 0;
+    uint64_t frags = 0;
+    for (auto &instr: body.instrs) {
+        switch (instr.opcode()) {
+        case OPCODE::OPEN_CTYPE:
+        case OPCODE::CLOSE_CTYPE:
+            return false;
+        case OPCODE::OPEN_FRAME:
+            ++frames;
+            break;
+        case OPCODE::CLOSE_FRAME:
+            --frames;
+            break;
+        case OPCODE::OPEN_FRAG:
+        case OPCODE::OPEN_ERROR_FRAG:
+            if (!frames) ++frags;
+            break;
+        case OPCODE::CLOSE_FRAG:
+            if (!frames) --frags;
+            break;
+        case OPCODE::SET: {
+            // the variables of hoisting frag and nested frags can be set
+            auto &set = instr.as<Set_t>();
+            if (set.frame_offset < frames) break;
+            if (!frames && !set.frame_offset && (set.frag_offset <= frags))
+                break;
+            return false;
+        }
+        default:
+            break;
+        }
+    }
+    return true;
+}
+
+/** Appends the frag body, that has been cut off the program at given
+ * address, back to the program. If the exprs are given then the values of
+ * hoisted expressions are replaced with the expressions again. The jumps and
+ * calls are relocated to the new addresses of the body instructions.
+ */
+void append_frag_body(
+    Context_t *ctx,
+    int64_t body_addr,
+    Program_t::Code_t &&body,
+    std::vector<Program_t::Code_t> *exprs
+) {
+    // find the instructions that push the values of hoisted expressions
+    std::vector<bool> hoisted(body.instrs.size(), false);
+    if (exprs) {
+        for_each_body_instr(body, [&] (std::size_t i, std::size_t depth) {
+            if (!depth && (body.instrs[i].opcode() == OPCODE::PRG_STACK_AT))
+                hoisted[i] = true;
+        });
+    }
+
+    // append the body and remember the new addresses of its instructions
+    auto &program = *ctx->program;
+    std::vector<int64_t> addrs(body.instrs.size() + 1);
+    for (std::size_t i = 0; i < body.instrs.size(); ++i) {
+        addrs[i] = program.size();
+        if (hoisted[i]) {
+            auto index = body.instrs[i].as<PrgStackAt_t>().index;
+            program.append(std::move((*exprs)[index]));
+        } else program.push_back(body.positions[i], std::move(body.instrs[i]));
+    }
+    addrs.back() = program.size();
+
+    // the jumps out of the body are kept
+    auto relocate = [&] (int64_t addr) {
+        auto i = addr - body_addr;
+        return (i >= 0) && (i < int64_t(addrs.size())) ? addrs[i] : addr;
+    };
+
+    // the processor increments the ip after each jump
+    for (std::size_t i = 0; i < body.instrs.size(); ++i) {
+        if (hoisted[i]) continue;
+        auto &instr = program[addrs[i]];
+        if (auto *offset = jump_offset_operand(instr)) {
+            auto addr = relocate(body_addr + int64_t(i) + *offset + 1);
+            *offset = jump_offset(addr - addrs[i] - 1);
+        } else if (instr.opcode() == OPCODE::CALL) {
+            auto &call = instr.as<Call_t>();
+            call.addr = jump_offset(relocate(call.addr));
+        }
+    }
+}
+
+/** The values of expressions hoisted out of the frag body.
+ */
+struct hoisted_values_t {
+    int64_t body_addr; //!< the address of the first frag body instruction
+    std::size_t count; //!< the number of values pushed on program stack
+};
+
+/** Places the code of expressions hoisted out of the frag body between the
+ * OPEN_FRAG instruction and the frag body, so they are evaluated once before
+ * the first iteration and their values are pushed on program stack. If the
+ * frag body could change the values the expressions are put back to their
+ * places.
+ */
+hoisted_values_t place_hoisted_exprs(Context_t *ctx, const FragRec_t &frag) {
+    auto body_addr = frag.addr + 1;
+    auto &hoisted_exprs = ctx->hoisted_exprs;
+    if (hoisted_exprs.empty() || (hoisted_exprs.back().frag_addr != frag.addr))
+        return {body_addr, 0};
+    auto exprs = std::move(hoisted_exprs.back().exprs);
+    hoisted_exprs.pop_back();
+
+    // cut the body off and append it back behind the hoisted expressions
+    auto &program = *ctx->program;
+    auto body = program.cut_from(body_addr);
+    if (!is_hoisting_safe(body)) {
+        append_frag_body(ctx, body_addr, std::move(body), &exprs);
+        return {body_addr, 0};
+    }
+
+    // the value of i-th expression has to be i-th from top of program stack
+    for (auto i = exprs.size(); i-- > 0;) {
+        auto pos = exprs[i].positions.front();
+        program.append(std::move(exprs[i]));
+        generate<PrgStackPush_t>(ctx, pos);
+    }
+    hoisted_values_t result = {int64_t(program.size()), exprs.size()};
+    append_frag_body(ctx, body_addr, std::move(body), nullptr);
+    return result;
+}
+
 } // namespace
 
 void open_frag(Context_t *ctx, const Pos_t &pos, Variable_t &frag) {
@@ -89,7 +355,7 @@ void open_frag(Context_t *ctx, const Pos_t &pos, Variable_t &frag) {
             "Empty fragment identifier; discarding fragment block content"
         );
         ctx->open_frames.top().open_frag({}, ctx->program->size(), false);
-        generate<OpenFrag_t>(ctx, std::string(), pos);
+        generate<OpenFrag_t>(ctx, pos, std::string());
         return;
     }
 
@@ -140,7 +406,7 @@ void open_inv_frag(Context_t *ctx, const Pos_t &pos) {
     // if symbol is invalid then create frag instruction with empty name that
     // is used as marker for close_frag() function to discard frag content
     ctx->open_frames.top().open_frag({}, ctx->program->size(), false);
-    generate<OpenFrag_t>(ctx, "", ctx->unexpected_token.pos);
+    generate<OpenFrag_t>(ctx, ctx->unexpected_token.pos, "");
     reset_error(ctx);
 }
 
@@ -150,20 +416,32 @@ void close_frag(Context_t *ctx, const Pos_t &pos, bool invalid) {
         // close fragment
         auto frag = ctx->open_frames.top().close_frag();
 
-        // create end-frag instruction and take fragment subprogram length
+        // the hoisted expressions are evaluated before the first iteration
+        auto hoisted_values = place_hoisted_exprs(ctx, frag);
+
+        // create end-frag instruction
         generate<CloseFrag_t>(ctx, pos);
+        int64_t close_frag_addr = ctx->program->size() - 1;
+
+        // pop the values of hoisted expressions after the last iteration and
+        // take fragment subprogram length
+        for (auto i = 0lu; i < hoisted_values.count; ++i)
+            generate<PrgStackPop_t>(ctx, pos);
         auto frag_routine_length = ctx->program->size() - frag.addr - 1;
 
         // take references to instructions after push_back that invalidates them
         auto &open_frag_instr = open_frag_cast((*ctx->program)[frag.addr]);
-        auto &close_frag_instr = ctx->program->back().as<CloseFrag_t>();
+        auto &close_frag_instr
+            = (*ctx->program)[close_frag_addr].as<CloseFrag_t>();
 
-        // open frag instr contains offset of close frag instr and vice versa
-        open_frag_instr.close_frag_offset = frag_routine_length;
-        close_frag_instr.open_frag_offset = -frag_routine_length;
+        // open frag instr contains offset of the end of frag subprogram and
+        // close frag instr contains offset of the frag body start
+        open_frag_instr.close_frag_offset = jump_offset(frag_routine_length);
+        close_frag_instr.open_frag_offset
+            = jump_offset(hoisted_values.body_addr - close_frag_addr - 1);
 
         // if fragment has invalid name discard all code up to open instruction
-        if (invalid || frag.name().empty() || open_frag_instr.name.empty())
+        if (invalid || frag.name().empty() || open_frag_instr.name->empty())
             ctx->program->erase_from(frag.addr);
 
         // close frame if is empty
@@ -203,6 +481,46 @@ close_unclosed_frag(Context_t *ctx, const Pos_t &pos, const Token_t &token) {
     reset_error(ctx);
 }
 
+void hoist_invariant_expr(Context_t *ctx) {
+    // the expressions are hoisted out of the innermost open frag only
+    auto &frame = ctx->open_frames.top();
+    if (frame.empty()) return;
+    auto &frag = frame[frame.size() - 1];
+    if (frag.name().empty()) return;
+
+    // the expression has to be evaluated in each iteration, so it can't be
+    // in any if statement of the frag body, but it can be the condition of
+    // the if statement directly in the frag body; the program stack mustn't
+    // contain the return address of subroutine (block) when its value is read
+    auto start = ctx->expr_start_point.addr;
+    if (start <= frag.addr) return;
+    auto &ifs = ctx->if_start_points;
+    std::size_t i = (!ifs.empty() && (ifs.top().addr == start))? 1: 0;
+    if ((i < ifs.size()) && (ifs.below_top(i).addr > frag.addr)) return;
+    if (ctx->extends_block.is_override_block_open()) return;
+    if (ctx->extends_block.super_addr >= 0) return;
+
+    // the value of single instruction is got as fast as the hoisted value
+    auto &program = *ctx->program;
+    if ((int64_t(program.size()) - start) < 2) return;
+
+    // the VAR instruction escapes the value if it is followed by PRINT (when
+    // print escaping is disabled), so it has to stay the last instruction
+    if (program[program.size() - 1].opcode() == OPCODE::VAR) return;
+    for (auto i = start; i < int64_t(program.size()); ++i)
+        if (!is_invariant_instr(program[i]))
+            return;
+
+    // replace the expression with its value kept on program stack
+    auto &hoisted_exprs = ctx->hoisted_exprs;
+    if (hoisted_exprs.empty() || (hoisted_exprs.back().frag_addr != frag.addr))
+        hoisted_exprs.push_back({frag.addr, {}});
+    auto &exprs = hoisted_exprs.back().exprs;
+    auto pos = program.pos(start);
+    exprs.push_back(program.cut_from(start));
+    generate<PrgStackAt_t>(ctx, pos, exprs.size() - 1);
+}
+
 void debug_frag(Context_t *ctx, const Pos_t &pos, bool warn) {
     generate<DebugFrag_t>(ctx, pos);
     if (warn) {
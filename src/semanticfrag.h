@@ -67,6 +67,13 @@ void close_inv_frag(Context_t *ctx, const Pos_t &pos);
 void
 close_unclosed_frag(Context_t *ctx, const Pos_t &pos, const Token_t &token);
 
+/** If the just finished expression yields the same value in each iteration
+ * of the innermost open frag then its code is moved out of the frag body and
+ * it is replaced with its value that is computed once before the first
+ * iteration (see close_frag()).
+ */
+void hoist_invariant_expr(Context_t *ctx);
+
 /** Generates code implementing debug fragment.
  */
 void debug_frag(Context_t *ctx, const Pos_t &pos, bool warn = false);
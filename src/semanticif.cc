@@ -41,7 +41,9 @@
 #include "syntax.hh"
 #include "program.h"
 #include "logging.h"
+#include "peephole.h"
 #include "parsercontext.h"
+#include "semanticprint.h"
 #include "semanticif.h"
 
 #ifdef DEBUG
@@ -59,19 +61,19 @@ namespace {
  * program.
  */
 void finalize_if_branch(Context_t *ctx, int32_t shift) {
-    // TODO(burlog): optimalize if
-
     // calculate real jump address for last elif/else branch
     auto branch_addr = ctx->curr_branch_addrs().pop();
     switch ((*ctx->program)[branch_addr].opcode()) {
     case OPCODE::JMP: {        // else branch
         auto &instr = (*ctx->program)[branch_addr].as<Jmp_t>();
-        instr.addr_offset = ctx->program->size() - branch_addr - shift;
+        instr.addr_offset
+            = jump_offset(ctx->program->size() - branch_addr - shift);
         break;
     }
     case OPCODE::JMP_IF_NOT: { // elif branch
         auto &instr = (*ctx->program)[branch_addr].as<JmpIfNot_t>();
-        instr.addr_offset = ctx->program->size() - branch_addr - shift;
+        instr.addr_offset
+            = jump_offset(ctx->program->size() - branch_addr - shift);
         break;
     }
     default:
@@ -79,6 +81,162 @@ void finalize_if_branch(Context_t *ctx, int32_t shift) {
     }
 }
 
+/** How the if statement branch is taken.
+ */
+enum class branch_t {always, never, runtime};
+
+/** Returns always/never if the branch condition has been optimized to
+ * constant value or runtime if it's evaluated by the processor.
+ */
+branch_t branch_kind(Context_t *ctx, const Context_t::if_branch_t &branch) {
+    // the else branch
+    if (branch.cond_addr < 0)
+        return branch_t::always;
+
+    // the condition has to be the single VAL instruction followed by JMP_IF_NOT
+    if ((branch.body_addr - branch.cond_addr) != 2)
+        return branch_t::runtime;
+    auto &instr = (*ctx->program)[branch.cond_addr];
+    if (instr.opcode() != OPCODE::VAL)
+        return branch_t::runtime;
+    return *instr.as<Val_t>().value? branch_t::always: branch_t::never;
+}
+
+/** Removes instructions in range [first, last) from program.
+ */
+void erase_instrs(Context_t *ctx, int64_t first, int64_t last) {
+    auto begin = ctx->program->begin();
+    ctx->program->erase(begin + first, begin + last);
+}
+
+/** Returns true if the if statement can be rebuilt. The subroutines of
+ * blocks use absolute addresses so they can't be moved, and the disordered
+ * branches are discarded anyway.
+ */
+bool is_if_stmnt_foldable(Context_t *ctx, int64_t start, int64_t end) {
+    for (auto addr = start; addr < end; ++addr) {
+        switch ((*ctx->program)[addr].opcode()) {
+        case OPCODE::CALL:
+        case OPCODE::RETURN:
+            return false;
+        default:
+            break;
+        }
+    }
+    auto &branches = ctx->if_branches.top();
+    for (std::size_t i = 0; i < branches.size(); ++i) {
+        if (branches[i].body_addr < 0) return false;
+        if ((branches[i].cond_addr < 0) && ((i + 1) != branches.size()))
+            return false;
+    }
+    return true;
+}
+
+/** Removes the branches whose conditions have been optimized to false
+ * value and the branches following the first branch whose condition has
+ * been optimized to true value. Returns true if no branch condition remains
+ * so the if statement has been replaced with the body of one branch or
+ * with nothing.
+ *
+ * 000 VAL          <value=0>       (dropped)
+ * 001 JMP_IF_NOT   <jump=+2>       (dropped)
+ * 002 ...body...                   (dropped)
+ * 003 JMP          <jump=+N>       (dropped)
+ * 004 VAR          <name=var>
+ * 005 JMP_IF_NOT   <jump=+2>
+ * 006 ...body...
+ * 007 JMP          <jump=+N>       (shortened)
+ * 008 VAL          <value=1>       (dropped)
+ * 009 JMP_IF_NOT   <jump=+2>       (dropped)
+ * 010 ...body...
+ * 011 JMP          <jump=+1>       (dropped)
+ * 012 ...body...                   (dropped, else branch)
+ */
+bool fold_if_stmnt(Context_t *ctx) {
+    auto &branches = ctx->if_branches.top();
+    int64_t start = ctx->curr_if_start_point().addr;
+    int64_t end = ctx->program->size();
+    if (!is_if_stmnt_foldable(ctx, start, end))
+        return false;
+
+    // the body of branch ends with the jump to the end of if statement
+    auto body_end = [&] (std::size_t i) {
+        if (++i == branches.size()) return end;
+        return (branches[i].cond_addr < 0
+                ? branches[i].body_addr
+                : branches[i].cond_addr) - 1;
+    };
+
+    // the branches following the always taken branch are never taken
+    std::vector<branch_t> kinds;
+    for (auto &branch: branches) {
+        kinds.push_back(branch_kind(ctx, branch));
+        if (kinds.back() == branch_t::always) break;
+    }
+
+    // remove the code from the end, so the branch addresses remain valid
+    // and the jumps to the end of if statement can be shortened
+    bool resolved = true;
+    int64_t removed = 0;
+    auto remove = [&] (int64_t first, int64_t last) {
+        erase_instrs(ctx, first, last);
+        removed += last - first;
+    };
+    if (kinds.size() < branches.size())
+        remove(body_end(kinds.size() - 1), end);
+    for (auto i = kinds.size(); i-- > 0;) {
+        auto &branch = branches[i];
+        switch (kinds[i]) {
+        case branch_t::always:
+            if (branch.cond_addr >= 0)
+                remove(branch.cond_addr, branch.body_addr);
+            break;
+        case branch_t::never:
+            if ((i + 1) < kinds.size())
+                remove(branch.cond_addr, body_end(i) + 1);
+            else remove(branch.cond_addr, ctx->program->size());
+            break;
+        case branch_t::runtime:
+            if ((i + 1) < branches.size()) {
+                auto &instr = (*ctx->program)[body_end(i)].as<Jmp_t>();
+                instr.addr_offset = jump_offset(instr.addr_offset - removed);
+            }
+            resolved = false;
+            break;
+        }
+    }
+    return resolved;
+}
+
+/** Joins the first print of the body that has replaced the if statement
+ * with the print preceding the if statement.
+ */
+void join_if_stmnt_prints(Context_t *ctx, int64_t start) {
+    auto &program = *ctx->program;
+    if ((start < 2) || ((start + 2) > int64_t(program.size())))
+        return;
+
+    // the VAL, PRINT, VAL, PRINT sequence is required
+    if (program[start - 2].opcode() != OPCODE::VAL) return;
+    if (program[start - 1].opcode() != OPCODE::PRINT) return;
+    if (program[start].opcode() != OPCODE::VAL) return;
+    if (program[start + 1].opcode() != OPCODE::PRINT) return;
+
+    // check if prints can be optimized out
+    auto &second_print = program[start + 1].as<Print_t>();
+    if (program[start - 1].as<Print_t>().unoptimizable) return;
+    if (second_print.unoptimizable) return;
+
+    // the joined instructions can't be jumped onto
+    auto targets = jump_targets(program);
+    for (auto addr = start - 1; addr < (start + 2); ++addr)
+        if (targets[addr]) return;
+
+    DBG(std::cerr << "$$$$ if statement print optimization" << std::endl);
+    join_prints(ctx, start - 2, start, second_print.print_escape);
+    erase_instrs(ctx, start, start + 2);
+}
+
 } // namespace
 
 void prepare_if_stmnt(Context_t *ctx, const Pos_t &pos) {
@@ -89,18 +247,21 @@ void prepare_if_stmnt(Context_t *ctx, const Pos_t &pos) {
     auto prgsize = static_cast<int64_t>(ctx->program->size());
     ctx->branch_addrs.push();
     ctx->if_start_points.push({pos, prgsize, true});
+    ctx->if_branches.push({{prgsize, -1}});
 }
 
 void finalize_if_stmnt(Context_t *ctx) {
     // @see prepare_if_stmnt note
     ctx->branch_addrs.pop();
     ctx->if_start_points.pop();
+    ctx->if_branches.pop();
 }
 
 void generate_if(Context_t *ctx, const Token_t &token, bool valid_expr) {
     // generate if condition
     ctx->curr_branch_addrs().push(ctx->program->size());
     generate<JmpIfNot_t>(ctx, token.pos);
+    ctx->if_branches.top().back().body_addr = ctx->program->size();
 
     // warn about invalid expression
     if (!valid_expr) {
@@ -133,11 +294,19 @@ void generate_endif(Context_t *ctx, const Pos_t *inv_pos) {
     while (!ctx->curr_branch_addrs().empty()) {
         auto branch_addr = ctx->curr_branch_addrs().pop();
         auto &instr = (*ctx->program)[branch_addr].as<Jmp_t>();
-        instr.addr_offset = ctx->program->size() - branch_addr - 1;
+        instr.addr_offset = jump_offset(ctx->program->size() - branch_addr - 1);
     }
 
+    // remove the branches that can't be taken
+    if (fold_if_stmnt(ctx)) {
+        // the conditions are gone, so nothing refers into the remaining code
+        auto start = ctx->curr_if_start_point().addr;
+        if (ctx->expr_start_point.addr >= start)
+            ctx->expr_start_point.addr = -1;
+        join_if_stmnt_prints(ctx, start);
+
     // break possible invalid print optimization
-    generate<Noop_t>(ctx);
+    } else generate<Noop_t>(ctx, Pos_t());
 
     // warn if there is invalid tokens
     if (inv_pos) {
@@ -157,6 +326,7 @@ void generate_else(Context_t *ctx, const Token_t &token, bool invalid) {
     // insert branch end jump
     ctx->curr_branch_addrs().push(ctx->program->size());
     generate<Jmp_t>(ctx, token.pos);
+    ctx->if_branches.top().push_back({-1, int64_t(ctx->program->size())});
 
     // warn if there is invalid tokens
     if (invalid) {
@@ -173,6 +343,7 @@ void prepare_elif(Context_t *ctx, const Token_t &token) {
     finalize_if_branch(ctx, 0);
     ctx->curr_branch_addrs().push(ctx->program->size());
     generate<Jmp_t>(ctx, token.pos);
+    ctx->if_branches.top().push_back({int64_t(ctx->program->size()), -1});
 }
 
 void finalize_inv_if_stmnt(Context_t *ctx, const Token_t &token) {
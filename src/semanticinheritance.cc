@@ -76,7 +76,7 @@ void generate_overrides(
 ) {
     // update super jump
     auto &instr = (*ctx->program)[ioverride->addr].as<Jmp_t>();
-    instr.addr_offset = ctx->program->size() - ioverride->addr - 1;
+    instr.addr_offset = jump_offset(ctx->program->size() - ioverride->addr - 1);
 
     // save current super addr, it's used for implementing super()
     ctx->extends_block.super_addr = ioverride->addr;
@@ -87,7 +87,7 @@ void generate_overrides(
         // we are leaving overrides code, so calling super() makes no sense
         ctx->extends_block.super_addr = -1;
         // generates call of the first override
-        generate<Call_t>(ctx, name, ioverride->addr, ioverride->pos);
+        generate<Call_t>(ctx, ioverride->pos, name, ioverride->addr);
         return;
     }
 
@@ -300,7 +300,7 @@ void call_super_block(Context_t *ctx, const Token_t &super_block) {
 
     // generate instructions calling super implementation
     auto super_addr = ctx->extends_block.super_addr;
-    generate<Call_t>(ctx, "super", super_addr, super_block.pos);
+    generate<Call_t>(ctx, super_block.pos, "super", super_addr);
 }
 
 void ignore_free_override(Context_t *ctx, const Token_t &token) {
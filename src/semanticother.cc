@@ -143,7 +143,7 @@ uint32_t generate_func(Context_t *ctx, const Token_t &name, uint32_t nargs) {
 
     // regular function
     bool is_udf = name.token_id == LEX2::UDF_IDENT;
-    generate<Func_t>(ctx, name.str(), nargs, name.pos, is_udf);
+    generate<Func_t>(ctx, name.pos, name.str(), nargs, is_udf);
     return nargs;
 }
 
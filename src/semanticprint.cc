@@ -95,35 +95,47 @@ void generate_print(Context_t *ctx, bool print_escape) {
 
     // underflow protect -> no optimalization can be peformed for now
     if (prgsize < 3)
-        return generate<Print_t>(ctx, print_escape, ctx->pos());
+        return generate<Print_t>(ctx, ctx->pos(), print_escape);
 
     // check whether there is no references to vanishing code
     if (are_instrs_protected(ctx, prgsize - 3))
-        return generate<Print_t>(ctx, print_escape, ctx->pos());
+        return generate<Print_t>(ctx, ctx->pos(), print_escape);
 
     // attempt to optimize consecutive print instrs to one merged
     if ((*ctx->program)[prgsize - 1].opcode() != OPCODE::VAL)
-        return generate<Print_t>(ctx, print_escape, ctx->pos());
+        return generate<Print_t>(ctx, ctx->pos(), print_escape);
     if ((*ctx->program)[prgsize - 2].opcode() != OPCODE::PRINT)
-        return generate<Print_t>(ctx, print_escape, ctx->pos());
+        return generate<Print_t>(ctx, ctx->pos(), print_escape);
     if ((*ctx->program)[prgsize - 3].opcode() != OPCODE::VAL)
-        return generate<Print_t>(ctx, print_escape, ctx->pos());
+        return generate<Print_t>(ctx, ctx->pos(), print_escape);
 
     // TODO(burlog): can this replace are_instrs_protected and NOOP insertions?
 
     // check if print can be optimized out
     if ((*ctx->program)[prgsize - 2].as<Print_t>().unoptimizable)
-        return generate<Print_t>(ctx, print_escape, ctx->pos());
+        return generate<Print_t>(ctx, ctx->pos(), print_escape);
 
     DBG(std::cerr << "$$$$ print optimization" << std::endl);
 
     // optimalize sequence of VAL, PRINT, VAL, PRINT to single VAL, PRINT pair
-    auto &first_val = (*ctx->program)[prgsize - 3].as<Val_t>().value;
-    auto &second_val = (*ctx->program)[prgsize - 1].as<Val_t>().value;
+    join_prints(ctx, prgsize - 3, prgsize - 1, print_escape);
+
+    // delete last VAL instruction (optimized out)
+    ctx->program->pop_back();
+}
+
+void join_prints(
+    Context_t *ctx,
+    int64_t first_addr,
+    int64_t second_addr,
+    bool print_escape
+) {
+    auto &first_val = *(*ctx->program)[first_addr].as<Val_t>().value;
+    auto &second_val = *(*ctx->program)[second_addr].as<Val_t>().value;
 
     // if print escaping is enabled we have to respect print escaping flag
     if (ctx->params->isPrintEscapeEnabled()) {
-        auto &print_instr = (*ctx->program)[prgsize - 2].as<Print_t>();
+        auto &print_instr = (*ctx->program)[first_addr + 1].as<Print_t>();
         auto esc = [&] (auto &&v) {return ctx->escaper.escape(v);};
         switch (int(print_escape) - int(print_instr.print_escape)) {
         case 0:  // (true - true) || (false - false)
@@ -149,19 +161,16 @@ void generate_print(Context_t *ctx, bool print_escape) {
 
     // or if it is disabled then we can directly join values
     } else first_val.append_str(second_val);
-
-    // delete last VAL instruction (optimized out)
-    ctx->program->pop_back();
 }
 
 void generate_dict_lookup(Context_t *ctx, const Token_t &token) {
     // find item in dictionary
     if (auto *item = ctx->dict->lookup(token.view()))
-        return generate<Val_t>(ctx, *item, token.pos);
+        return generate<Val_t>(ctx, token.pos, *item);
 
     // find item in param/config dictionary
     if (auto *item = ctx->params->lookup(token.view()))
-        return generate<Val_t>(ctx, *item, token.pos);
+        return generate<Val_t>(ctx, token.pos, *item);
 
     // use ident as result value
     logWarning(
@@ -169,7 +178,7 @@ void generate_dict_lookup(Context_t *ctx, const Token_t &token) {
         token.pos,
         "Dictionary item '" + token.view() + "' was not found"
     );
-    generate<Val_t>(ctx, token.str(), token.pos);
+    generate<Val_t>(ctx, token.pos, token.str());
 }
 
 void generate_raw_print(Context_t *ctx) {
@@ -50,6 +50,18 @@ namespace Parser {
  */
 void generate_print(Context_t *ctx, bool print_escape = true);
 
+/** Appends the value of the VAL instruction at the second address to the
+ * value of the VAL instruction at the first address that is followed by
+ * PRINT. The print escaping flags of both prints are respected. The caller
+ * is responsible for removing the second VAL instruction.
+ */
+void join_prints(
+    Context_t *ctx,
+    int64_t first_addr,
+    int64_t second_addr,
+    bool print_escape
+);
+
 /** Generates lookup to dictionary instruction.
  */
 void generate_dict_lookup(Context_t *ctx, const Token_t &token);
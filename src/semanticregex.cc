@@ -98,7 +98,7 @@ generate_match(Context_t *ctx, const Token_t &token, const Token_t &regex) {
     auto regex_value = generate_regex(ctx, regex);
 
     // generate instruction for parsed regex
-    generate<MatchRegex_t>(ctx, std::move(regex_value), regex.pos);
+    generate<MatchRegex_t>(ctx, regex.pos, std::move(regex_value));
     if (token == LEX2::STR_NE)
         generate<Not_t>(ctx, token.pos);
 }
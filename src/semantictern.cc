@@ -69,7 +69,7 @@ void finalize_tern_op_true_branch(Context_t *ctx, const Token_t &token) {
 
     // fix conditional jump offset (relative addr)
     auto &instr = (*ctx->program)[cond_addr].as<JmpIfNot_t>();
-    instr.addr_offset = false_branch_offset;
+    instr.addr_offset = jump_offset(false_branch_offset);
 
     // diagnostic code
     expr_diag(ctx, diag_code::tern_false_branch);
@@ -79,11 +79,11 @@ void finalize_tern_op_false_branch(Context_t *ctx) {
     auto true_branch_jump_addr = ctx->curr_branch_addrs().pop();
     auto tern_op_end_offset = ctx->program->size() - true_branch_jump_addr - 1;
     auto &instr = (*ctx->program)[true_branch_jump_addr].as<Jmp_t>();
-    instr.addr_offset = tern_op_end_offset;
+    instr.addr_offset = jump_offset(tern_op_end_offset);
     ctx->expr_diag.pop();
 
     // breaks invalid print optimization
-    generate<Noop_t>(ctx);
+    generate<Noop_t>(ctx, Pos_t());
 }
 
 } // namespace Parser
@@ -121,7 +121,7 @@ void set_var_impl(Context_t *ctx, const Variable_t &var) {
     case LEX2::TYPE:
     case LEX2::COUNT:
     case LEX2::CASE:
-        generate<Set_t>(ctx, var);
+        generate<Set_t>(ctx, var.pos, var);
         break;
 
     default:
@@ -141,22 +141,22 @@ void generate_var_impl(Context_t *ctx, const Variable_t &var) {
     // generate var instruction
     switch (var.id) {
     case LEX2::BUILTIN_FIRST:
-        generate<PushFragFirst_t>(ctx, var);
+        generate<PushFragFirst_t>(ctx, var.pos, var);
         break;
     case LEX2::BUILTIN_INNER:
-        generate<PushFragInner_t>(ctx, var);
+        generate<PushFragInner_t>(ctx, var.pos, var);
         break;
     case LEX2::BUILTIN_LAST:
-        generate<PushFragLast_t>(ctx, var);
+        generate<PushFragLast_t>(ctx, var.pos, var);
         break;
     case LEX2::BUILTIN_INDEX:
-        generate<PushFragIndex_t>(ctx, var);
+        generate<PushFragIndex_t>(ctx, var.pos, var);
         break;
     case LEX2::BUILTIN_COUNT:
-        generate<PushFragCount_t>(ctx, var);
+        generate<PushFragCount_t>(ctx, var.pos, var);
         break;
     case LEX2::BUILTIN_THIS:
-        generate<PushFrag_t>(ctx, var);
+        generate<PushFrag_t>(ctx, var.pos, var);
         break;
     case LEX2::BUILTIN_PARENT:
         if (var.offset.frag >= ctx->open_frames.top().size()) {
@@ -166,14 +166,14 @@ void generate_var_impl(Context_t *ctx, const Variable_t &var) {
                 "The builtin _parent variable has crossed root boundary; "
                 "converting it to _this"
             );
-            generate<PushFrag_t>(ctx, var);
-        } else generate<PushFrag_t>(ctx, var, var.offset.frag + 1);
+            generate<PushFrag_t>(ctx, var.pos, var);
+        } else generate<PushFrag_t>(ctx, var.pos, var, var.offset.frag + 1);
         break;
 
     case LEX2::BUILTIN_ERROR:
         ctx->params->isErrorFragmentEnabled()
-            ? generate<PushErrorFrag_t>(ctx, false, var.pos)
-            : generate<Var_t>(ctx, var, true);
+            ? generate<PushErrorFrag_t>(ctx, var.pos, false)
+            : generate<Var_t>(ctx, var.pos, var, true);
         break;
 
     case LEX2::VAR:   // $ident
@@ -215,7 +215,7 @@ void generate_var_impl(Context_t *ctx, const Variable_t &var) {
     case LEX2::TYPE:
     case LEX2::COUNT:
     case LEX2::CASE:
-        generate<Var_t>(ctx, var, true);
+        generate<Var_t>(ctx, var.pos, var, true);
         break;
 
     default:
@@ -254,19 +254,19 @@ generate_auto_rtvar_path(
         auto &segment = var_sym.ident[i];
         switch (segment.token_id) {
         case LEX2::BUILTIN_FIRST:
-            generate<PushValFirst_t>(ctx, path, var_sym.pos);
+            generate<PushValFirst_t>(ctx, var_sym.pos, path);
             break;
         case LEX2::BUILTIN_INNER:
-            generate<PushValInner_t>(ctx, path, var_sym.pos);
+            generate<PushValInner_t>(ctx, var_sym.pos, path);
             break;
         case LEX2::BUILTIN_LAST:
-            generate<PushValLast_t>(ctx, path, var_sym.pos);
+            generate<PushValLast_t>(ctx, var_sym.pos, path);
             break;
         case LEX2::BUILTIN_INDEX:
-            generate<PushValIndex_t>(ctx, path, var_sym.pos);
+            generate<PushValIndex_t>(ctx, var_sym.pos, path);
             break;
         case LEX2::BUILTIN_COUNT:
-            generate<PushValCount_t>(ctx, path, var_sym.pos);
+            generate<PushValCount_t>(ctx, var_sym.pos, path);
             break;
 
         case LEX2::BUILTIN_PARENT:
@@ -285,13 +285,13 @@ generate_auto_rtvar_path(
 
         case LEX2::BUILTIN_ERROR:
             if (ctx->params->isErrorFragmentEnabled()) {
-                generate<PushErrorFrag_t>(ctx, true, var_sym.pos);
+                generate<PushErrorFrag_t>(ctx, var_sym.pos, true);
                 break;
             }
             [[fallthrough]];
 
         default:
-            generate<PushAttr_t>(ctx, segment.str(), path, var_sym.pos);
+            generate<PushAttr_t>(ctx, var_sym.pos, segment.str(), path);
             if (gen_repr && (i == (var_sym.ident.size() - 1)))
                 generate<Repr_t>(ctx, var_sym.pos);
             break;
@@ -331,7 +331,7 @@ generate_auto_rtvar(Context_t *ctx, const Variable_t &var_sym, bool gen_repr) {
 
             // variable can't be relative, the prefix does not match or is short
             auto root_offset = ctx->open_frames.top().size();
-            generate<PushRootFrag_t>(ctx, uint16_t(root_offset), var_sym.pos);
+            generate<PushRootFrag_t>(ctx, var_sym.pos, uint16_t(root_offset));
             return generate_auto_rtvar_path(ctx, var_sym, gen_repr);
         }
 
@@ -351,7 +351,7 @@ generate_auto_rtvar(Context_t *ctx, const Variable_t &var_sym, bool gen_repr) {
  */
 void generate_rtvar_this_impl(Context_t *ctx, const Token_t &token) {
     uint16_t root_offset = static_cast<uint16_t>(ctx->open_frames.top().size());
-    generate<PushThisFrag_t>(ctx, root_offset, token.pos);
+    generate<PushThisFrag_t>(ctx, token.pos, root_offset);
     note_optimization_point(ctx, true);
     ctx->rtvar_strings.emplace_back(token.view().begin(), 0);
     ctx->rtvar_idx_start_point.push();
@@ -463,7 +463,7 @@ void ignore_inv_set(Context_t *ctx, const Pos_t &pos) {
 void
 generate_rtvar_index(Context_t *ctx, const Token_t &lp, const Token_t &rp) {
     auto &rtvar_string = ctx->rtvar_strings.back();
-    generate<PushAttrAt_t>(ctx, rtvar_string.str(), lp.pos);
+    generate<PushAttrAt_t>(ctx, lp.pos, rtvar_string.str());
 
     // remove optimization point of index expression because it breaks
     // "unarity" of rtvar expression and expression optimization routine pops
@@ -491,19 +491,19 @@ generate_rtvar_segment(Context_t *ctx, const Token_t &token, bool is_first) {
     // process builtin variables
     switch (token) {
     case LEX2::BUILTIN_FIRST:
-        generate<PushValFirst_t>(ctx, rtvar_string.str(), token.pos);
+        generate<PushValFirst_t>(ctx, token.pos, rtvar_string.str());
         break;
     case LEX2::BUILTIN_INNER:
-        generate<PushValInner_t>(ctx, rtvar_string.str(), token.pos);
+        generate<PushValInner_t>(ctx, token.pos, rtvar_string.str());
         break;
     case LEX2::BUILTIN_LAST:
-        generate<PushValLast_t>(ctx, rtvar_string.str(), token.pos);
+        generate<PushValLast_t>(ctx, token.pos, rtvar_string.str());
         break;
     case LEX2::BUILTIN_INDEX:
-        generate<PushValIndex_t>(ctx, rtvar_string.str(), token.pos);
+        generate<PushValIndex_t>(ctx, token.pos, rtvar_string.str());
         break;
     case LEX2::BUILTIN_COUNT:
-        generate<PushValCount_t>(ctx, rtvar_string.str(), token.pos);
+        generate<PushValCount_t>(ctx, token.pos, rtvar_string.str());
         break;
     case LEX2::BUILTIN_PARENT:
         throw std::runtime_error(__PRETTY_FUNCTION__ + std::string("-parent"));
@@ -511,12 +511,12 @@ generate_rtvar_segment(Context_t *ctx, const Token_t &token, bool is_first) {
         throw std::runtime_error(__PRETTY_FUNCTION__ + std::string("-this"));
     case LEX2::BUILTIN_ERROR:
         if (ctx->params->isErrorFragmentEnabled()) {
-            generate<PushErrorFrag_t>(ctx, true, token.pos);
+            generate<PushErrorFrag_t>(ctx, token.pos, true);
             break;
         }
         [[fallthrough]];
     default:
-        generate<PushAttr_t>(ctx, token.str(), rtvar_string.str(), token.pos);
+        generate<PushAttr_t>(ctx, token.pos, token.str(), rtvar_string.str());
         break;
     }
 
@@ -568,9 +568,10 @@ generate_rtvar_parent(Context_t *ctx, const Token_t &token, bool is_first) {
     }
     case OPCODE::PUSH_THIS_FRAG: {
         // replace this_frag with its parent
-        if (!ctx->open_frames.top().empty())
-            ctx->program->back() = PushFrag_t(0, 1, token.pos);
-        else warn_root_boundary_crossed();
+        if (!ctx->open_frames.top().empty()) {
+            ctx->program->pop_back();
+            generate<PushFrag_t>(ctx, token.pos, uint64_t(0), uint64_t(1));
+        } else warn_root_boundary_crossed();
         break;
     }
     case OPCODE::PUSH_FRAG: {
@@ -613,7 +614,7 @@ void generate_local_rtvar(Context_t *ctx, const Token_t &token) {
 
 void generate_rtvar_root(Context_t *ctx, const Token_t &token) {
     uint16_t root_offset = static_cast<uint16_t>(ctx->open_frames.top().size());
-    generate<PushRootFrag_t>(ctx, root_offset, token.pos);
+    generate<PushRootFrag_t>(ctx, token.pos, root_offset);
     note_optimization_point(ctx, true);
     ctx->rtvar_strings.push_back(token.view());
     ctx->rtvar_idx_start_point.push();
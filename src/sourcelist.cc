@@ -39,6 +39,7 @@
 #include <algorithm>
 
 #include "sourcelist.h"
+#include "filewatcher.h"
 #include "logging.h"
 #include "util.h"
 
@@ -65,6 +66,48 @@ bool SourceList_t::isChanged(const FilesystemInterface_t* filesystem) const {
     return false;
 }
 
+bool SourceList_t::isChanged(
+    const FilesystemInterface_t* filesystem,
+    FileWatcher_t &watcher
+) const {
+    // nothing changed since the last check
+    auto generation = watcher.generation();
+    if (generation == validGeneration.load(std::memory_order_acquire))
+        return false;
+
+    // something changed, check sources
+    if (isChanged(filesystem)) return true;
+
+    // the sources could stop to be watched (e.g. its dir was moved away)
+    watch(watcher);
+    validGeneration.store(generation, std::memory_order_release);
+    return false;
+}
+
+bool SourceList_t::isCheckDue(std::chrono::milliseconds interval) const {
+    if (interval.count() <= 0) return true;
+
+    // not yet
+    int64_t current = now();
+    int64_t last = lastCheck.load(std::memory_order_relaxed);
+    if ((current - last) < interval.count()) return false;
+
+    // only one thread does the check
+    return lastCheck.compare_exchange_strong(last, current);
+}
+
+int64_t SourceList_t::now() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(
+        steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+void SourceList_t::watch(FileWatcher_t &watcher) const {
+    for (auto &source: sources)
+        watcher.watch(source->filename);
+}
+
 const std::string *SourceList_t::operator[](std::size_t i) const {
     static const std::string empty;
     if (i < sources.size())
@@ -72,5 +115,12 @@ const std::string *SourceList_t::operator[](std::size_t i) const {
     return &empty;
 }
 
+std::size_t SourceList_t::memoryUsage() const {
+    std::size_t result = sources.capacity() * sizeof(sources[0]);
+    for (auto &source: sources)
+        result += sizeof(FileStat_t) + heapUsage(source->filename);
+    return result;
+}
+
 } // namespace Teng
 
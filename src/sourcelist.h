@@ -39,6 +39,8 @@
 #define TENGSOURCELIST_H
 
 #include <ctime>
+#include <atomic>
+#include <chrono>
 #include <string>
 #include <vector>
 #include <memory>
@@ -49,6 +51,9 @@
 
 namespace Teng {
 
+// forwards
+class FileWatcher_t;
+
 /**
  * @short Holds statistic about file (see stat(2)).
  *
@@ -66,7 +71,7 @@ class SourceList_t {
 public:
     /** @short Creates new (empty) source list.
      */
-    SourceList_t(): sources() {}
+    SourceList_t(): sources(), validGeneration(0), lastCheck(now()) {}
 
     /** @short Adds new source into the list.
      *
@@ -84,6 +89,48 @@ public:
      */
     bool isChanged(const FilesystemInterface_t* filesystem) const;
 
+    /** @short Check validity of all sources if some watched file changed.
+     *
+     * The sources are stat'd only if the watcher generation differs from
+     * the generation of the last successful check, so the check is as
+     * cheap as one atomic load if no watched file changed. The first check
+     * after the sources have been watched always stats the files because
+     * they could change before they started to be watched.
+     *
+     * @return true means modified; false not modified or error
+     */
+    bool isChanged(
+        const FilesystemInterface_t* filesystem,
+        FileWatcher_t &watcher
+    ) const;
+
+    /** @short Starts watching all sources by given watcher.
+     */
+    void watch(FileWatcher_t &watcher) const;
+
+    /** @short Returns true if the sources have been found unchanged by the
+     * last check and no watched file has changed since.
+     *
+     * It doesn't stat any file, it's as cheap as one atomic load.
+     *
+     * @param generation the current generation of the watcher
+     */
+    bool isValid(uint64_t generation) const {
+        return validGeneration.load(std::memory_order_acquire) == generation;
+    }
+
+    /** @short Returns true if the sources should be checked for change.
+     *
+     * The sources are checked at most once per interval: the first caller
+     * after the interval elapses gets true, the others get false until
+     * the next interval elapses. The interval starts when the list is
+     * created. Zero interval means always.
+     *
+     * @param interval the minimal time between two checks
+     * @return true if the caller should check the sources
+     */
+    bool isCheckDue(std::chrono::milliseconds interval) const;
+
     /** @short Get source by given index.
      *
      * @param position index in the source list
@@ -95,6 +142,10 @@ public:
      */
     std::size_t size() const {return sources.size();}
 
+    /** @short Returns the number of bytes allocated by the list.
+     */
+    std::size_t memoryUsage() const;
+
     /** @short Returns iterator to the first source.
      */
     auto begin() const {return sources.begin();}
@@ -108,7 +159,13 @@ private:
     SourceList_t(const SourceList_t &) = delete;
     SourceList_t &operator=(const SourceList_t &) = delete;
 
+    /** @short Returns monotonic time in milliseconds.
+     */
+    static int64_t now();
+
     std::vector<std::unique_ptr<FileStat_t>> sources; //!< list of sources/files
+    mutable std::atomic<uint64_t> validGeneration; //!< gen of the last check
+    mutable std::atomic<int64_t> lastCheck; //!< time of last check
 };
 
 } // namespace Teng
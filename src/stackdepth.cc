@@ -0,0 +1,260 @@
+/*
+ * Teng -- a general purpose templating engine.
+ * Copyright (C) 2004  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Naskove 1, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:teng@firma.seznam.cz
+ *
+ *
+ * $Id: $
+ *
+ * DESCRIPTION
+ * Teng program analysis -- the maximal depth of the value stack.
+ *
+ * AUTHORS
+ * Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * HISTORY
+ * 2026-10-16  (burlog)
+ *             Created.
+ */
+
+#include <vector>
+#include <utility>
+
+#include "program.h"
+#include "stackdepth.h"
+
+namespace Teng {
+namespace {
+
+/** The number of values the instruction pops from and pushes to the value
+ * stack.
+ */
+struct Effect_t {
+    int64_t pops;   //!< the number of popped values
+    int64_t pushes; //!< the number of pushed values
+};
+
+/** Returns the stack effect of the instruction that doesn't jump.
+ */
+Effect_t effect(const Instruction_t &instr) {
+    switch (instr.opcode()) {
+    case OPCODE::NOOP:
+    case OPCODE::DEBUG_FRAG:
+    case OPCODE::BYTECODE_FRAG:
+    case OPCODE::PRG_STACK_POP:
+    case OPCODE::OPEN_FORMAT:
+    case OPCODE::CLOSE_FORMAT:
+    case OPCODE::OPEN_FRAME:
+    case OPCODE::CLOSE_FRAME:
+    case OPCODE::OPEN_CTYPE:
+    case OPCODE::CLOSE_CTYPE:
+    case OPCODE::LOG_SUPPRESS:
+    case OPCODE::HALT:
+    case OPCODE::JMP:
+    case OPCODE::OPEN_FRAG:
+    case OPCODE::OPEN_ERROR_FRAG:
+    case OPCODE::CLOSE_FRAG:
+    case OPCODE::CALL:
+    case OPCODE::RETURN:
+    case OPCODE::PRINT_VAR:
+    case OPCODE::PRINT_VAL:
+    case OPCODE::JMP_IF_VAR_NOT:
+        return {0, 0};
+
+    case OPCODE::VAL:
+    case OPCODE::VAR:
+    case OPCODE::PRG_STACK_AT:
+    case OPCODE::PUSH_FRAG_COUNT:
+    case OPCODE::PUSH_FRAG_INDEX:
+    case OPCODE::PUSH_FRAG_FIRST:
+    case OPCODE::PUSH_FRAG_LAST:
+    case OPCODE::PUSH_FRAG_INNER:
+    case OPCODE::PUSH_FRAG:
+    case OPCODE::PUSH_ROOT_FRAG:
+    case OPCODE::PUSH_THIS_FRAG:
+        return {0, 1};
+
+    case OPCODE::PRINT:
+    case OPCODE::SET:
+    case OPCODE::PRG_STACK_PUSH:
+    case OPCODE::JMP_IF_NOT:
+        return {1, 0};
+
+    case OPCODE::DICT:
+    case OPCODE::UNARY_PLUS:
+    case OPCODE::UNARY_MINUS:
+    case OPCODE::NOT:
+    case OPCODE::BIT_NOT:
+    case OPCODE::MATCH_REGEX:
+    case OPCODE::PUSH_VAL_COUNT:
+    case OPCODE::PUSH_VAL_INDEX:
+    case OPCODE::PUSH_VAL_FIRST:
+    case OPCODE::PUSH_VAL_LAST:
+    case OPCODE::PUSH_VAL_INNER:
+    case OPCODE::POP_ATTR:
+    case OPCODE::PUSH_ATTR:
+    case OPCODE::REPR:
+    case OPCODE::QUERY_REPR:
+    case OPCODE::QUERY_COUNT:
+    case OPCODE::QUERY_TYPE:
+    case OPCODE::QUERY_DEFINED:
+    case OPCODE::QUERY_EXISTS:
+    case OPCODE::ISEMPTY:
+    case OPCODE::ISUNDEFINED:
+    case OPCODE::ISINTEGRAL:
+    case OPCODE::ISREAL:
+    case OPCODE::ISSTRING:
+    case OPCODE::ISFRAG:
+    case OPCODE::ISFRAGLIST:
+    case OPCODE::ISREGEX:
+        return {1, 1};
+
+    case OPCODE::PLUS:
+    case OPCODE::MINUS:
+    case OPCODE::MUL:
+    case OPCODE::DIV:
+    case OPCODE::MOD:
+    case OPCODE::BIT_AND:
+    case OPCODE::BIT_XOR:
+    case OPCODE::BIT_OR:
+    case OPCODE::EQ:
+    case OPCODE::NE:
+    case OPCODE::GE:
+    case OPCODE::GT:
+    case OPCODE::LE:
+    case OPCODE::LT:
+    case OPCODE::REPEAT:
+    case OPCODE::CONCAT:
+    case OPCODE::STR_EQ:
+    case OPCODE::STR_NE:
+    case OPCODE::PUSH_ATTR_AT:
+        return {2, 1};
+
+    case OPCODE::FUNC:
+        return {instr.as<Func_t>().nargs, 1};
+
+    case OPCODE::PUSH_ERROR_FRAG:
+        return {instr.as<PushErrorFrag_t>().discard_stack_value? 1: 0, 1};
+
+    case OPCODE::AND:
+    case OPCODE::OR:
+        // the value is popped only if the evaluation continues
+        return {1, 1};
+    }
+    throw std::runtime_error(__PRETTY_FUNCTION__);
+}
+
+} // namespace
+
+std::size_t
+max_stack_depth(const Program_t &program, int64_t start, int64_t end) {
+    int64_t result = 0;
+    std::vector<int64_t> depths(end > start? end - start: 0, -1);
+    std::vector<std::pair<int64_t, int64_t>> pending = {{start, 0}};
+
+    // visits given address with given depth of the stack
+    auto visit = [&] (int64_t addr, int64_t depth) {
+        // the processor increments the ip after each jump
+        if (addr < start)
+            throw bad_stack_depth_t("jump before the start", addr);
+        if (addr < end) pending.emplace_back(addr, depth);
+    };
+
+    while (!pending.empty()) {
+        auto [addr, depth] = pending.back();
+        pending.pop_back();
+
+        // each instruction has to be reached with the same stack depth
+        auto &known = depths[addr - start];
+        if (known == depth) continue;
+        if (known >= 0)
+            throw bad_stack_depth_t("paths meet with different depths", addr);
+        known = depth;
+
+        // apply the stack effect of instruction
+        auto &instr = program[addr];
+        auto change = effect(instr);
+        if (depth < change.pops)
+            throw bad_stack_depth_t("stack underflow", addr);
+        auto next_depth = depth - change.pops + change.pushes;
+        result = std::max(result, next_depth);
+
+        // continue to all instructions that can follow
+        switch (instr.opcode()) {
+        case OPCODE::AND:
+            visit(addr + instr.as<And_t>().addr_offset + 1, depth);
+            visit(addr + 1, depth - 1);
+            break;
+        case OPCODE::OR:
+            visit(addr + instr.as<Or_t>().addr_offset + 1, depth);
+            visit(addr + 1, depth - 1);
+            break;
+        case OPCODE::JMP_IF_NOT:
+            visit(addr + instr.as<JmpIfNot_t>().addr_offset + 1, next_depth);
+            visit(addr + 1, next_depth);
+            break;
+        case OPCODE::JMP:
+            visit(addr + instr.as<Jmp_t>().addr_offset + 1, next_depth);
+            break;
+        case OPCODE::OPEN_FRAG:
+            visit(addr + instr.as<OpenFrag_t>().close_frag_offset + 1, depth);
+            visit(addr + 1, depth);
+            break;
+        case OPCODE::OPEN_ERROR_FRAG:
+            visit(addr + instr.as<OpenErrorFrag_t>().close_frag_offset + 1, depth);
+            visit(addr + 1, depth);
+            break;
+        case OPCODE::CLOSE_FRAG:
+            visit(addr + instr.as<CloseFrag_t>().open_frag_offset + 1, depth);
+            visit(addr + 1, depth);
+            break;
+        case OPCODE::CALL:
+            // the subroutines don't change the value stack
+            visit(instr.as<Call_t>().addr + 1, depth);
+            visit(addr + 1, depth);
+            break;
+        case OPCODE::RETURN:
+            // returns behind the call
+            break;
+        case OPCODE::PRINT_VAR:
+        case OPCODE::PRINT_VAL:
+            // the superinstructions cover the next instruction too
+            visit(addr + 2, depth);
+            break;
+        case OPCODE::JMP_IF_VAR_NOT:
+            if (addr + 1 >= end)
+                throw bad_stack_depth_t("truncated superinstruction", addr);
+            visit(addr + 1 + program[addr + 1].as<JmpIfNot_t>().addr_offset + 1, depth);
+            visit(addr + 2, depth);
+            break;
+        default:
+            visit(addr + 1, next_depth);
+            break;
+        }
+    }
+    return static_cast<std::size_t>(result);
+}
+
+std::size_t max_stack_depth(const Program_t &program) {
+    return max_stack_depth(program, 0, static_cast<int64_t>(program.size()));
+}
+
+} // namespace Teng
+
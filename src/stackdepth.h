@@ -0,0 +1,83 @@
+/*
+ * Teng -- a general purpose templating engine.
+ * Copyright (C) 2004  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Naskove 1, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:teng@firma.seznam.cz
+ *
+ *
+ * $Id: $
+ *
+ * DESCRIPTION
+ * Teng program analysis -- the maximal depth of the value stack.
+ *
+ * AUTHORS
+ * Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * HISTORY
+ * 2026-10-16  (burlog)
+ *             Created.
+ */
+
+#ifndef TENGSTACKDEPTH_H
+#define TENGSTACKDEPTH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+
+namespace Teng {
+
+// forwards
+class Program_t;
+
+/** Thrown if the depth of the value stack can't be determined because the
+ * program is malformed.
+ */
+struct bad_stack_depth_t: public std::runtime_error {
+    bad_stack_depth_t(const std::string &what, int64_t addr)
+        : std::runtime_error(
+            "can't determine the value stack depth: " + what
+            + ": addr=" + std::to_string(addr)
+        )
+    {}
+};
+
+/** Returns the maximal depth of the value stack the program can reach when
+ * it is run from the start address. It follows all jumps, so the result is
+ * valid for any path through the program.
+ *
+ * Throws bad_stack_depth_t if some path can pop the empty stack, if the
+ * paths meet with different depths of the stack or if some jump leads
+ * before the start.
+ *
+ * @param program the compiled program
+ * @param start the first executed instruction
+ * @param end the end of the executed part of the program
+ */
+std::size_t
+max_stack_depth(const Program_t &program, int64_t start, int64_t end);
+
+/** Returns the maximal depth of the value stack of the whole program.
+ */
+std::size_t max_stack_depth(const Program_t &program);
+
+} // namespace Teng
+
+#endif /* TENGSTACKDEPTH_H */
+
@@ -233,7 +233,7 @@
 
 
 start
-    : template {generate<Halt_t>(ctx);}
+    : template {generate<Halt_t>(ctx, Pos_t());}
     ;
 
 
@@ -41,109 +41,191 @@ namespace Teng {
 TemplateCache_t::TemplateCache_t(
     std::shared_ptr<const FilesystemInterface_t> filesystem,
     unsigned int programCacheSize,
-    unsigned int dictCacheSize
-): filesystem(filesystem), programCache(programCacheSize),
-   dictCache(dictCacheSize), paramsCache(dictCacheSize)
+    unsigned int dictCacheSize,
+    unsigned int cacheShards,
+    std::size_t programCacheBytes,
+    std::size_t dictCacheBytes,
+    std::unique_ptr<BytecodeStore_t> bytecode
+): filesystem(filesystem), watcherCreated(), watcher(),
+   bytecode(std::move(bytecode)),
+   programCache(programCacheSize, cacheShards, programCacheBytes),
+   dictCache(dictCacheSize, cacheShards, dictCacheBytes),
+   paramsCache(dictCacheSize, cacheShards, dictCacheBytes)
 {}
 
-Template_t
-TemplateCache_t::createTemplate(
-    Error_t &err,
+TemplateCache_t::Request_t::Request_t(
     const std::string &source,
     const std::string &langFilename,
     const std::string &configFilename,
     const std::string &encoding,
     const std::string &ctype,
     SourceType_t sourceType
-) {
+): source(source), langFilename(langFilename), configFilename(configFilename),
+   encoding(encoding), ctype(ctype), sourceType(sourceType)
+{
+    // key for config
+    configKey.push_back(createCacheKeyForFilename(configFilename));
+
+    // key for dictionary
+    dictKey = configKey;
+    dictKey.push_back(createCacheKeyForFilename(langFilename));
+
+    // create key from source file names
+    if (sourceType == SRC_STRING)
+        programKey.push_back(createCacheKeyForString(source));
+    else programKey.push_back(createCacheKeyForFilename(source));
+    programKey.push_back(createCacheKeyForFilename(langFilename));
+    programKey.push_back(createCacheKeyForFilename(configFilename));
+}
+
+Template_t
+TemplateCache_t::createTemplate(Error_t &err, const Request_t &request) {
     // get configuration and dictionary from cache
     uint64_t configSerial;
     std::shared_ptr<Dictionary_t> dict;
     std::shared_ptr<Configuration_t> params;
-    std::tie(params, dict, configSerial)
-        = getConfigAndDict(err, configFilename, langFilename);
-
-    // create key from source file names
-    std::vector<std::string> key;
-    if (sourceType == SRC_STRING)
-        key.push_back(createCacheKeyForString(source));
-    else key.push_back(createCacheKeyForFilename(source));
-    key.push_back(createCacheKeyForFilename(langFilename));
-    key.push_back(createCacheKeyForFilename(configFilename));
+    std::tie(params, dict, configSerial) = getConfigAndDict(err, request);
 
     // cached program
     uint64_t dependSerial;
     std::shared_ptr<Program_t> program;
-    std::tie(program, dependSerial, std::ignore) = programCache.find(key);
+    std::tie(program, dependSerial, std::ignore)
+        = programCache.find(request.programKey);
 
     // determine whether we have to reload program
     bool reload = !program
         || (configSerial != dependSerial)
-        || (params->isWatchFilesEnabled() && program->isChanged(filesystem.get()));
+        || isChanged(program->getSources(), *params);
 
-    // create new program if reload requested
+    // create new program if reload requested; if other thread compiles the
+    // same program use the stale one or wait for the other thread result
     if (reload) {
-        auto *d = &*dict;
-        auto *p = &*params;
-        program = (sourceType == SRC_STRING)
-            ? compile_string(err, d, p, filesystem.get(), {source}, encoding, ctype)
-            : compile_file(err, d, p, filesystem.get(), source, encoding, ctype);
-        programCache.add(key, program, configSerial);
+        auto stale = std::move(program);
+        program = programFlights.load(request.programKey, stale, [&] {
+            // other thread could finish the compilation in the meantime
+            std::shared_ptr<Program_t> fresh;
+            std::tie(fresh, dependSerial, std::ignore)
+                = programCache.peek(request.programKey);
+            if (fresh && (fresh != stale) && (configSerial == dependSerial))
+                return fresh;
+
+            // compile the program
+            fresh = compile(err, request, *dict, *params);
+            if (auto *watcher = watching(*params)) fresh->watch(*watcher);
+            programCache.add(request.programKey, fresh, configSerial);
+            return fresh;
+        });
     }
 
     // create template with cached sources
     return {std::move(program), std::move(dict), std::move(params)};
 }
 
+std::shared_ptr<Program_t>
+TemplateCache_t::compile(
+    Error_t &err,
+    const Request_t &request,
+    const Dictionary_t &dict,
+    const Configuration_t &params
+) const {
+    // the program depends on sources of dict and config and on the options
+    std::string key;
+    std::vector<const SourceList_t *> deps;
+    if (bytecode) {
+        for (auto &part: request.programKey) key.append(part).push_back('\0');
+        key.append(request.encoding).push_back('\0');
+        key.append(request.ctype);
+        deps = {&dict.getSources(), &params.getSources()};
+        if (auto program = bytecode->load(err, filesystem.get(), key, deps))
+            return program;
+    }
+
+    // compile the program
+    auto errors = err.size();
+    auto &source = request.source;
+    auto &encoding = request.encoding;
+    auto &ctype = request.ctype;
+    std::shared_ptr<Program_t> program = (request.sourceType == SRC_STRING)
+        ? compile_string(err, &dict, &params, filesystem.get(), {source}, encoding, ctype)
+        : compile_file(err, &dict, &params, filesystem.get(), source, encoding, ctype);
+
+    // persist only the flawless programs, so the errors are reported again
+    if (bytecode && (err.size() == errors))
+        bytecode->save(key, *program, deps);
+    return program;
+}
+
+bool TemplateCache_t::isChanged(
+    const SourceList_t &sources,
+    const Configuration_t &params
+) const {
+    if (!params.isWatchFilesEnabled()) return false;
+    if (!sources.isCheckDue(params.getCheckInterval())) return false;
+    auto *watcher = watching(params);
+    return watcher
+        ? sources.isChanged(filesystem.get(), *watcher)
+        : sources.isChanged(filesystem.get());
+}
+
+bool TemplateCache_t::isUpToDate(const Template_t &templ) const {
+    auto *watcher = watching(*templ.params);
+    if (!watcher) return true; // not watched or the files never change
+    auto generation = watcher->generation();
+    return templ.params->getSources().isValid(generation)
+        && templ.dict->getSources().isValid(generation)
+        && templ.program->getSources().isValid(generation);
+}
+
+FileWatcher_t *TemplateCache_t::watching(const Configuration_t &params) const {
+    if (!params.isWatchFilesEnabled()) return nullptr;
+    std::call_once(watcherCreated, [&] {
+        watcher = create_watcher(filesystem.get());
+    });
+    return watcher.get();
+}
+
 std::tuple<
     std::shared_ptr<Configuration_t>,
     std::shared_ptr<Dictionary_t>,
     uint64_t
-> TemplateCache_t::getConfigAndDict(
-    Error_t &err,
-    const std::string &configFilename,
-    const std::string &dictFilename,
-    unsigned long int *)
-{
-    // key for config
-    std::vector<std::string> key;
-    key.push_back(createCacheKeyForFilename(configFilename));
+> TemplateCache_t::getConfigAndDict(Error_t &err, const Request_t &request) {
+    auto &configFilename = request.configFilename;
+    auto &dictFilename = request.langFilename;
 
     // find or create configuration
     uint64_t configSerial;
     std::shared_ptr<Configuration_t> params;
-    std::tie(params, std::ignore, configSerial) = paramsCache.find(key);
+    std::tie(params, std::ignore, configSerial)
+        = paramsCache.find(request.configKey);
 
     // determine whether we have to reload params
-    bool reload_params = !params
-        || (params->isWatchFilesEnabled() && params->isChanged());
+    bool reload_params = !params || isChanged(params->getSources(), *params);
 
     // reload params if needed
     if (reload_params) {
         params = std::make_shared<Configuration_t>(err, filesystem);
         if (!configFilename.empty()) params->parse(configFilename);
-        configSerial = paramsCache.add(key, params);
+        if (auto *watcher = watching(*params)) params->watch(*watcher);
+        configSerial = paramsCache.add(request.configKey, params);
     }
 
-    // reuse key for dictionary
-    key.push_back(createCacheKeyForFilename(dictFilename));
-
     // find or create dictionary
     uint64_t dictSerial = 0;
     uint64_t dependSerial = 0;
     std::shared_ptr<Dictionary_t> dict;
-    std::tie(dict, dependSerial, dictSerial) = dictCache.find(key);
+    std::tie(dict, dependSerial, dictSerial) = dictCache.find(request.dictKey);
 
     // determine whether we have to reload dict
     bool reload_dict = !dict
         || (configSerial != dependSerial)
-        || (params->isWatchFilesEnabled() && dict->isChanged());
+        || isChanged(dict->getSources(), *params);
 
     // reload lang dict if needed
     if (reload_dict) {
         dict = std::make_shared<Dictionary_t>(err, filesystem);
         if (!dictFilename.empty()) dict->parse(dictFilename);
-        dictCache.add(key, dict, configSerial);
+        if (auto *watcher = watching(*params)) dict->watch(*watcher);
+        dictCache.add(request.dictKey, dict, configSerial);
     }
 
     // return data
@@ -151,4 +233,3 @@ std::tuple<
 }
 
 } // namespace Teng
-
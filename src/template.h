@@ -38,15 +38,18 @@
 #define TENGTEMPLATE_H
 
 #include <tuple>
+#include <mutex>
 #include <memory>
 #include <utility>
 #include <string>
 
 #include "cache.h"
+#include "bytecode.h"
 #include "dictionary.h"
 #include "program.h"
 #include "parsercontext.h"
 #include "configuration.h"
+#include "filewatcher.h"
 
 namespace Teng {
 
@@ -63,31 +66,57 @@ public:
 };
 
 /** @short Cache of templates.
+ *
+ *  If the watchFiles feature is enabled the sources of cached objects are
+ *  registered in the file watcher of the filesystem and they are stat'd only
+ *  if the watcher reports that some watched file has changed. The checks can
+ *  be further limited by the checkInterval directive.
+ *
+ *  If the bytecode store is given the compiled programs are stored there,
+ *  so the other processes don't have to compile them again.
+ *
+ *  Only one thread compiles the program at a time. The other threads that
+ *  need the same program serve the stale program meanwhile, or wait for the
+ *  compilation if there is no stale program.
  */
 class TemplateCache_t {
 public:
     /** @short Cache of dictionaries.
      */
-    using DictionaryCache_t = Cache_t<Dictionary_t>;
+    using DictionaryCache_t = ShardedCache_t<Dictionary_t>;
 
     /** @short Cache of configurations.
      */
-    using ConfigurationCache_t = Cache_t<Configuration_t>;
+    using ConfigurationCache_t = ShardedCache_t<Configuration_t>;
 
     /** @short Cache of dictionaries.
      */
-    using ProgramCache_t = Cache_t<Program_t>;
+    using ProgramCache_t = ShardedCache_t<Program_t>;
+
+    /** @short The programs that are being compiled.
+     */
+    using ProgramFlights_t = CacheFlights_t<Program_t>;
 
     /** @short Create new cache.
+     *
+     *  The cache can be safely used from many threads at once.
      *
      *  @param fs_root root dir for relative paths
      *  @param programCacheSize maximal number of programs in the cache
      *  @param dictCacheSizemaximal number of dictionaries in the cache
+     *  @param cacheShards the number of independently locked cache shards
+     *  @param programCacheBytes maximal memory of programs in the cache
+     *  @param dictCacheBytes maximal memory of dictionaries in the cache
+     *  @param bytecode storage of compiled programs shared by engines or null
      */
     TemplateCache_t(
         std::shared_ptr<const FilesystemInterface_t> filesystem,
         unsigned int programCacheSize = 0,
-        unsigned int dictCacheSize = 0
+        unsigned int dictCacheSize = 0,
+        unsigned int cacheShards = 0,
+        std::size_t programCacheBytes = 0,
+        std::size_t dictCacheBytes = 0,
+        std::unique_ptr<BytecodeStore_t> bytecode = nullptr
     );
 
     /** @short Type of source.
@@ -97,6 +126,34 @@ public:
         SRC_STRING, /**< source is template */
     };
 
+    /** @short Arguments of the template creation with precomputed cache keys.
+     *
+     *  It allows to repeat the template creation without building the keys
+     *  again (and without hashing the whole template source).
+     */
+    struct Request_t {
+        /** @short Create request and its cache keys.
+         */
+        Request_t(
+            const std::string &source,
+            const std::string &langFilename,
+            const std::string &configFilename,
+            const std::string &encoding,
+            const std::string &ctype,
+            SourceType_t sourceType
+        );
+
+        std::string source;         //!< template filename or template itself
+        std::string langFilename;   //!< file with language dictionary
+        std::string configFilename; //!< file with config
+        std::string encoding;       //!< template encoding
+        std::string ctype;          //!< template content type
+        SourceType_t sourceType;    //!< type of template source
+        ProgramCache_t::Key_t configKey;  //!< key of config in cache
+        DictionaryCache_t::Key_t dictKey; //!< key of dictionary in cache
+        ProgramCache_t::Key_t programKey; //!< key of program in cache
+    };
+
     /** @short Create template from given data.
      *  @param templateSource source of template
      *  @param langFilename file with language dictionary
@@ -113,7 +170,36 @@ public:
         const std::string &encoding,
         const std::string &ctype,
         SourceType_t sourceType
-    );
+    ) {
+        Request_t request(
+            source,
+            langFilename,
+            paramFilename,
+            encoding,
+            ctype,
+            sourceType
+        );
+        return createTemplate(err, request);
+    }
+
+    /** @short Create template for given request.
+     *  @param request the template source and its cache keys
+     *  @return created template
+     */
+    Template_t createTemplate(Error_t &err, const Request_t &request);
+
+    /** @short Returns true if the template can be used without asking the
+     *  cache again.
+     *
+     *  That's if the watchFiles feature is disabled or if no watched file has
+     *  changed since the sources of the program, dictionary and configuration
+     *  have been checked last time. It doesn't stat any file and doesn't
+     *  lock the cache. If it returns false the template has to be revalidated
+     *  by createTemplate().
+     *
+     *  @param templ the template created by this cache
+     */
+    bool isUpToDate(const Template_t &templ) const;
 
     /** @short Create dictionary from given files.
      *
@@ -127,34 +213,80 @@ public:
         const std::string &configFilename,
         const std::string &dictFilename
     ) {
-        return std::get<1>(getConfigAndDict(err, configFilename, dictFilename));
+        Request_t request({}, dictFilename, configFilename, {}, {}, SRC_FILE);
+        return std::get<1>(getConfigAndDict(err, request));
     }
 
+    /** @short Returns statistics of the program cache.
+     */
+    CacheStats_t getProgramStats() const {return programCache.getStats();}
+
+    /** @short Returns statistics of the dictionary cache.
+     */
+    CacheStats_t getDictionaryStats() const {return dictCache.getStats();}
+
+    /** @short Returns statistics of the configuration cache.
+     */
+    CacheStats_t getConfigurationStats() const {return paramsCache.getStats();}
+
 private:
     // don't copy
     TemplateCache_t(const TemplateCache_t &) = delete;
     TemplateCache_t &operator=(const TemplateCache_t &) = delete;
 
-    /** @short Get configuration and dictionary from given files.
+    /** @short Get configuration and dictionary for given request.
      *
-     *  @param configFilename file with configuration
-     *  @param dictFilename file with dictionary
-     *  @param serial serial number of cached data (output)
-     *  @return configuration and dictionary
+     *  @param request the config and dict filenames and their cache keys
+     *  @return configuration, dictionary and serial number of configuration
      */
     std::tuple<
         std::shared_ptr<Configuration_t>,
         std::shared_ptr<Dictionary_t>,
         uint64_t
-    > getConfigAndDict(
+    > getConfigAndDict(Error_t &err, const Request_t &request);
+
+    /** @short Loads the persisted program or compiles the new one.
+     *
+     *  @param request the template source and its cache keys
+     *  @param dict the dictionary used for compilation
+     *  @param params the configuration used for compilation
+     *  @return the program
+     */
+    std::shared_ptr<Program_t>
+    compile(
         Error_t &err,
-        const std::string &configFilename,
-        const std::string &dictFilename,
-        uint64_t *serial = nullptr
-    );
+        const Request_t &request,
+        const Dictionary_t &dict,
+        const Configuration_t &params
+    ) const;
+
+    /** @short Returns true if some of sources changed.
+     *
+     *  The sources are checked only if watchFiles feature is enabled and at
+     *  most once per checkInterval (if configured).
+     *
+     *  @param sources the sources of cached object
+     *  @param params the configuration of the template
+     */
+    bool isChanged(
+        const SourceList_t &sources,
+        const Configuration_t &params
+    ) const;
+
+    /** @short Returns the watcher of sources or nullptr if the sources
+     *  shouldn't or can't be watched. The watcher is created by first call
+     *  with watchFiles feature enabled.
+     *
+     *  @param params the configuration of the template
+     */
+    FileWatcher_t *watching(const Configuration_t &params) const;
 
     std::shared_ptr<const FilesystemInterface_t> filesystem;
+    mutable std::once_flag watcherCreated;          //!< watcher is created
+    mutable std::unique_ptr<FileWatcher_t> watcher; //!< watches sources
+    std::unique_ptr<BytecodeStore_t> bytecode; //!< persisted programs or null
     ProgramCache_t programCache;      //!< cache of compiled templates
+    ProgramFlights_t programFlights;  //!< compilations in progress
     DictionaryCache_t dictCache;      //!< cache of parsed language dictionaries
     ConfigurationCache_t paramsCache; //!< cahce of parsed config dictionaries
 };
@@ -40,6 +40,9 @@
 
 #include <stdexcept>
 #include <memory>
+#include <atomic>
+#include <thread>
+#include <algorithm>
 
 #include "util.h"
 #include "platform.h"
@@ -80,8 +83,77 @@ std::string prependBeforeExt(const std::string &str, const std::string &prep) {
     }
 }
 
+/** Renders the template to the writer.
+ */
+int render_template(
+    const Template_t &templ,
+    const std::string &encoding,
+    const std::string &contentType,
+    const FragmentValue_t &data,
+    Writer_t &writer,
+    Error_t &err,
+    Profile_t *profile = nullptr
+) {
+    // propage error log
+    writer.setError(&err);
+
+    // if program is valid (not empty) execute it
+    if (!templ.program->empty()) {
+        Processor_t processor(
+            err,
+            *templ.program,
+            *templ.dict,
+            *templ.params,
+            encoding,
+            contentType
+        );
+        if (profile) processor.run(data, writer, *profile);
+        else processor.run(data, writer);
+    }
+
+    // flush writer to output
+    writer.flush();
+
+    // return error level from error log
+    return err.max_level;
+}
+
+/** Creates template cache request from generate page arguments.
+ */
+TemplateCache_t::Request_t
+make_request(const Teng_t::GenPageArgs_t &args) {
+    return {
+        args.templateFilename.empty()
+            ? args.templateString
+            : prependBeforeExt(args.templateFilename, args.skin),
+        prependBeforeExt(args.dictFilename, args.lang),
+        args.paramsFilename,
+        tolower(args.encoding),
+        args.contentType,
+        args.templateFilename.empty()
+            ? TemplateCache_t::SRC_STRING
+            : TemplateCache_t::SRC_FILE
+    };
+}
+
+/** Creates the storage of compiled templates requested by settings.
+ */
+std::unique_ptr<BytecodeStore_t>
+createBytecodeStore(const Teng_t::Settings_t &settings) {
+    if (settings.sharedCacheBytes)
+        return std::make_unique<SharedBytecodeArena_t>(settings.sharedCacheBytes);
+    if (!settings.bytecodeDir.empty())
+        return std::make_unique<BytecodeDirectory_t>(settings.bytecodeDir);
+    return nullptr;
+}
+
 } // namespace
 
+struct TemplateHandle_t::PTemplateHandle_t {
+    TemplateCache_t::Request_t request; //!< the template source and cache keys
+    mutable std::shared_ptr<const Template_t> templ; //!< the prepared template
+};
+
 struct Teng_t::PTeng_t {
     PTeng_t(std::unique_ptr<TemplateCache_t> templateCache)
         : templateCache(std::move(templateCache))
@@ -97,7 +169,14 @@ Teng_t::Teng_t(const std::string& fs_root, const Teng_t::Settings_t& settings)
 
 Teng_t::Teng_t(std::shared_ptr<FilesystemInterface_t> fs, const Settings_t& settings)
     : p(std::make_unique<Teng_t::PTeng_t>(
-        std::make_unique<TemplateCache_t>(fs, settings.programCacheSize, settings.dictCacheSize)))
+        std::make_unique<TemplateCache_t>(
+            fs,
+            settings.programCacheSize,
+            settings.dictCacheSize,
+            settings.cacheShards,
+            settings.programCacheBytes,
+            settings.dictCacheBytes,
+            createBytecodeStore(settings))))
 {}
 
 Teng_t::~Teng_t() = default;
@@ -106,48 +185,124 @@ int Teng_t::generatePage(
     const GenPageArgs_t &args,
     const Fragment_t &data,
     Writer_t &writer,
-    Error_t &err
+    Error_t &err,
+    Profile_t *profile
 ) const {
-    std::string encoding_lowerized = tolower(args.encoding);
-
-    // prepare template
-    std::string template_arg = args.templateFilename.empty()
-        ? args.templateString
-        : prependBeforeExt(args.templateFilename, args.skin);
-
     // create template
-    auto templ = p->templateCache->createTemplate(
+    auto request = make_request(args);
+    auto templ = p->templateCache->createTemplate(err, request);
+
+    // render the template
+    return render_template(
+        templ,
+        request.encoding,
+        request.ctype,
+        FragmentValue_t(&data),
+        writer,
         err,
-        template_arg,
-        prependBeforeExt(args.dictFilename, args.lang),
-        args.paramsFilename,
-        encoding_lowerized,
-        args.contentType,
-        args.templateFilename.empty()
-            ? TemplateCache_t::SRC_STRING
-            : TemplateCache_t::SRC_FILE
+        profile
     );
+}
 
-    // propage error log
-    writer.setError(&err);
+TemplateHandle_t
+Teng_t::prepare(const GenPageArgs_t &args, Error_t &err) const {
+    auto request = make_request(args);
+    auto templ = std::make_shared<const Template_t>(
+        p->templateCache->createTemplate(err, request)
+    );
+    TemplateHandle_t handle;
+    handle.p = std::make_shared<TemplateHandle_t::PTemplateHandle_t>(
+        TemplateHandle_t::PTemplateHandle_t{
+            std::move(request),
+            std::move(templ)
+        }
+    );
+    return handle;
+}
 
-    // if program is valid (not empty) execute it
-    if (!templ.program->empty()) {
-        Processor_t(
-            err,
-            *templ.program,
-            *templ.dict,
-            *templ.params,
-            encoding_lowerized,
-            args.contentType
-        ).run(FragmentValue_t(&data), writer);
+int Teng_t::render(
+    const TemplateHandle_t &handle,
+    const Fragment_t &data,
+    Writer_t &writer,
+    Error_t &err,
+    Profile_t *profile
+) const {
+    if (!handle) {
+        logError(err, Pos_t(), "Teng::render(): the template handle is empty");
+        writer.flush();
+        return err.max_level;
     }
 
-    // flush writer to output
-    writer.flush();
+    // the prepared template is used as long as no watched file changed,
+    // otherwise it's revalidated by the cache and replaced with fresh one
+    auto &request = handle.p->request;
+    auto templ = std::atomic_load(&handle.p->templ);
+    if (!p->templateCache->isUpToDate(*templ)) {
+        templ = std::make_shared<const Template_t>(
+            p->templateCache->createTemplate(err, request)
+        );
+        std::atomic_store(&handle.p->templ, templ);
+    }
 
-    // return error level from error log
-    return err.max_level;
+    return render_template(
+        *templ,
+        request.encoding,
+        request.ctype,
+        FragmentValue_t(&data),
+        writer,
+        err,
+        profile
+    );
+}
+
+std::vector<Teng_t::PreloadResult_t>
+Teng_t::preload(
+    const std::vector<GenPageArgs_t> &args,
+    unsigned int threads
+) const {
+    std::vector<PreloadResult_t> results(args.size());
+
+    // prepares templates until there is no one left
+    std::atomic<std::size_t> next{0};
+    auto worker = [&] {
+        for (auto i = next++; i < args.size(); i = next++) {
+            Error_t err;
+            auto start = std::chrono::steady_clock::now();
+            p->templateCache->createTemplate(err, make_request(args[i]));
+            auto duration = std::chrono::steady_clock::now() - start;
+            results[i].duration
+                = std::chrono::duration_cast<std::chrono::microseconds>(
+                    duration
+                );
+            results[i].errors = err.getEntries();
+        }
+    };
+
+    // run workers
+    if (!threads) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min<unsigned int>(threads, static_cast<unsigned int>(args.size()));
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < threads; ++i) workers.emplace_back(worker);
+    worker();
+    for (auto &thread: workers) thread.join();
+    return results;
+}
+
+Teng_t::TemplateCacheStats_t Teng_t::getCacheStats() const {
+    auto convert = [] (const auto &stats) {
+        Teng_t::CacheStats_t result;
+        result.bytes = stats.bytes;
+        result.entries = stats.entries;
+        result.hits = stats.hits;
+        result.misses = stats.misses;
+        result.evictions = stats.evictions;
+        return result;
+    };
+    TemplateCacheStats_t result;
+    result.programs = convert(p->templateCache->getProgramStats());
+    result.dictionaries = convert(p->templateCache->getDictionaryStats());
+    result.configurations = convert(p->templateCache->getConfigurationStats());
+    return result;
 }
 
 const std::string *Teng_t::dictionaryLookup(
@@ -175,7 +330,11 @@ Teng_t::dictionaryLookup(
     const std::string &key,
     std::string &result
 ) const {
-    if (auto *value = dictionaryLookup(config, dict, lang, key)) {
+    // the dictionary must be held until the value is copied
+    Error_t err;
+    auto path = prependBeforeExt(dict, lang);
+    auto dictionary = p->templateCache->createDictionary(err, config, path);
+    if (auto *value = dictionary->lookup(key)) {
         result = *value;
         return 0;
     }
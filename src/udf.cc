@@ -51,21 +51,31 @@ namespace {
  */
 class Registry_t {
 public:
-    /** Returns registered function for given name if any or empty function.
+    /** Returns registered function for given name if any or empty slot.
      */
-    Function_t find(const std::string &name) {
+    Slot_t find(const std::string &name) {
 #ifndef NO_UDF_LOCKS
         std::lock_guard<std::mutex> locked(mutex);
 #endif /* NO_UDF_LOCKS */
         auto ifunction = registry.find(name);
         return ifunction == registry.end()
-             ? Function_t{}
+             ? Slot_t{}
              : ifunction->second;
     }
 
+    /** Returns registered function for given name if any or nullptr.
+     */
+    const Slot_t *slot(const std::string &name) {
+#ifndef NO_UDF_LOCKS
+        std::lock_guard<std::mutex> locked(mutex);
+#endif /* NO_UDF_LOCKS */
+        auto ifunction = registry.find(name);
+        return ifunction == registry.end()? nullptr: &ifunction->second;
+    }
+
     /** Inserts new value to registry.
      */
-    void insert(const std::string &name, Function_t function) {
+    void insert(const std::string &name, Slot_t function) {
 #ifndef NO_UDF_LOCKS
         std::lock_guard<std::mutex> locked(mutex);
 #endif /* NO_UDF_LOCKS */
@@ -82,17 +92,49 @@ public:
     }
 
     std::mutex mutex;
-    std::unordered_map<std::string, Function_t> registry;
+    std::unordered_map<std::string, Slot_t> registry;
 } registered_functions;
 
 } // namespace
 
 void registerFunction(const std::string &name, Function_t function) {
-    registered_functions.insert(name, std::move(function));
+    registered_functions.insert(name, {std::move(function), {}});
+}
+
+void registerViewFunction(const std::string &name, ViewFunction_t function) {
+    registered_functions.insert(name, {{}, std::move(function)});
 }
 
 Invoker_t<Function_t> findFunction(const std::string &name) {
-    return {name, registered_functions.find(name)};
+    auto slot = registered_functions.find(name);
+    if (!slot.view_function) return {name, std::move(slot.function)};
+
+    // the view expects the args in the stack order (reversed vector order)
+    return {
+        name,
+        [function = std::move(slot.view_function)] (const Args_t &args) {
+            Args_t stack(args.rbegin(), args.rend());
+            auto *first = stack.data();
+            return function(ArgsView_t(first, first + stack.size()));
+        }
+    };
+}
+
+Invoker_t<ViewFunction_t> findViewFunction(const std::string &name) {
+    auto slot = registered_functions.find(name);
+    if (!slot.function) return {name, std::move(slot.view_function)};
+
+    // the function wants the args in vector
+    return {
+        name,
+        [function = std::move(slot.function)] (const ArgsView_t &args) {
+            return function(Args_t(args.begin(), args.end()));
+        }
+    };
+}
+
+const Slot_t *findSlot(const std::string &name) {
+    return registered_functions.slot(name);
 }
 
 } // namespace udf
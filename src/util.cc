@@ -140,5 +140,11 @@ std::string strerr(int errno_value) {
     return strerror_r(errno_value, system_error, sizeof(system_error));
 }
 
+std::size_t heapUsage(const std::string &str) {
+    auto *self = reinterpret_cast<const char *>(&str);
+    if ((str.data() >= self) && (str.data() < self + sizeof(str))) return 0;
+    return str.capacity() + 1;
+}
+
 } // namespace Teng
 
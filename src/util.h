@@ -72,6 +72,12 @@ std::string tolower(std::string str);
  */
 std::string strerr(int errno_value);
 
+/** @short Returns the number of bytes the string allocated on the heap.
+ *
+ * Strings stored in the small string buffer don't allocate anything.
+ */
+std::size_t heapUsage(const std::string &str);
+
 } // namespace Teng
 
 #endif // TENGUTIL_H
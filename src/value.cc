@@ -68,10 +68,10 @@ std::ostream &operator<<(std::ostream &os, const Regex_t &regex) {
     return os;
 }
 
-Value_t::Value_t(const FragmentValue_t *value) noexcept {
+Value_t::Value_t(const FragmentValue_t *value) {
     switch (value->type()) {
     case FragmentValue_t::tag::list:
-        new (this) Value_t(&value->list_value);
+        new (this) Value_t(value->list_value);
         break;
     case FragmentValue_t::tag::frag_ptr:
         new (this) Value_t(value->frag_ptr_value);
@@ -89,6 +89,14 @@ Value_t::Value_t(const FragmentValue_t *value) noexcept {
     case FragmentValue_t::tag::real:
         new (this) Value_t(value->real_value);
         break;
+    case FragmentValue_t::tag::string_view:
+        // borrowed by app data, it lives longer than value too
+        new (this) Value_t(value->string_view_value);
+        break;
+    case FragmentValue_t::tag::lazy:
+        // the provider is called when the list is read first time
+        new (this) Value_t(&value->materialize());
+        break;
     }
 }
 
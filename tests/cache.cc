@@ -0,0 +1,660 @@
+/*
+ * Teng -- a general purpose templating engine.
+ * Copyright (C) 2004  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Naskove 1, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:teng@firma.seznam.cz
+ *
+ *
+ * $Id: $
+ *
+ * DESCRIPTION
+ * Teng engine -- template cache tests.
+ *
+ * AUTHORS
+ * Michal Bukovsky <michal.bukovsky@firma.seznam.cz>
+ *
+ * HISTORY
+ * 2026-10-16  (burlog)
+ *             Created.
+ */
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <fstream>
+#include <dirent.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <teng/teng.h>
+#include <teng/filesystem.h>
+
+#include "catch2/catch_test_macros.hpp"
+#include "utils.h"
+
+SCENARIO(
+    "Sharing one engine between threads",
+    "[cache]"
+) {
+    GIVEN("Engine with sharded cache and a few templates") {
+        Teng::Teng_t teng(TEST_ROOT, Teng::Teng_t::Settings_t(4, 4, 2));
+        std::vector<std::string> templates = {
+            "<?teng frag sample?>${_index}<?teng endfrag?>",
+            "${var}<?teng if $var =~ /x/?>-x<?teng endif?>",
+            "#{html_value}${var}",
+            "<?teng include file='text.txt'?>",
+            "${var}${var}",
+            "${len($var)}",
+        };
+        std::vector<std::string> expected = {
+            "01",
+            "(x)-x",
+            "&amp;&lt;b&gt;some &lt;i&gt;HTML&lt;/i&gt; text&lt;/b&gt;&amp;(x)",
+            "some text (x)\n",
+            "(x)(x)",
+            "3",
+        };
+
+        WHEN("Pages are generated from many threads at once") {
+            Teng::Fragment_t root;
+            root.addVariable("var", "(x)");
+            root.addFragment("sample");
+            root.addFragment("sample");
+
+            std::atomic<int> mismatches{0};
+            std::vector<std::thread> threads;
+            for (int t = 0; t < 8; ++t) {
+                threads.emplace_back([&, t] {
+                    for (int i = 0; i < 200; ++i) {
+                        auto j = (i + t) % templates.size();
+                        std::string result;
+                        Teng::Error_t err;
+                        Teng::StringWriter_t writer(result);
+                        Teng::Teng_t::GenPageArgs_t args;
+                        args.templateString = templates[j];
+                        args.paramsFilename = TEST_ROOT "teng.conf";
+                        args.dictFilename = TEST_ROOT "dict.txt";
+                        teng.generatePage(args, root, writer, err);
+                        if (result != expected[j]) ++mismatches;
+                    }
+                });
+            }
+            for (auto &thread: threads) thread.join();
+
+            THEN("Every thread gets the right page") {
+                REQUIRE(mismatches == 0);
+            }
+        }
+    }
+}
+
+SCENARIO(
+    "Rendering prepared templates",
+    "[cache]"
+) {
+    GIVEN("Template prepared from string") {
+        Teng::Error_t err;
+        Teng::Teng_t teng(TEST_ROOT);
+        Teng::Teng_t::GenPageArgs_t args;
+        args.templateString = "#{html_small}${var}";
+        args.paramsFilename = TEST_ROOT "teng.conf";
+        args.dictFilename = TEST_ROOT "dict.txt";
+        auto handle = teng.prepare(args, err);
+
+        WHEN("Rendered several times with different data") {
+            std::vector<std::string> results;
+            for (auto value: {"a", "b", "c"}) {
+                Teng::Fragment_t root;
+                root.addVariable("var", value);
+                std::string result;
+                Teng::StringWriter_t writer(result);
+                teng.render(handle, root, writer, err);
+                results.push_back(result);
+            }
+
+            THEN("Each page matches the data") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(static_cast<bool>(handle));
+                REQUIRE(results[0] == "&amp;&lt;b&gt;a");
+                REQUIRE(results[1] == "&amp;&lt;b&gt;b");
+                REQUIRE(results[2] == "&amp;&lt;b&gt;c");
+            }
+        }
+    }
+
+    GIVEN("Empty template handle") {
+        Teng::Teng_t teng(TEST_ROOT);
+        Teng::TemplateHandle_t handle;
+
+        WHEN("Rendered") {
+            Teng::Error_t err;
+            Teng::Fragment_t root;
+            std::string result;
+            Teng::StringWriter_t writer(result);
+            auto level = teng.render(handle, root, writer, err);
+
+            THEN("The error is reported") {
+                std::vector<Teng::Error_t::Entry_t> errs = {{
+                    Teng::Error_t::ERROR,
+                    {0, 0},
+                    "Teng::render(): the template handle is empty"
+                }};
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(level == Teng::Error_t::ERROR);
+                REQUIRE(result == "");
+            }
+        }
+    }
+}
+
+SCENARIO(
+    "Evicting templates from memory limited cache",
+    "[cache]"
+) {
+    GIVEN("Engine with small memory budget for templates") {
+        Teng::Teng_t teng(TEST_ROOT, Teng::Teng_t::Settings_t(0, 0, 0, 8192));
+        Teng::Fragment_t root;
+        root.addVariable("var", "(x)");
+
+        WHEN("Many different templates are generated") {
+            for (int i = 0; i < 32; ++i) {
+                std::string result;
+                Teng::Error_t err;
+                Teng::StringWriter_t writer(result);
+                Teng::Teng_t::GenPageArgs_t args;
+                args.templateString = std::to_string(i) + ":${var}";
+                teng.generatePage(args, root, writer, err);
+            }
+
+            THEN("The cache keeps the budget and counts evictions") {
+                auto stats = teng.getCacheStats();
+                REQUIRE(stats.programs.bytes <= 8192);
+                REQUIRE(stats.programs.bytes > 0);
+                REQUIRE(stats.programs.entries < 32);
+                REQUIRE(stats.programs.misses == 32);
+                REQUIRE(stats.programs.hits == 0);
+                REQUIRE(stats.programs.evictions == 32 - stats.programs.entries);
+            }
+        }
+
+        WHEN("One template is generated repeatedly") {
+            for (int i = 0; i < 3; ++i) {
+                std::string result;
+                Teng::Error_t err;
+                Teng::StringWriter_t writer(result);
+                Teng::Teng_t::GenPageArgs_t args;
+                args.templateString = "${var}";
+                teng.generatePage(args, root, writer, err);
+            }
+
+            THEN("The later lookups hit the cache") {
+                auto stats = teng.getCacheStats();
+                REQUIRE(stats.programs.entries == 1);
+                REQUIRE(stats.programs.misses == 1);
+                REQUIRE(stats.programs.hits == 2);
+                REQUIRE(stats.programs.evictions == 0);
+                REQUIRE(stats.configurations.entries == 1);
+                REQUIRE(stats.dictionaries.entries == 1);
+            }
+        }
+    }
+}
+
+namespace {
+
+/** Filesystem whose files can be changed by tests.
+ */
+struct MutableFilesystem_t: public Teng::FilesystemInterface_t {
+    std::string read(const std::string &filename) const override {
+        std::lock_guard<std::mutex> lock(mutex);
+        return files.at(filename).first;
+    }
+
+    std::size_t hash(const std::string &filename) const override {
+        std::lock_guard<std::mutex> lock(mutex);
+        return files.at(filename).second;
+    }
+
+    void write(const std::string &filename, const std::string &data) {
+        std::lock_guard<std::mutex> lock(mutex);
+        files[filename] = {data, ++version};
+    }
+
+    mutable std::mutex mutex;
+    std::map<std::string, std::pair<std::string, std::size_t>> files;
+    std::size_t version = 0;
+};
+
+/** Generates page from template file until it matches expected result or
+ * timeout expires.
+ */
+std::string wait_for_page(
+    Teng::Teng_t &teng,
+    const std::string &filename,
+    const std::string &expected
+) {
+    std::string result;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    do {
+        result.clear();
+        Teng::Error_t err;
+        Teng::Fragment_t root;
+        Teng::StringWriter_t writer(result);
+        Teng::Teng_t::GenPageArgs_t args;
+        args.templateFilename = filename;
+        teng.generatePage(args, root, writer, err);
+        if (result == expected) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    } while (std::chrono::steady_clock::now() < deadline);
+    return result;
+}
+
+} // namespace
+
+SCENARIO(
+    "Watching template files for changes",
+    "[cache]"
+) {
+    GIVEN("Engine with custom filesystem that has to be polled") {
+        auto fs = std::make_shared<MutableFilesystem_t>();
+        fs->write("page.html", "first<?teng include file='inc.html'?>");
+        fs->write("inc.html", "-a");
+        Teng::Teng_t teng(fs);
+        REQUIRE(wait_for_page(teng, "page.html", "first-a") == "first-a");
+
+        WHEN("The included file changes") {
+            fs->write("inc.html", "-b");
+
+            THEN("The page is eventually regenerated") {
+                REQUIRE(wait_for_page(teng, "page.html", "first-b") == "first-b");
+            }
+        }
+    }
+
+    GIVEN("Engine with real filesystem") {
+        char dir[] = "/tmp/teng-watch-XXXXXX";
+        REQUIRE(::mkdtemp(dir));
+        std::string root = dir;
+        std::ofstream(root + "/page.html") << "first";
+        Teng::Teng_t teng(root);
+        REQUIRE(wait_for_page(teng, "page.html", "first") == "first");
+
+        WHEN("The template file is replaced") {
+            std::ofstream(root + "/page.tmp") << "second page";
+            std::rename((root + "/page.tmp").c_str(), (root + "/page.html").c_str());
+
+            THEN("The page is eventually regenerated") {
+                auto result = wait_for_page(teng, "page.html", "second page");
+                REQUIRE(result == "second page");
+            }
+        }
+
+        ::unlink((root + "/page.html").c_str());
+        ::rmdir(dir);
+    }
+}
+
+SCENARIO(
+    "Revalidating prepared templates",
+    "[cache]"
+) {
+    GIVEN("Template file prepared by engine with real filesystem") {
+        char dir[] = "/tmp/teng-watch-XXXXXX";
+        REQUIRE(::mkdtemp(dir));
+        std::string root = dir;
+        std::ofstream(root + "/page.html") << "first";
+        Teng::Teng_t teng(root);
+        Teng::Error_t err;
+        Teng::Teng_t::GenPageArgs_t args;
+        args.templateFilename = "page.html";
+        auto handle = teng.prepare(args, err);
+        auto render = [&] {
+            std::string result;
+            Teng::Fragment_t data;
+            Teng::StringWriter_t writer(result);
+            teng.render(handle, data, writer, err);
+            return result;
+        };
+
+        WHEN("Rendered repeatedly while no file changes") {
+            REQUIRE(render() == "first");
+            auto hits = teng.getCacheStats().programs.hits;
+            for (int i = 0; i < 10; ++i) REQUIRE(render() == "first");
+
+            THEN("The cache is not asked again") {
+                REQUIRE(teng.getCacheStats().programs.hits == hits);
+            }
+        }
+
+        WHEN("The template file is replaced") {
+            REQUIRE(render() == "first");
+            std::ofstream(root + "/page.tmp") << "second page";
+            std::rename((root + "/page.tmp").c_str(), (root + "/page.html").c_str());
+            std::string result;
+            auto deadline = std::chrono::steady_clock::now()
+                + std::chrono::seconds(5);
+            while ((result = render()) != "second page") {
+                if (std::chrono::steady_clock::now() > deadline) break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+
+            THEN("The handle renders the fresh template from then on") {
+                REQUIRE(result == "second page");
+                REQUIRE(render() == "second page");
+                auto hits = teng.getCacheStats().programs.hits;
+                REQUIRE(render() == "second page");
+                REQUIRE(teng.getCacheStats().programs.hits == hits);
+            }
+        }
+
+        ::unlink((root + "/page.html").c_str());
+        ::rmdir(dir);
+    }
+}
+
+SCENARIO(
+    "Limiting the template change checks by interval",
+    "[cache]"
+) {
+    GIVEN("Template checked at most once per minute") {
+        auto fs = std::make_shared<MutableFilesystem_t>();
+        fs->write("teng.conf", "%checkinterval 1m\n");
+        fs->write("page.html", "first");
+        Teng::Teng_t teng(fs);
+        Teng::Teng_t::GenPageArgs_t args;
+        args.templateFilename = "page.html";
+        args.paramsFilename = "teng.conf";
+
+        auto generate = [&] {
+            std::string result;
+            Teng::Error_t err;
+            Teng::Fragment_t root;
+            Teng::StringWriter_t writer(result);
+            teng.generatePage(args, root, writer, err);
+            return result;
+        };
+        REQUIRE(generate() == "first");
+
+        WHEN("The template changes right after it has been checked") {
+            fs->write("page.html", "second");
+
+            THEN("The cached page is still used") {
+                REQUIRE(generate() == "first");
+                REQUIRE(generate() == "first");
+            }
+        }
+    }
+
+    GIVEN("Configuration with invalid interval") {
+        auto fs = std::make_shared<MutableFilesystem_t>();
+        fs->write("teng.conf", "%checkinterval 2h\n");
+        Teng::Teng_t teng(fs);
+
+        WHEN("Page is generated") {
+            std::string result;
+            Teng::Error_t err;
+            Teng::Fragment_t root;
+            Teng::StringWriter_t writer(result);
+            Teng::Teng_t::GenPageArgs_t args;
+            args.templateString = "text";
+            args.paramsFilename = "teng.conf";
+            teng.generatePage(args, root, writer, err);
+
+            THEN("The warning is reported") {
+                std::vector<Teng::Error_t::Entry_t> errs = {{
+                    Teng::Error_t::WARNING,
+                    {"teng.conf", 1, 14},
+                    "Invalid duration value of checkinterval directive '2h'; "
+                    "use number followed by one of units {ms, s, m}"
+                }};
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "text");
+            }
+        }
+    }
+}
+
+SCENARIO(
+    "Compiling template once for many concurrent requests",
+    "[cache]"
+) {
+    GIVEN("Filesystem with slowly readable template") {
+        struct SlowFilesystem_t: public MutableFilesystem_t {
+            std::string read(const std::string &filename) const override {
+                ++reads;
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                return MutableFilesystem_t::read(filename);
+            }
+            mutable std::atomic<int> reads{0};
+        };
+        auto fs = std::make_shared<SlowFilesystem_t>();
+        fs->write("page.html", "${var}");
+        Teng::Teng_t teng(fs);
+
+        WHEN("Many threads generate the page at once") {
+            Teng::Fragment_t root;
+            root.addVariable("var", "value");
+
+            std::atomic<int> mismatches{0};
+            std::vector<std::thread> threads;
+            for (int t = 0; t < 8; ++t) {
+                threads.emplace_back([&] {
+                    std::string result;
+                    Teng::Error_t err;
+                    Teng::StringWriter_t writer(result);
+                    Teng::Teng_t::GenPageArgs_t args;
+                    args.templateFilename = "page.html";
+                    teng.generatePage(args, root, writer, err);
+                    if (result != "value") ++mismatches;
+                });
+            }
+            for (auto &thread: threads) thread.join();
+
+            THEN("The template is compiled only once") {
+                REQUIRE(mismatches == 0);
+                REQUIRE(fs->reads == 1);
+                REQUIRE(teng.getCacheStats().programs.entries == 1);
+            }
+        }
+    }
+}
+
+SCENARIO(
+    "Preloading templates into the cache",
+    "[cache]"
+) {
+    GIVEN("Engine and list of templates") {
+        auto fs = std::make_shared<MutableFilesystem_t>();
+        fs->write("a.html", "a");
+        fs->write("b.html", "b<?teng endif?>");
+        fs->write("c.html", "c");
+        Teng::Teng_t teng(fs);
+        std::vector<Teng::Teng_t::GenPageArgs_t> list(3);
+        list[0].templateFilename = "a.html";
+        list[1].templateFilename = "b.html";
+        list[2].templateFilename = "c.html";
+
+        WHEN("The templates are preloaded") {
+            auto results = teng.preload(list, 2);
+
+            THEN("They are compiled and cached") {
+                REQUIRE(results.size() == 3);
+                REQUIRE(results[0].errors.empty());
+                REQUIRE(!results[1].errors.empty());
+                REQUIRE(results[2].errors.empty());
+                auto stats = teng.getCacheStats();
+                REQUIRE(stats.programs.entries == 3);
+                REQUIRE(stats.programs.misses == 3);
+            }
+
+            THEN("The page generation hits the cache") {
+                std::string result;
+                Teng::Error_t err;
+                Teng::Fragment_t root;
+                Teng::StringWriter_t writer(result);
+                teng.generatePage(list[2], root, writer, err);
+                REQUIRE(result == "c");
+                REQUIRE(teng.getCacheStats().programs.hits == 1);
+            }
+        }
+    }
+}
+
+SCENARIO(
+    "Persisting compiled templates to bytecode directory",
+    "[cache]"
+) {
+    GIVEN("Two engines sharing the bytecode directory") {
+        struct CountingFilesystem_t: public MutableFilesystem_t {
+            std::string read(const std::string &filename) const override {
+                ++reads;
+                return MutableFilesystem_t::read(filename);
+            }
+            mutable std::atomic<int> reads{0};
+        };
+        char dir[] = "/tmp/teng-bytecode-XXXXXX";
+        REQUIRE(::mkdtemp(dir));
+        auto fs = std::make_shared<CountingFilesystem_t>();
+        fs->write("page.html", "<?teng set .x = 'a'?>${.x}-${var =~ /B+/i}");
+        Teng::Teng_t::Settings_t settings;
+        settings.bytecodeDir = dir;
+
+        auto generate = [&] (Teng::Teng_t &teng) {
+            std::string result;
+            Teng::Error_t err;
+            Teng::Fragment_t root;
+            root.addVariable("var", "b");
+            Teng::StringWriter_t writer(result);
+            Teng::Teng_t::GenPageArgs_t args;
+            args.templateFilename = "page.html";
+            teng.generatePage(args, root, writer, err);
+            return result;
+        };
+
+        Teng::Teng_t first(fs, settings);
+        REQUIRE(generate(first) == "a-1");
+        REQUIRE(fs->reads == 1);
+
+        WHEN("The other engine generates the same page") {
+            Teng::Teng_t second(fs, settings);
+            auto result = generate(second);
+
+            THEN("The program is loaded instead of compiled") {
+                REQUIRE(result == "a-1");
+                REQUIRE(fs->reads == 1);
+            }
+        }
+
+        WHEN("The template changes before the other engine starts") {
+            fs->write("page.html", "${var}");
+            Teng::Teng_t second(fs, settings);
+            auto result = generate(second);
+
+            THEN("The program is compiled again") {
+                REQUIRE(result == "b");
+                REQUIRE(fs->reads == 2);
+            }
+        }
+
+        WHEN("The loaded program reports runtime warning") {
+            auto warn = [&] (Teng::Teng_t &teng) {
+                std::string result;
+                Teng::Error_t err;
+                Teng::Fragment_t root;
+                root.addFragment("sample");
+                Teng::StringWriter_t writer(result);
+                Teng::Teng_t::GenPageArgs_t args;
+                args.templateFilename = "warn.html";
+                teng.generatePage(args, root, writer, err);
+                return err.getEntries();
+            };
+            fs->write("warn.html", "x\n  ${sample}");
+            auto compiled = warn(first);
+            Teng::Teng_t second(fs, settings);
+            auto loaded = warn(second);
+
+            THEN("It points to the same position in template") {
+                REQUIRE(fs->reads == 2);
+                REQUIRE(compiled.size() == 1);
+                REQUIRE(compiled[0].pos.lineno == 2);
+                ERRLOG_TEST(loaded, compiled);
+            }
+        }
+
+        if (auto *dirp = ::opendir(dir)) {
+            while (auto *entry = ::readdir(dirp))
+                if (entry->d_name[0] != '.')
+                    ::unlink((std::string(dir) + "/" + entry->d_name).c_str());
+            ::closedir(dirp);
+        }
+        ::rmdir(dir);
+    }
+}
+
+SCENARIO(
+    "Sharing compiled templates between forked processes",
+    "[cache]"
+) {
+    GIVEN("Engine with shared memory cache") {
+        struct CountingFilesystem_t: public MutableFilesystem_t {
+            std::string read(const std::string &filename) const override {
+                ++reads;
+                return MutableFilesystem_t::read(filename);
+            }
+            mutable std::atomic<int> reads{0};
+        };
+        auto fs = std::make_shared<CountingFilesystem_t>();
+        fs->write("page.html", "${var}");
+        Teng::Teng_t::Settings_t settings;
+        settings.sharedCacheBytes = 1024 * 1024;
+        Teng::Teng_t teng(fs, settings);
+
+        auto generate = [&] {
+            std::string result;
+            Teng::Error_t err;
+            Teng::Fragment_t root;
+            root.addVariable("var", "value");
+            Teng::StringWriter_t writer(result);
+            Teng::Teng_t::GenPageArgs_t args;
+            args.templateFilename = "page.html";
+            teng.generatePage(args, root, writer, err);
+            return result;
+        };
+
+        WHEN("The forked worker generates the page") {
+            auto pid = ::fork();
+            if (pid == 0) ::_exit(generate() == "value"? 0: 1);
+            int status = -1;
+            REQUIRE(::waitpid(pid, &status, 0) == pid);
+            REQUIRE(WIFEXITED(status));
+            REQUIRE(WEXITSTATUS(status) == 0);
+
+            THEN("The other process uses the program compiled by worker") {
+                REQUIRE(generate() == "value");
+                REQUIRE(fs->reads == 0);
+            }
+        }
+    }
+}
@@ -2314,3 +2314,69 @@ SCENARIO(
     }
 }
 
+
+SCENARIO(
+    "The conditional statement with constant conditions",
+    "[cond]"
+) {
+    GIVEN("If statement with constant and variable conditions") {
+        std::string t = "before"
+                        "<?teng if 0?>first"
+                        "<?teng elif $var?>second"
+                        "<?teng elif 1?>third"
+                        "<?teng else?>fourth"
+                        "<?teng endif?>"
+                        "after";
+
+        WHEN("The variable is true") {
+            Teng::Error_t err;
+            Teng::Fragment_t root;
+            root.addVariable("var", 1);
+            auto result = g(err, t, root);
+
+            THEN("The result contains the branch with variable condition") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "beforesecondafter");
+            }
+        }
+
+        WHEN("The variable is false") {
+            Teng::Error_t err;
+            Teng::Fragment_t root;
+            root.addVariable("var", 0);
+            auto result = g(err, t, root);
+
+            THEN("The result contains the first branch with true condition") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "beforethirdafter");
+            }
+        }
+    }
+
+    GIVEN("Nested if statements with constant conditions") {
+        std::string t = "<?teng if 1?>"
+                        "<?teng frag row?>"
+                        "<?teng if 0?>zero<?teng elif 1 + 1?>${val}"
+                        "<?teng endif?>"
+                        "<?teng endfrag?>"
+                        "<?teng elif $var?>var"
+                        "<?teng endif?>";
+
+        WHEN("The template is rendered") {
+            Teng::Error_t err;
+            Teng::Fragment_t root;
+            root.addFragment("row").addVariable("val", "a");
+            root.addFragment("row").addVariable("val", "b");
+            auto result = g(err, t, root);
+
+            THEN("The result contains the true branches") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "ab");
+            }
+        }
+    }
+}
+
@@ -34,6 +34,9 @@
  *             Created.
  */
 
+#include <sstream>
+#include <algorithm>
+
 #include <teng/teng.h>
 
 #include "catch2/catch_test_macros.hpp"
@@ -73,6 +76,7 @@ SCENARIO(
                      "    logtooutput: disabled\n"
                      "    bytecode: enabled\n"
                      "    watchfiles: enabled\n"
+                     "    checkinterval: 0ms\n"
                      "    maxincludedepth: 10\n"
                      "    maxdebugvallength: 40\n"
                      "    format: enabled\n"
@@ -174,6 +178,169 @@ SCENARIO(
     }
 }
 
+SCENARIO(
+    "The folded if statements",
+    "[debug]"
+) {
+    GIVEN("If statement with constant conditions") {
+        Teng::Fragment_t root;
+        root.addVariable("var", 1);
+        std::string t = "a<?teng if 1?>x<?teng else?>y<?teng endif?>"
+                        "b<?teng bytecode?>";
+
+        WHEN("Generated with bytecode fragment enabled") {
+            Teng::Error_t err;
+            auto result = g(err, t, root, "teng.debug.conf", "cs");
+            auto r = "000 PRINT_VAL           &lt;value=axb,type=string&gt;\n"
+                     "001 PRINT               &lt;print_escape=false,"
+                         "unoptimizable=false&gt;\n"
+                     "002 BYTECODE_FRAG       \n"
+                     "003 HALT                \n";
+
+            THEN("The if statement is replaced with the true branch") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == (std::string("axb") + r));
+            }
+        }
+    }
+
+    GIVEN("If statement with constant and variable conditions") {
+        Teng::Fragment_t root;
+        root.addVariable("var", 1);
+        std::string t = "a<?teng if 0?>x<?teng elif var?>y"
+                        "<?teng elif 1?>z<?teng else?>w<?teng endif?>"
+                        "<?teng bytecode?>";
+
+        WHEN("Generated with bytecode fragment enabled") {
+            Teng::Error_t err;
+            auto result = g(err, t, root, "teng.debug.conf", "cs");
+            auto r = "000 PRINT_VAL           &lt;value=a,type=string&gt;\n"
+                     "001 PRINT               &lt;print_escape=false,"
+                         "unoptimizable=false&gt;\n"
+                     "002 JMP_IF_VAR_NOT      &lt;name=var,escape=true,"
+                         "frame-offset=0,frag-offset=0&gt;\n"
+                     "003 JMP_IF_NOT          &lt;jump=+3&gt;\n"
+                     "004 PRINT_VAL           &lt;value=y,type=string&gt;\n"
+                     "005 PRINT               &lt;print_escape=false,"
+                         "unoptimizable=false&gt;\n"
+                     "006 JMP                 &lt;jump=+2&gt;\n"
+                     "007 PRINT_VAL           &lt;value=z,type=string&gt;\n"
+                     "008 PRINT               &lt;print_escape=false,"
+                         "unoptimizable=false&gt;\n"
+                     "009 NOOP                \n"
+                     "010 BYTECODE_FRAG       \n"
+                     "011 HALT                \n";
+
+            THEN("Only the branches that can be taken are kept") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == (std::string("ay") + r));
+            }
+        }
+    }
+}
+
+SCENARIO(
+    "The folded case expressions",
+    "[debug]"
+) {
+    GIVEN("Case expression with constant subject") {
+        Teng::Fragment_t root;
+        root.addVariable("var", 1);
+        std::string t = "${case(2, 1: 'a', 2: var, *: 'c')}<?teng bytecode?>";
+
+        WHEN("Generated with bytecode fragment enabled") {
+            Teng::Error_t err;
+            auto result = g(err, t, root, "teng.debug.conf", "cs");
+            auto r = "000 PRINT_VAR           &lt;name=var,escape=true,"
+                         "frame-offset=0,frag-offset=0&gt;\n"
+                     "001 PRINT               &lt;print_escape=true,"
+                         "unoptimizable=false&gt;\n"
+                     "002 BYTECODE_FRAG       \n"
+                     "003 HALT                \n";
+
+            THEN("The case is replaced with the taken branch") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == (std::string("1") + r));
+            }
+        }
+    }
+}
+
+SCENARIO(
+    "The fused instructions",
+    "[debug]"
+) {
+    GIVEN("Template with variables printed and used in conditions") {
+        Teng::Fragment_t root;
+        root.addVariable("var", 1);
+        std::string t = "${var}<?teng if var?>x<?teng endif?>"
+                        "${var ? var : 'b'}<?teng bytecode?>";
+
+        WHEN("Generated with bytecode fragment enabled") {
+            Teng::Error_t err;
+            auto result = g(err, t, root, "teng.debug.conf", "cs");
+            auto r = "000 PRINT_VAR           &lt;name=var,escape=true,"
+                         "frame-offset=0,frag-offset=0&gt;\n"
+                     "001 PRINT               &lt;print_escape=true,"
+                         "unoptimizable=false&gt;\n"
+                     "002 JMP_IF_VAR_NOT      &lt;name=var,escape=true,"
+                         "frame-offset=0,frag-offset=0&gt;\n"
+                     "003 JMP_IF_NOT          &lt;jump=+2&gt;\n"
+                     "004 PRINT_VAL           &lt;value=x,type=string&gt;\n"
+                     "005 PRINT               &lt;print_escape=false,"
+                         "unoptimizable=false&gt;\n"
+                     "006 NOOP                \n"
+                     "007 JMP_IF_VAR_NOT      &lt;name=var,escape=true,"
+                         "frame-offset=0,frag-offset=0&gt;\n"
+                     "008 JMP_IF_NOT          &lt;jump=+2&gt;\n"
+                     "009 VAR                 &lt;name=var,escape=true,"
+                         "frame-offset=0,frag-offset=0&gt;\n"
+                     "010 JMP                 &lt;jump=+1&gt;\n"
+                     "011 VAL                 &lt;value=b,type=string&gt;\n"
+                     "012 NOOP                \n"
+                     "013 PRINT               &lt;print_escape=true,"
+                         "unoptimizable=false&gt;\n"
+                     "014 BYTECODE_FRAG       \n"
+                     "015 HALT                \n";
+
+            THEN("The sequences not jumped into are fused") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == (std::string("1x1") + r));
+            }
+        }
+    }
+
+    GIVEN("Template printing undefined variable") {
+        Teng::Fragment_t root;
+        std::string t = "<?teng if missing?>a<?teng endif?>\n  ${missing}";
+
+        WHEN("Generated") {
+            Teng::Error_t err;
+            auto result = g(err, t, root);
+
+            THEN("The warnings point to the variables") {
+                std::vector<Teng::Error_t::Entry_t> errs = {{
+                    Teng::Error_t::WARNING,
+                    {1, 10},
+                    "Runtime: Variable '.missing' is undefined "
+                    "[open_frags=., iteration=0/1]"
+                }, {
+                    Teng::Error_t::WARNING,
+                    {2, 4},
+                    "Runtime: Variable '.missing' is undefined "
+                    "[open_frags=., iteration=0/1]"
+                }};
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "\n  undefined");
+            }
+        }
+    }
+}
+
 SCENARIO(
     "The error fragment",
     "[debug]"
@@ -259,3 +426,193 @@ SCENARIO(
     }
 }
 
+SCENARIO(
+    "The profile of rendering",
+    "[debug]"
+) {
+    GIVEN("Template with fragment and function") {
+        Teng::Error_t err;
+        Teng::Teng_t teng(TEST_ROOT);
+        Teng::Teng_t::GenPageArgs_t args;
+        args.templateString
+            = "<?teng frag row?>${name}<?teng endfrag?>\n"
+              "${len(text)}";
+        args.paramsFilename = TEST_ROOT "teng.conf";
+        auto handle = teng.prepare(args, err);
+
+        Teng::Fragment_t root;
+        root.addVariable("text", "abc");
+        for (auto name: {"a", "b", "c"})
+            root.addFragment("row").addVariable("name", name);
+
+        WHEN("The template is rendered twice with the same profile") {
+            Teng::Profile_t profile;
+            std::vector<std::string> results(2);
+            for (auto &result: results) {
+                Teng::StringWriter_t writer(result);
+                teng.render(handle, root, writer, err, &profile);
+            }
+
+            THEN("The output is the same as without profile") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(results[0] == "abc\n3");
+                REQUIRE(results[1] == "abc\n3");
+            }
+
+            THEN("The counters of both renders are summed") {
+                auto &instrs = profile.instructions();
+                auto iprint = std::find_if(
+                    instrs.begin(),
+                    instrs.end(),
+                    [] (auto &instr) {return instr.opcode == "PRINT_VAR";}
+                );
+                REQUIRE(iprint != instrs.end());
+                REQUIRE(iprint->pos.lineno == 1);
+                REQUIRE(iprint->pos.colno == 19);
+                REQUIRE(iprint->counters.executions == 6);
+            }
+
+            THEN("The counters are summed by opcodes and lines") {
+                auto opcodes = profile.opcodes();
+                auto ifunc = std::find_if(
+                    opcodes.begin(),
+                    opcodes.end(),
+                    [] (auto &opcode) {return opcode.opcode == "FUNC";}
+                );
+                REQUIRE(ifunc != opcodes.end());
+                REQUIRE(ifunc->counters.executions == 2);
+
+                auto lines = profile.lines();
+                auto iline = std::find_if(
+                    lines.begin(),
+                    lines.end(),
+                    [] (auto &line) {return line.lineno == 2;}
+                );
+                REQUIRE(iline != lines.end());
+                REQUIRE(iline->counters.executions >= ifunc->counters.executions);
+                uint64_t executions = 0;
+                for (auto &line: lines)
+                    executions += line.counters.executions;
+                REQUIRE(executions == profile.total().executions);
+            }
+
+            THEN("The hottest lines can be logged") {
+                Teng::Error_t log;
+                profile.log(log, 1);
+                auto entries = log.getEntries();
+                REQUIRE(entries.size() == 1);
+                REQUIRE(entries[0].level == Teng::Error_t::DEBUGING);
+                REQUIRE(entries[0].msg.find("Profile: executions=") == 0);
+            }
+        }
+    }
+}
+
+SCENARIO(
+    "The profiles of different templates logged into one error log",
+    "[debug]"
+) {
+    GIVEN("Two profiles of instructions in different files") {
+        Teng::Profile_t first;
+        first.add({{"first.html", 1, 0}, 0, "PRINT", {1, 10}});
+        Teng::Profile_t second;
+        second.add({{"second.html", 2, 0}, 0, "PRINT", {1, 20}});
+
+        WHEN("Both profiles are logged into the same error log") {
+            Teng::Error_t log;
+            first.log(log, 1);
+            second.log(log, 1);
+
+            THEN("The entries keep the filenames of their profiles") {
+                auto entries = log.getEntries();
+                REQUIRE(entries.size() == 2);
+                REQUIRE(entries[0].pos.filename == "first.html");
+                REQUIRE(entries[0].pos.lineno == 1);
+                REQUIRE(entries[1].pos.filename == "second.html");
+                REQUIRE(entries[1].pos.lineno == 2);
+            }
+        }
+    }
+}
+
+SCENARIO(
+    "The sampled stacks of rendering",
+    "[debug]"
+) {
+    GIVEN("Template with blocks, include and fragment") {
+        Teng::Error_t err;
+        Teng::Teng_t teng(TEST_ROOT);
+        Teng::Teng_t::GenPageArgs_t args;
+        args.templateString
+            = "<?teng extends file='base.html'?>"
+              "<?teng override block body?>"
+              "<?teng frag row?>${name}<?teng endfrag?>"
+              "<?teng include file='subdir/head.html'?>"
+              "<?teng endoverride block?>"
+              "<?teng endextends?>";
+        args.paramsFilename = TEST_ROOT "teng.conf";
+        auto handle = teng.prepare(args, err);
+
+        Teng::Fragment_t root;
+        for (auto name: {"a", "b", "c"})
+            root.addFragment("row").addVariable("name", name);
+
+        WHEN("Each instruction is sampled") {
+            Teng::Profile_t counts;
+            Teng::Profile_t samples(1);
+            std::vector<std::string> results(2);
+            Teng::StringWriter_t counts_writer(results[0]);
+            teng.render(handle, root, counts_writer, err, &counts);
+            Teng::StringWriter_t samples_writer(results[1]);
+            teng.render(handle, root, samples_writer, err, &samples);
+
+            THEN("The output is the same as without profile") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(results[0] == results[1]);
+                REQUIRE(samples.instructions().empty());
+            }
+
+            THEN("Each executed instruction has its sample") {
+                uint64_t total = 0;
+                for (auto &sample: samples.samples())
+                    total += sample.second;
+                REQUIRE(total == counts.total().executions);
+            }
+
+            THEN("The stacks contain blocks, fragments and includes") {
+                auto &stacks = samples.samples();
+                auto contains = [&] (const std::string &stack) {
+                    return stacks.find(stack) != stacks.end();
+                };
+                REQUIRE(contains("(no file);block:body;frag:row;(no file):1"));
+                REQUIRE(contains(
+                    "(no file);subdir/head.html;block:body;subdir/head.html:1"
+                ));
+                REQUIRE(contains("(no file);base.html;base.html:1"));
+            }
+        }
+
+        WHEN("Every fourth instruction is sampled") {
+            Teng::Profile_t counts;
+            Teng::Profile_t samples(4);
+            std::string result;
+            Teng::StringWriter_t writer(result);
+            teng.render(handle, root, writer, err, &counts);
+            for (int i = 0; i < 4; ++i)
+                teng.render(handle, root, writer, err, &samples);
+
+            THEN("The samples are written in folded stack format") {
+                std::ostringstream os;
+                samples.dumpFolded(os);
+                std::istringstream is(os.str());
+                uint64_t total = 0;
+                for (std::string line; std::getline(is, line);)
+                    total += std::stoull(line.substr(line.rfind(' ') + 1));
+                REQUIRE(total == 4 * (counts.total().executions / 4));
+            }
+        }
+    }
+}
+
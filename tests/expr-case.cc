@@ -1010,3 +1010,75 @@ SCENARIO(
     }
 }
 
+
+SCENARIO(
+    "The case with constant subject",
+    "[expr][case]"
+) {
+    GIVEN("Some variables") {
+        Teng::Fragment_t root;
+        root.addVariable("a", "(a)");
+        root.addVariable("b", "(b)");
+        root.addVariable("c", "(c)");
+
+        WHEN("The subject matches one of alternatives") {
+            Teng::Error_t err;
+            auto t = "${case(1 + 2, 1: $a, 2, 3: $b, *: $c)}";
+            auto result = g(err, t, root);
+
+            THEN("The matching branch is choosen") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "(b)");
+            }
+        }
+
+        WHEN("The subject matches no label") {
+            Teng::Error_t err;
+            auto t = "${case('x', 1: $a, 'y': $b, *: $c)}";
+            auto result = g(err, t, root);
+
+            THEN("The default branch is choosen") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "(c)");
+            }
+        }
+
+        WHEN("The subject matches no label and there is no default branch") {
+            Teng::Error_t err;
+            auto t = "${case(4, 1: $a, 2: $b)}";
+            auto result = g(err, t, root);
+
+            THEN("Result is undefined") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "undefined");
+            }
+        }
+
+        WHEN("The string subject is compared with numeric label") {
+            Teng::Error_t err;
+            auto t = "${case('1', 1: $a, *: $c)}";
+            auto result = g(err, t, root);
+
+            THEN("They are compared as strings") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "(a)");
+            }
+        }
+
+        WHEN("The choosen branch contains case with variable subject") {
+            Teng::Error_t err;
+            auto t = "${case(2, 1: $a, 2: case($b, '(b)': 'nested', *: $c))}";
+            auto result = g(err, t, root);
+
+            THEN("The nested case is evaluated") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "nested");
+            }
+        }
+    }
+}
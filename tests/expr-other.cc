@@ -399,3 +399,41 @@ SCENARIO(
     }
 }
 
+SCENARIO(
+    "The deeply nested expressions",
+    "[expr]"
+) {
+    GIVEN("Variables that can't be evaluated in compile time") {
+        Teng::Fragment_t root;
+        root.addVariable("a", 1);
+        root.addVariable("b", 0);
+
+        WHEN("The right operands are nested in parentheses") {
+            Teng::Error_t err;
+            std::string expr = "a";
+            for (int i = 1; i < 64; ++i) expr = "a+(" + expr + ")";
+            auto result = g(err, "${" + expr + "}", root);
+
+            THEN("All operands stay on the value stack until the end") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "64");
+            }
+        }
+
+        WHEN("The conditional operators are nested in operands") {
+            Teng::Error_t err;
+            std::string expr = "a";
+            for (int i = 0; i < 32; ++i)
+                expr = "a + (b? 0: (b || " + expr + ") + (a && a))";
+            auto result = g(err, "${" + expr + "}", root);
+
+            THEN("Each branch leaves one value on the value stack") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "65");
+            }
+        }
+    }
+}
+
@@ -40,6 +40,7 @@
 #include "utils.h"
 
 #include <sstream>
+#include <memory_resource>
 
 SCENARIO(
     "Zero Teng fragments",
@@ -755,3 +756,395 @@ SCENARIO(
 }
 
 
+
+SCENARIO(
+    "The loop invariant expressions in fragments",
+    "[frags]"
+) {
+    GIVEN("Some data with root variable and list of fragments") {
+        Teng::Fragment_t root;
+        root.addVariable("base", "a b");
+        root.addFragment("row").addVariable("id", 1);
+        root.addFragment("row").addVariable("id", 2);
+        root.addFragment("row").addVariable("id", 3);
+
+        WHEN("The expressions referencing outer values are printed") {
+            Teng::Error_t err;
+            auto t = "<?teng frag row?>"
+                     "${urlescape($.base)}/${id}:${_count - 1};"
+                     "<?teng endfrag?>";
+            auto result = g(err, t, root);
+
+            THEN("Their values are the same in each iteration") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "a%20b/1:2;a%20b/2:2;a%20b/3:2;");
+            }
+        }
+
+        WHEN("The expressions are used in nested fragments") {
+            Teng::Error_t err;
+            auto t = "<?teng frag row?>"
+                     "${$.base ++ '-'}${id}"
+                     "<?teng frag .row?>(${id * 10 + _count})<?teng endfrag?>"
+                     "<?teng endfrag?>";
+            auto result = g(err, t, root);
+
+            THEN("Each fragment uses values of its own outer fragments") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "a b-1(13)(23)(33)"
+                                  "a b-2(13)(23)(33)"
+                                  "a b-3(13)(23)(33)");
+            }
+        }
+
+        WHEN("The nested fragments have their own invariant expressions") {
+            Teng::Error_t err;
+            Teng::Fragment_t data;
+            data.addVariable("base", "a b");
+            auto &first = data.addFragment("row");
+            first.addVariable("id", 1);
+            first.addFragment("col").addVariable("v", "x");
+            first.addFragment("col").addVariable("v", "y");
+            data.addFragment("row").addVariable("id", 2);
+            auto &third = data.addFragment("row");
+            third.addVariable("id", 3);
+            third.addFragment("col").addVariable("v", "z");
+            auto t = "<?teng frag row?>"
+                     "${$.base ++ ':'}"
+                     "<?teng frag col?>${$.row.id * 10}${v},<?teng endfrag?>"
+                     "${$.base ++ ';'}"
+                     "<?teng endfrag?>";
+            auto result = g(err, t, data);
+
+            THEN("Each fragment keeps the values of its own expressions") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "a b:10x,10y,a b;"
+                                  "a b:a b;"
+                                  "a b:30z,a b;");
+            }
+        }
+
+        WHEN("The fragment list is empty") {
+            Teng::Error_t err;
+            auto t = "<?teng frag missing?>${$.base ++ '!'}<?teng endfrag?>"
+                     "${$.base ++ '!'}";
+            auto result = g(err, t, root);
+
+            THEN("The expressions are not evaluated in the fragment") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "a b!");
+            }
+        }
+
+        WHEN("The outer variable is set in the fragment") {
+            Teng::Error_t err;
+            auto t = "<?teng set .x = 1?>"
+                     "<?teng frag row?>"
+                     "${$.x * 10};<?teng set .x = $.x + 1?>"
+                     "<?teng endfrag?>";
+            auto result = g(err, t, root);
+
+            THEN("The expressions are evaluated in each iteration") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "10;20;30;");
+            }
+        }
+
+        WHEN("The case expressions are used in the fragment") {
+            Teng::Error_t err;
+            auto t = "<?teng frag row?>"
+                     "${case($.base, 'a b': 'same', *: 'other')}"
+                     "${case(id, 1: $.base, 2: 'two', *: $.base ++ '!')}"
+                     "${$.base ++ '-'};"
+                     "<?teng endfrag?>";
+            auto result = g(err, t, root);
+
+            THEN("The case values don't mix with the hoisted values") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "samea ba b-;"
+                                  "sametwoa b-;"
+                                  "samea b!a b-;");
+            }
+        }
+    }
+}
+
+SCENARIO(
+    "The loop invariant expressions with disabled print escaping",
+    "[frags]"
+) {
+    GIVEN("Some data with root variables and list of fragments") {
+        Teng::Fragment_t root;
+        root.addVariable("c", 0);
+        root.addVariable("a", "<a>");
+        root.addVariable("b", "<b>");
+        root.addFragment("row").addVariable("id", 1);
+        root.addFragment("row").addVariable("id", 2);
+
+        WHEN("The expression ending with outer variable is printed") {
+            Teng::Error_t err;
+            auto t = "<?teng frag row?>${$.c ? $.a : $.b};<?teng endfrag?>"
+                     "${$.c ? $.a : $.b}";
+            auto result = g(err, t, root, "teng.no-escape.conf");
+
+            THEN("The value is escaped as the value outside of fragment") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "&lt;b&gt;;&lt;b&gt;;&lt;b&gt;");
+            }
+        }
+    }
+}
+
+
+SCENARIO(
+    "The loop invariant conditions in fragments",
+    "[frags]"
+) {
+    GIVEN("Some data with root variable and list of fragments") {
+        Teng::Fragment_t root;
+        root.addVariable("text", "abc");
+        for (auto name: {"a", "b", "c"})
+            root.addFragment("row").addVariable("name", name);
+
+        WHEN("The if statement directly in the fragment has invariant condition") {
+            Teng::Error_t err;
+            Teng::Profile_t profile;
+            Teng::Teng_t teng(TEST_ROOT);
+            Teng::Teng_t::GenPageArgs_t args;
+            args.templateString = "<?teng frag row?>"
+                                  "<?teng if len($.text) > 2?>${name}"
+                                  "<?teng else?>-"
+                                  "<?teng endif?>"
+                                  "<?teng endfrag?>";
+            args.paramsFilename = TEST_ROOT "teng.conf";
+            std::string result;
+            Teng::StringWriter_t writer(result);
+            teng.generatePage(args, root, writer, err, &profile);
+
+            THEN("The condition is evaluated once") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "abc");
+                uint64_t executions = 0;
+                for (auto &opcode: profile.opcodes())
+                    if (opcode.opcode == "FUNC")
+                        executions += opcode.counters.executions;
+                REQUIRE(executions == 1);
+            }
+        }
+
+        WHEN("The nested if statement has invariant condition") {
+            Teng::Error_t err;
+            Teng::Profile_t profile;
+            Teng::Teng_t teng(TEST_ROOT);
+            Teng::Teng_t::GenPageArgs_t args;
+            args.templateString = "<?teng frag row?>"
+                                  "<?teng if name != 'b'?>"
+                                  "<?teng if len($.text) > 2?>${name}"
+                                  "<?teng endif?>"
+                                  "<?teng endif?>"
+                                  "<?teng endfrag?>";
+            args.paramsFilename = TEST_ROOT "teng.conf";
+            std::string result;
+            Teng::StringWriter_t writer(result);
+            teng.generatePage(args, root, writer, err, &profile);
+
+            THEN("The condition is evaluated only if the statement is entered") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "ac");
+                uint64_t executions = 0;
+                for (auto &opcode: profile.opcodes())
+                    if (opcode.opcode == "FUNC")
+                        executions += opcode.counters.executions;
+                REQUIRE(executions == 2);
+            }
+        }
+    }
+}
+
+SCENARIO(
+    "The fragment lists referenced while the parent fragment grows",
+    "[frags]"
+) {
+    GIVEN("Some data built through references to nested lists") {
+        Teng::Fragment_t root;
+        auto &rows = root.addFragmentList("row");
+        for (auto i = 0; i < 20; ++i)
+            root.addVariable("var_" + std::to_string(19 - i), i);
+        root.addVariable("aaa", "first");
+        for (auto i = 0; i < 3; ++i)
+            rows.addFragment().addVariable("id", i);
+
+        WHEN("The template is generated") {
+            Teng::Error_t err;
+            auto t = "${aaa}:<?teng frag row?>${id}<?teng endfrag?>:${var_0}";
+            auto result = g(err, t, root);
+
+            THEN("Result contains values added through the references") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "first:012:19");
+            }
+        }
+    }
+}
+
+SCENARIO(
+    "The items of large fragment added in random order",
+    "[frags]"
+) {
+    GIVEN("Some data with many variables added out of order") {
+        Teng::Fragment_t root;
+        for (auto i = 0; i < 30; ++i)
+            root.addVariable("var_" + std::to_string(10 + (i * 7) % 30), i);
+        root.addFragment("row").addVariable("id", 1);
+
+        WHEN("The items are iterated") {
+            std::string names;
+            for (auto &item: root) names += item.first + ",";
+
+            THEN("They are ordered by their names") {
+                std::string expected = "row,";
+                for (auto i = 10; i < 40; ++i)
+                    expected += "var_" + std::to_string(i) + ",";
+                REQUIRE(names == expected);
+            }
+        }
+
+        WHEN("The iteration starts at the found item") {
+            const Teng::Fragment_t &data = root;
+            auto iitem = data.find(std::string("var_37"));
+            std::string names;
+            for (; iitem != data.end(); ++iitem) names += iitem->first + ",";
+
+            THEN("It continues with the items of following names") {
+                REQUIRE(names == "var_37,var_38,var_39,");
+            }
+        }
+    }
+}
+
+SCENARIO(
+    "Looking the fragment items up by string literal",
+    "[frags]"
+) {
+    GIVEN("Some small and some large fragment") {
+        Teng::Fragment_t small;
+        small.addVariable("abc", 1);
+        Teng::Fragment_t large;
+        for (auto i = 0; i < 20; ++i)
+            large.addVariable("var_" + std::to_string(i), i);
+
+        WHEN("The items are found by string literals") {
+            const Teng::Fragment_t &csmall = small;
+            const Teng::Fragment_t &clarge = large;
+            auto ismall = csmall.find("abc");
+            auto ilarge = clarge.find("var_13");
+            auto imissing = clarge.find("var_20");
+
+            THEN("The iterators refer to the items of the names") {
+                REQUIRE(ismall != csmall.end());
+                REQUIRE(*ismall->second.integral() == 1);
+                REQUIRE(ilarge != clarge.end());
+                REQUIRE(*ilarge->second.integral() == 13);
+                REQUIRE(imissing == clarge.end());
+            }
+        }
+    }
+}
+
+SCENARIO(
+    "The data tree built in arena",
+    "[frags]"
+) {
+    GIVEN("Some data built in monotonic buffer") {
+        std::pmr::monotonic_buffer_resource arena;
+        Teng::Fragment_t root(&arena);
+        root.addVariable("title", "rows");
+        for (auto i = 0; i < 3; ++i) {
+            auto &row = root.addFragment("row");
+            row.addVariable("id", i);
+            row.addFragment("nested").addVariable("name", "nested");
+        }
+
+        WHEN("The nested fragments are inspected") {
+            const Teng::Fragment_t &data = root;
+            auto &rows = data.find(std::string("row"))->second;
+            auto *row = (*rows.list())[2].fragment();
+            auto &nested = row->find(std::string("nested"))->second;
+
+            THEN("They are allocated from the arena") {
+                REQUIRE(root.arena() == &arena);
+                REQUIRE(rows.list()->arena() == &arena);
+                REQUIRE(nested.list()->arena() == &arena);
+                REQUIRE(nested.list()->begin()->fragment()->arena() == &arena);
+            }
+        }
+
+        WHEN("The template is generated") {
+            Teng::Error_t err;
+            auto t = "${title}:<?teng frag row?>${id}"
+                     "<?teng frag nested?>${name}<?teng endfrag?>;"
+                     "<?teng endfrag?>";
+            auto result = g(err, t, root);
+
+            THEN("Result contains values from arena") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "rows:0nested;1nested;2nested;");
+            }
+        }
+    }
+}
+
+SCENARIO(
+    "The lazily built fragments",
+    "[frags]"
+) {
+    GIVEN("Some data with fragment lists built by providers") {
+        auto rows_calls = 0;
+        auto hidden_calls = 0;
+        Teng::Fragment_t root;
+        root.addVariable("show", 0);
+        root.addLazyFragmentList("row", Teng::makeFragmentProvider(
+            [&] (Teng::FragmentList_t &list) {
+                ++rows_calls;
+                for (auto i = 0; i < 3; ++i)
+                    list.addFragment().addVariable("id", i);
+            }
+        ));
+        root.addLazyFragmentList("hidden", Teng::makeFragmentProvider(
+            [&] (Teng::FragmentList_t &list) {
+                ++hidden_calls;
+                list.addFragment().addVariable("id", 100);
+            }
+        ));
+
+        WHEN("The template reads only some of them repeatedly") {
+            Teng::Error_t err;
+            auto t = "<?teng frag row?>${id}<?teng endfrag?>:"
+                     "<?teng frag row?>${id}<?teng endfrag?>:"
+                     "${$$.row[1].id}"
+                     "<?teng if show?>"
+                     "<?teng frag hidden?>${id}<?teng endfrag?>"
+                     "<?teng endif?>";
+            auto result = g(err, t, root);
+
+            THEN("Only the read ones are built and just once") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "012:012:1");
+                REQUIRE(rows_calls == 1);
+                REQUIRE(hidden_calls == 0);
+            }
+        }
+    }
+}
@@ -35,6 +35,7 @@
  */
 
 #include <teng/teng.h>
+#include <teng/udf.h>
 #include <unistd.h>
 
 #include "catch2/catch_test_macros.hpp"
@@ -311,3 +312,122 @@ SCENARIO(
     }
 }
 
+
+SCENARIO(
+    "The user defined functions",
+    "[fun][other]"
+) {
+    GIVEN("The function registered before the template is compiled") {
+        Teng::udf::registerFunction(
+            "test_twice",
+            [] (const Teng::udf::Args_t &args) {
+                return Teng::udf::Result_t(2 * args[0].integral());
+            }
+        );
+        Teng::Fragment_t root;
+
+        WHEN("The function is called") {
+            Teng::Error_t err;
+            auto t = "${udf.test_twice(21)}";
+            auto result = g(err, t, root);
+
+            THEN("The result is the function result") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "42");
+            }
+        }
+    }
+
+    GIVEN("The functions taking vector and view of args") {
+        Teng::udf::registerFunction(
+            "test_vector_args",
+            [] (const Teng::udf::Args_t &args) {
+                std::string result;
+                for (auto &arg: args) result += arg.string();
+                return Teng::udf::Result_t(result);
+            }
+        );
+        Teng::udf::registerViewFunction(
+            "test_view_args",
+            [] (const Teng::udf::ArgsView_t &args) {
+                std::string result;
+                for (auto &arg: args) result += arg.string();
+                return Teng::udf::Result_t(result + args.back().string());
+            }
+        );
+        Teng::Fragment_t root;
+
+        WHEN("The functions are called with more args") {
+            Teng::Error_t err;
+            auto t = "${udf.test_vector_args('a', 'b', 'c')}"
+                     "${udf.test_view_args('a', 'b', 'c')}";
+            auto result = g(err, t, root);
+
+            THEN("Both get args in the same order") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "cbacbaa");
+            }
+        }
+
+        WHEN("The functions are looked up as the other kind") {
+            Teng::udf::Args_t args;
+            args.emplace_back("c");
+            args.emplace_back("b");
+            args.emplace_back("a");
+            Teng::Value_t stack[] = {
+                Teng::Value_t("a"),
+                Teng::Value_t("b"),
+                Teng::Value_t("c")
+            };
+            Teng::udf::ArgsView_t view(std::begin(stack), std::end(stack));
+            auto vector_udf = Teng::udf::findViewFunction("udf.test_vector_args");
+            auto view_udf = Teng::udf::findFunction("udf.test_view_args");
+
+            THEN("They get args in the same order") {
+                REQUIRE(vector_udf.function(view).string() == "cba");
+                REQUIRE(view_udf.function(args).string() == "cbaa");
+            }
+        }
+    }
+
+    GIVEN("The function registered after the template is compiled") {
+        Teng::Fragment_t root;
+        Teng::Teng_t teng(TEST_ROOT);
+        Teng::Teng_t::GenPageArgs_t args;
+        args.templateString = "${udf.test_late('x')}";
+        auto generate = [&] (Teng::Error_t &err) {
+            std::string result;
+            Teng::StringWriter_t writer(result);
+            teng.generatePage(args, root, writer, err);
+            return result;
+        };
+        Teng::Error_t missing_err;
+        auto missing = generate(missing_err);
+        Teng::udf::registerFunction(
+            "test_late",
+            [] (const Teng::udf::Args_t &args) {
+                return Teng::udf::Result_t(args[0].string() + "!");
+            }
+        );
+
+        WHEN("The cached template is generated again") {
+            Teng::Error_t err;
+            auto result = generate(err);
+
+            THEN("The registered function is called") {
+                std::vector<Teng::Error_t::Entry_t> missing_errs = {{
+                    Teng::Error_t::ERROR,
+                    {1, 2},
+                    "Runtime: Call of unknown function udf.test_late()"
+                }};
+                ERRLOG_TEST(missing_err.getEntries(), missing_errs);
+                REQUIRE(missing == "undefined");
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "x!");
+            }
+        }
+    }
+}
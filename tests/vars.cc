@@ -34,6 +34,7 @@
  *             Created.
  */
 
+#include <sstream>
 #include <teng/teng.h>
 
 #include "catch2/catch_test_macros.hpp"
@@ -1354,3 +1355,107 @@ SCENARIO(
 }
 
 
+
+SCENARIO(
+    "Variables of fragments with many items",
+    "[vars][regvars]"
+) {
+    GIVEN("Some data with fragment containing lots of variables") {
+        Teng::Fragment_t root;
+        auto &row = root.addFragment("row");
+        for (auto i = 0; i < 100; ++i)
+            row.addVariable("var_" + std::to_string(i), i);
+        row.addVariable("var_7", "seven");
+        row.addFragment("nested").addVariable("var", "nested_var");
+
+        WHEN("The variables are expanded") {
+            Teng::Error_t err;
+            auto t = "<?teng frag row?>"
+                     "${var_0},${var_7},${var_99},${$.row.var_42},"
+                     "${row.var_3},${var_100}"
+                     "<?teng endfrag?>";
+            auto result = g(err, t, root);
+
+            THEN("Result contains variable values") {
+                std::vector<Teng::Error_t::Entry_t> errs = {{
+                    Teng::Error_t::WARNING,
+                    {1, 76},
+                    "Runtime: Variable '.row.var_100' is undefined "
+                    "[open_frags=.row, iteration=0/1]"
+                }};
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "0,seven,99,42,3,undefined");
+            }
+        }
+    }
+}
+
+SCENARIO(
+    "Variables of fragments added in reversed order",
+    "[vars][regvars]"
+) {
+    GIVEN("Some data with variables added in reversed order and replaced") {
+        Teng::Fragment_t root;
+        for (auto i = 20; i-- > 0;)
+            root.addVariable("var_" + std::to_string(i), i);
+        root.addVariable("var_5", "five");
+        root.addFragment("var_6").addVariable("var", "six");
+        root.addVariable("aaa", "first");
+
+        WHEN("The variables are expanded") {
+            Teng::Error_t err;
+            auto t = "${aaa},${var_0},${var_5},${$$.var_6.var},${var_19}";
+            auto result = g(err, t, root);
+
+            THEN("Result contains the last values of variables") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "first,0,five,six,19");
+            }
+        }
+    }
+}
+
+SCENARIO(
+    "Variables borrowing the strings of application",
+    "[vars][regvars]"
+) {
+    GIVEN("Some data with variables referring to application buffers") {
+        std::string body = "<b>article body</b>";
+        std::string words = "one two";
+        Teng::Fragment_t root;
+        root.addVariableView("body", body);
+        root.addVariableView("replaced", body);
+        root.addVariable("replaced", "owned");
+        root.addVariable("view", "owned");
+        root.addVariableView("view", Teng::string_view_t(words.data(), 3));
+        auto &list = root.addFragmentList("list");
+        list.addValueView(Teng::string_view_t(words.data() + 4, 3));
+        list.addValue("three");
+
+        WHEN("The variables are expanded") {
+            Teng::Error_t err;
+            auto t = "${body},${len(body)},${replaced},${view},"
+                     "${$$.list[0]},${$$.list[1]}";
+            auto result = g(err, t, root);
+
+            THEN("Result contains the borrowed strings") {
+                std::vector<Teng::Error_t::Entry_t> errs;
+                ERRLOG_TEST(err.getEntries(), errs);
+                REQUIRE(result == "&lt;b&gt;article body&lt;/b&gt;,19,owned,"
+                                  "one,two,three");
+            }
+        }
+
+        WHEN("The data tree is dumped") {
+            THEN("The borrowed strings are dumped as the owned ones") {
+                std::ostringstream json;
+                root.json(json);
+                REQUIRE(json.str() == "{\"body\": \"<b>article body<\\/b>\", "
+                                      "\"list\": [\"two\", \"three\"], "
+                                      "\"replaced\": \"owned\", "
+                                      "\"view\": \"one\"}");
+            }
+        }
+    }
+}